@@ -0,0 +1,704 @@
+#include "distributed.hpp"
+
+#include <monte-toad/accumulationbuffer.hpp>
+#include <monte-toad/core/camerainfo.hpp>
+#include <monte-toad/core/integratordata.hpp>
+#include <monte-toad/core/log.hpp>
+#include <monte-toad/core/renderinfo.hpp>
+#include <monte-toad/core/scene.hpp>
+#include <monte-toad/core/span.hpp>
+#include <monte-toad/imagebuffer.hpp>
+#include <monte-toad/util/textureloader.hpp>
+#include <mt-plugin-host/plugin.hpp>
+#include <mt-plugin/plugin.hpp>
+
+#include <netdb.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <deque>
+#include <thread>
+#include <vector>
+
+/*
+
+  Messages are sent as raw structs, so every node must share the same
+    architecture & build of monte-toad. The protocol is;
+
+    coordinator                        worker
+        |                                 |
+        | <------------------------ connect
+        | Tile ------------------------>  |  (renders tile)
+        | <-------------------- TileResult|
+        |               ...               |
+        | Finish ---------------------->  |
+
+  A tile result stores the sum of colors & the amount of samples of each
+    pixel, so results of the same tile from different workers (or different
+    tasks) can be merged weighted by their sample counts.
+*/
+
+namespace {
+
+enum struct MessageType : uint32_t { Tile, TileResult, Finish };
+
+struct MessageHeader {
+  MessageType type;
+  uint64_t payloadSize;
+};
+
+struct TileTask {
+  uint64_t taskIdx;
+  uint64_t integratorIdx;
+  uint64_t samples;
+  uint64_t pathsPerSample;
+  mt::RussianRoulette russianRoulette;
+  uint64_t russianRouletteDepth, maxSplitting;
+  float russianRouletteMinChance, russianRouletteWindow;
+  bool spectral, materialSortedDispatch;
+  glm::u16vec2 resolution;
+  glm::u16vec2 minRange, maxRange;
+  mt::core::CameraInfo camera;
+};
+
+struct TilePixel {
+  glm::vec3 colorSum;
+  uint32_t sampleCount;
+};
+
+struct WorkerConnection {
+  int fd = -1;
+  size_t taskIdx = -1lu;
+};
+
+////////////////////////////////////////////////////////////////////////////////
+bool SendAll(int fd, void const * data, size_t size) {
+  auto bytes = reinterpret_cast<uint8_t const *>(data);
+  while (size > 0ul) {
+    ssize_t const sent = send(fd, bytes, size, MSG_NOSIGNAL);
+    if (sent < 0 && errno == EINTR) { continue; }
+    if (sent <= 0) { return false; }
+    bytes += sent;
+    size -= static_cast<size_t>(sent);
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ReceiveAll(int fd, void * data, size_t size) {
+  auto bytes = reinterpret_cast<uint8_t *>(data);
+  while (size > 0ul) {
+    ssize_t const received = recv(fd, bytes, size, 0);
+    if (received < 0 && errno == EINTR) { continue; }
+    if (received <= 0) { return false; }
+    bytes += received;
+    size -= static_cast<size_t>(received);
+  }
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool SendMessage(
+  int fd, MessageType type
+, void const * payload, size_t payloadSize
+, void const * extraPayload = nullptr, size_t extraPayloadSize = 0ul
+) {
+  MessageHeader const header { type, payloadSize + extraPayloadSize };
+  return
+      ::SendAll(fd, &header, sizeof(MessageHeader))
+   && ::SendAll(fd, payload, payloadSize)
+   && ::SendAll(fd, extraPayload, extraPayloadSize)
+  ;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+// opens either a unix ("unix:/path") or tcp ("host:port") socket, that is
+// either listening for connections or connected to a listening socket
+int OpenSocket(std::string const & address, bool const listening) {
+  if (address.rfind("unix:", 0) == 0) {
+    std::string const path = address.substr(5);
+
+    sockaddr_un socketAddress {};
+    socketAddress.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(socketAddress.sun_path)) {
+      spdlog::error("unix socket path '{}' is too long", path);
+      return -1;
+    }
+    std::strncpy(
+      socketAddress.sun_path, path.c_str(), sizeof(socketAddress.sun_path)-1
+    );
+
+    int const fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) { return -1; }
+
+    auto const socketAddressPtr =
+      reinterpret_cast<sockaddr const *>(&socketAddress);
+
+    bool success = false;
+    if (listening) {
+      unlink(path.c_str());
+      success =
+          bind(fd, socketAddressPtr, sizeof(sockaddr_un)) == 0
+       && listen(fd, SOMAXCONN) == 0
+      ;
+    } else {
+      success = connect(fd, socketAddressPtr, sizeof(sockaddr_un)) == 0;
+    }
+
+    if (!success) { close(fd); return -1; }
+    return fd;
+  }
+
+  auto const portSeparator = address.rfind(':');
+  if (portSeparator == std::string::npos) {
+    spdlog::error("address '{}' must be 'unix:path' or 'host:port'", address);
+    return -1;
+  }
+
+  std::string const
+    host = address.substr(0, portSeparator)
+  , port = address.substr(portSeparator+1)
+  ;
+
+  addrinfo hints {};
+  hints.ai_family = AF_UNSPEC;
+  hints.ai_socktype = SOCK_STREAM;
+  hints.ai_flags = listening ? AI_PASSIVE : 0;
+
+  addrinfo * results = nullptr;
+  if (
+    getaddrinfo(
+      host.size() > 0 ? host.c_str() : nullptr, port.c_str(), &hints, &results
+    ) != 0
+  ) {
+    spdlog::error("could not resolve address '{}'", address);
+    return -1;
+  }
+
+  int fd = -1;
+  for (addrinfo * it = results; it; it = it->ai_next) {
+    fd = socket(it->ai_family, it->ai_socktype, it->ai_protocol);
+    if (fd < 0) { continue; }
+
+    bool success = false;
+    if (listening) {
+      int const reuse = 1;
+      setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(int));
+      success =
+          bind(fd, it->ai_addr, it->ai_addrlen) == 0
+       && listen(fd, SOMAXCONN) == 0
+      ;
+    } else {
+      success = connect(fd, it->ai_addr, it->ai_addrlen) == 0;
+    }
+
+    if (success) { break; }
+
+    close(fd);
+    fd = -1;
+  }
+
+  freeaddrinfo(results);
+  return fd;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool LoadScene(
+  mt::core::Scene & scene
+, mt::core::RenderInfo & render
+, mt::PluginInfo & plugin
+, distributed::Config const & config
+) {
+  if (!mt::Valid(plugin, mt::PluginType::AccelerationStructure)) {
+    spdlog::error(
+      "Need to have an acceleration structure plugin in order to load the scene"
+    );
+    return false;
+  }
+
+  // command line overrides the scene from the editor config
+  if (config.modelFile != "") { render.modelFile = config.modelFile; }
+  render.environmentMapFile = config.environmentMapFile;
+
+  if (render.modelFile == "") {
+    spdlog::error("Need a model file (--file) to render");
+    return false;
+  }
+
+  mt::core::Scene::Construct(scene, plugin, render.modelFile);
+
+  if (!scene.textureTileCache)
+    { scene.textureTileCache = mt::core::CreateTextureTileCache(); }
+
+  if (render.environmentMapFile != "") {
+    scene.emissionSource.environmentMap =
+      mt::util::LoadLinearTexture(
+        render.environmentMapFile, scene.textureTileCache
+      );
+  }
+
+  for (size_t idx = 0ul; idx < plugin.emitters.size(); ++ idx) {
+    if (
+        plugin.emitters[idx].IsSkybox()
+     && config.skyboxEmitterLabel == plugin.emitters[idx].PluginLabel()
+    ) {
+      scene.emissionSource.skyboxEmitterPluginIdx = idx;
+    }
+  }
+
+  for (auto & emitter : plugin.emitters)
+    { emitter.Precompute(scene, render, plugin); }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void RenderTile(
+  mt::core::Scene const & scene
+, mt::core::RenderInfo & render
+, mt::PluginInfo const & plugin
+, ::TileTask const & task
+, std::vector<::TilePixel> & pixels
+) {
+  auto & data = render.integratorData[task.integratorIdx];
+
+  // only cpu-side buffers are allocated, as workers are headless
+  size_t const pixelLength = task.resolution.x * task.resolution.y;
+  if (
+      data.imageResolution != task.resolution
+   || data.mappedImageTransitionBuffer.size() != pixelLength
+  ) {
+    data.imageResolution = task.resolution;
+    data.mappedImageTransitionBuffer.resize(pixelLength);
+    data.accumulatedColorBuffer.resize(pixelLength);
+    data.accumulatedColorCompensationBuffer.resize(pixelLength);
+    data.pixelCountBuffer.resize(pixelLength);
+    mt::core::Clear(data);
+  }
+
+  render.camera = task.camera;
+  if (plugin.camera.UpdateCamera) { plugin.camera.UpdateCamera(render.camera); }
+
+  data.samplesPerPixel = task.samples;
+  data.pathsPerSample = task.pathsPerSample;
+  data.russianRoulette = task.russianRoulette;
+  data.russianRouletteDepth = task.russianRouletteDepth;
+  data.russianRouletteMinChance = task.russianRouletteMinChance;
+  data.russianRouletteWindow = task.russianRouletteWindow;
+  data.maxSplitting = glm::clamp<size_t>(task.maxSplitting, 1ul, 16ul);
+  data.spectral = task.spectral;
+  data.materialSortedDispatch = task.materialSortedDispatch;
+
+  for (size_t y = task.minRange.y; y < task.maxRange.y; ++ y)
+  for (size_t x = task.minRange.x; x < task.maxRange.x; ++ x) {
+    size_t const idx = y*data.imageResolution.x + x;
+    data.accumulatedColorBuffer[idx] = glm::vec3(0.0f);
+    data.accumulatedColorCompensationBuffer[idx] = glm::vec3(0.0f);
+    data.pixelCountBuffer[idx] = 0u;
+  }
+
+  plugin
+    .dispatchers[render.primaryDispatcher]
+    .DispatchRegion(
+      render, scene, plugin, task.integratorIdx
+    , task.minRange, task.maxRange
+    , task.samples
+    );
+
+  pixels.clear();
+  for (size_t y = task.minRange.y; y < task.maxRange.y; ++ y)
+  for (size_t x = task.minRange.x; x < task.maxRange.x; ++ x) {
+    size_t const idx = y*data.imageResolution.x + x;
+    pixels.emplace_back(::TilePixel {
+      mt::core::AccumulatedColor(data, idx), data.pixelCountBuffer[idx]
+    });
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool ReceiveTileResult(
+  ::WorkerConnection const & worker
+, std::vector<::TileTask> const & tasks
+, mt::AccumulationBuffer & accumulation
+) {
+  MessageHeader header;
+  if (!::ReceiveAll(worker.fd, &header, sizeof(MessageHeader)))
+    { return false; }
+
+  if (header.type != MessageType::TileResult) { return false; }
+
+  ::TileTask task;
+  if (!::ReceiveAll(worker.fd, &task, sizeof(::TileTask))) { return false; }
+
+  if (worker.taskIdx >= tasks.size() || task.taskIdx != worker.taskIdx) {
+    spdlog::error(
+      "worker returned task {}, but was assigned {}"
+    , task.taskIdx, worker.taskIdx
+    );
+    return false;
+  }
+
+  // the tile is merged into the ranges of the assigned task, the ones the
+  // worker echoes back are only checked against them
+  auto const & assigned = tasks[worker.taskIdx];
+  if (
+      task.minRange != assigned.minRange || task.maxRange != assigned.maxRange
+   || glm::any(glm::greaterThan(assigned.minRange, assigned.maxRange))
+   || glm::any(glm::greaterThan(assigned.maxRange, accumulation.resolution))
+  ) {
+    spdlog::error("worker returned a tile outside of task {}", task.taskIdx);
+    return false;
+  }
+
+  auto const tileResolution =
+    glm::uvec2(assigned.maxRange - assigned.minRange);
+  size_t const pixelLength = tileResolution.x * tileResolution.y;
+
+  if (header.payloadSize != sizeof(::TileTask) + pixelLength*sizeof(TilePixel))
+    { return false; }
+
+  std::vector<::TilePixel> pixels(pixelLength);
+  if (!::ReceiveAll(worker.fd, pixels.data(), pixelLength*sizeof(TilePixel)))
+    { return false; }
+
+  // merge weighted by sample count
+  for (size_t y = 0ul; y < tileResolution.y; ++ y)
+  for (size_t x = 0ul; x < tileResolution.x; ++ x) {
+    size_t const idx =
+        (assigned.minRange.y + y)*accumulation.resolution.x
+      + (assigned.minRange.x + x);
+    auto const & pixel = pixels[y*tileResolution.x + x];
+    accumulation.colorSum[idx] += pixel.colorSum;
+    accumulation.sampleCount[idx] += pixel.sampleCount;
+  }
+
+  return true;
+}
+
+} // -- namespace
+
+////////////////////////////////////////////////////////////////////////////////
+bool distributed::RunCoordinator(
+  mt::core::RenderInfo & render
+, mt::PluginInfo & plugin
+, distributed::Config const & config
+) {
+  // -- select the integrator to render, the first enabled offline integrator
+  size_t integratorIdx = -1lu;
+  for (size_t idx = 0ul; idx < plugin.integrators.size(); ++ idx) {
+    if (plugin.integrators[idx].RealTime()) { continue; }
+    if (render.integratorData[idx].renderingState == mt::RenderingState::Off)
+      { continue; }
+    integratorIdx = idx;
+    break;
+  }
+
+  if (integratorIdx == -1lu) {
+    spdlog::error("coordinator needs an offline integrator to render");
+    return false;
+  }
+
+  auto const & data = render.integratorData[integratorIdx];
+  auto const resolution = data.imageResolution;
+  auto const stride = static_cast<uint16_t>(data.blockIteratorStride);
+
+  size_t const tileSamples =
+    config.tileSamples == 0ul ? data.samplesPerPixel : config.tileSamples;
+
+  // -- generate tile tasks, a tile is split into multiple tasks if the tile
+  //    samples are less than the samples per pixel
+  std::vector<::TileTask> tasks;
+  for (uint16_t y = 0u; y < resolution.y; y += stride)
+  for (uint16_t x = 0u; x < resolution.x; x += stride)
+  for (size_t sample = 0ul; sample < data.samplesPerPixel; sample += tileSamples)
+  {
+    ::TileTask task;
+    task.taskIdx = tasks.size();
+    task.integratorIdx = integratorIdx;
+    task.samples = glm::min(tileSamples, data.samplesPerPixel - sample);
+    task.pathsPerSample = data.pathsPerSample;
+    task.russianRoulette = data.russianRoulette;
+    task.russianRouletteDepth = data.russianRouletteDepth;
+    task.russianRouletteMinChance = data.russianRouletteMinChance;
+    task.russianRouletteWindow = data.russianRouletteWindow;
+    task.maxSplitting = data.maxSplitting;
+    task.spectral = data.spectral;
+    task.materialSortedDispatch = data.materialSortedDispatch;
+    task.resolution = resolution;
+    task.minRange = glm::u16vec2(x, y);
+    task.maxRange = glm::min(resolution, task.minRange + glm::u16vec2(stride));
+    task.camera = render.camera;
+    tasks.emplace_back(task);
+  }
+
+  int const listenFd = ::OpenSocket(config.address, true);
+  if (listenFd < 0) {
+    spdlog::error("coordinator could not listen on '{}'", config.address);
+    return false;
+  }
+
+  spdlog::info(
+    "coordinator rendering '{}' at {} in {} tasks, listening on '{}'"
+  , plugin.integrators[integratorIdx].PluginLabel()
+  , resolution, tasks.size(), config.address
+  );
+
+  // -- spawn local workers
+  size_t aliveChildren = 0ul;
+  for (size_t workerIt = 0ul; workerIt < config.spawnWorkers; ++ workerIt) {
+    std::vector<std::string> arguments = {
+      config.executable, "--worker", config.address
+    };
+
+    if (config.modelFile != "")
+      { arguments.insert(arguments.end(), {"--file", config.modelFile}); }
+
+    if (config.environmentMapFile != "") {
+      arguments.insert(
+        arguments.end(), {"--environment-map", config.environmentMapFile}
+      );
+    }
+
+    if (config.skyboxEmitterLabel != "") {
+      arguments.insert(
+        arguments.end(), {"--skybox", config.skyboxEmitterLabel}
+      );
+    }
+
+    pid_t const pid = fork();
+    if (pid == 0) {
+      std::vector<char *> argv;
+      for (auto & argument : arguments) { argv.emplace_back(argument.data()); }
+      argv.emplace_back(nullptr);
+      execv(config.executable.c_str(), argv.data());
+      _exit(1);
+    }
+
+    if (pid < 0) {
+      spdlog::error("could not spawn worker process");
+      continue;
+    }
+
+    ++ aliveChildren;
+  }
+
+  auto const startTime = std::chrono::system_clock::now();
+
+  mt::AccumulationBuffer accumulation;
+  mt::Allocate(accumulation, resolution);
+
+  std::vector<::WorkerConnection> workers;
+  std::deque<size_t> pendingTasks;
+  for (size_t idx = 0ul; idx < tasks.size(); ++ idx)
+    { pendingTasks.emplace_back(idx); }
+
+  auto const DisconnectWorker = [&](::WorkerConnection & worker) {
+    // requeue the task so another worker can render it
+    if (worker.taskIdx != -1lu) { pendingTasks.emplace_front(worker.taskIdx); }
+    close(worker.fd);
+    worker.fd = -1;
+    worker.taskIdx = -1lu;
+  };
+
+  size_t finishedTasks = 0ul;
+  while (finishedTasks < tasks.size()) {
+    // -- hand out tasks to idle workers
+    for (auto & worker : workers) {
+      if (worker.taskIdx != -1lu || pendingTasks.empty()) { continue; }
+
+      worker.taskIdx = pendingTasks.front();
+      pendingTasks.pop_front();
+
+      if (
+        !::SendMessage(
+          worker.fd, MessageType::Tile
+        , &tasks[worker.taskIdx], sizeof(::TileTask)
+        )
+      ) {
+        spdlog::warn("lost connection to worker");
+        DisconnectWorker(worker);
+      }
+    }
+
+    workers.erase(
+      std::remove_if(
+        workers.begin(), workers.end()
+      , [](::WorkerConnection const & worker) { return worker.fd < 0; }
+      )
+    , workers.end()
+    );
+
+    // -- check that local workers are still available
+    while (aliveChildren > 0ul && waitpid(-1, nullptr, WNOHANG) > 0)
+      { -- aliveChildren; }
+
+    if (config.spawnWorkers > 0ul && aliveChildren == 0ul && workers.empty()) {
+      spdlog::critical("all spawned workers exitted before rendering finished");
+      break;
+    }
+
+    // -- wait for connections & results
+    std::vector<pollfd> fds;
+    fds.emplace_back(pollfd { listenFd, POLLIN, 0 });
+    for (auto const & worker : workers)
+      { fds.emplace_back(pollfd { worker.fd, POLLIN, 0 }); }
+
+    if (poll(fds.data(), fds.size(), 1000) < 0) {
+      if (errno == EINTR) { continue; }
+      spdlog::critical("coordinator failed to poll sockets");
+      break;
+    }
+
+    for (size_t idx = 0ul; idx < workers.size(); ++ idx) {
+      if (!(fds[idx+1].revents & (POLLIN | POLLHUP | POLLERR))) { continue; }
+
+      auto & worker = workers[idx];
+      if (!::ReceiveTileResult(worker, tasks, accumulation)) {
+        spdlog::warn("lost connection to worker");
+        DisconnectWorker(worker);
+        continue;
+      }
+
+      worker.taskIdx = -1lu;
+      ++ finishedTasks;
+
+      if (render.displayProgress) {
+        spdlog::info("finished task {} / {}", finishedTasks, tasks.size());
+      }
+    }
+
+    if (fds[0].revents & POLLIN) {
+      int const fd = accept(listenFd, nullptr, nullptr);
+      if (fd >= 0) {
+        spdlog::info("worker connected");
+        workers.emplace_back(::WorkerConnection { fd, -1lu });
+      }
+    }
+  }
+
+  // -- release workers
+  for (auto & worker : workers) {
+    if (worker.fd < 0) { continue; }
+    ::SendMessage(worker.fd, MessageType::Finish, nullptr, 0ul);
+    close(worker.fd);
+  }
+
+  close(listenFd);
+  if (config.address.rfind("unix:", 0) == 0)
+    { unlink(config.address.substr(5).c_str()); }
+
+  while (aliveChildren > 0ul && waitpid(-1, nullptr, 0) > 0)
+    { -- aliveChildren; }
+
+  if (finishedTasks < tasks.size()) { return false; }
+
+  spdlog::info(
+    "rendering finished in {} ms"
+  , std::chrono::duration_cast<std::chrono::milliseconds>(
+      std::chrono::system_clock::now() - startTime
+    ).count()
+  );
+
+  if (
+      config.accumulationFile != ""
+   && !mt::SaveAccumulationBuffer(accumulation, config.accumulationFile)
+  ) {
+    return false;
+  }
+
+  auto image = mt::Resolve(accumulation);
+  mt::SaveImage(
+    make_span(image), resolution.x, resolution.y
+  , render.outputFile, render.displayProgress
+  );
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool distributed::RunWorker(
+  mt::core::RenderInfo & render
+, mt::PluginInfo & plugin
+, distributed::Config const & config
+) {
+  if (
+      plugin.dispatchers.size() == 0ul
+   || !plugin.dispatchers[render.primaryDispatcher].DispatchRegion
+  ) {
+    spdlog::error("worker needs a dispatcher plugin with `DispatchRegion`");
+    return false;
+  }
+
+  if (mt::Valid(plugin, mt::PluginType::Random)) { plugin.random.Initialize(); }
+
+  mt::core::Scene scene;
+  if (!::LoadScene(scene, render, plugin, config)) { return false; }
+
+  // the coordinator might not be listening yet
+  int fd = -1;
+  for (size_t attempt = 0ul; attempt < 50ul && fd < 0; ++ attempt) {
+    fd = ::OpenSocket(config.address, false);
+    if (fd < 0)
+      { std::this_thread::sleep_for(std::chrono::milliseconds(100)); }
+  }
+
+  if (fd < 0) {
+    spdlog::error("worker could not connect to '{}'", config.address);
+    return false;
+  }
+
+  std::vector<::TilePixel> pixels;
+
+  bool success = false;
+  for (;;) {
+    MessageHeader header;
+    if (!::ReceiveAll(fd, &header, sizeof(MessageHeader))) { break; }
+
+    if (header.type == MessageType::Finish) {
+      success = true;
+      break;
+    }
+
+    ::TileTask task;
+    if (
+        header.type != MessageType::Tile
+     || header.payloadSize != sizeof(::TileTask)
+     || !::ReceiveAll(fd, &task, sizeof(::TileTask))
+    ) {
+      break;
+    }
+
+    if (
+        task.integratorIdx >= plugin.integrators.size()
+     || task.maxRange.x > task.resolution.x
+     || task.maxRange.y > task.resolution.y
+    ) {
+      spdlog::error("worker received an invalid task {}", task.taskIdx);
+      break;
+    }
+
+    ::RenderTile(scene, render, plugin, task, pixels);
+
+    if (
+      !::SendMessage(
+        fd, MessageType::TileResult
+      , &task, sizeof(::TileTask)
+      , pixels.data(), pixels.size()*sizeof(::TilePixel)
+      )
+    ) {
+      break;
+    }
+  }
+
+  if (!success) { spdlog::error("worker lost connection to coordinator"); }
+
+  close(fd);
+  return success;
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+
+namespace mt::core { struct RenderInfo; }
+namespace mt { struct PluginInfo; }
+
+// headless coordinator/worker rendering; the coordinator splits the image of
+// the first offline integrator into tiles, which are rendered by worker
+// processes (local or on other nodes) and merged weighted by sample count
+
+namespace distributed {
+  struct Config {
+    // either "unix:/path/to/socket" or "host:port"
+    std::string address;
+
+    std::string modelFile;
+    std::string environmentMapFile;
+    std::string skyboxEmitterLabel;
+
+    // used to spawn local workers from the coordinator
+    std::string executable;
+    size_t spawnWorkers = 0ul;
+
+    // samples per pixel rendered by a single tile task, 0 uses the
+    // integrator's samples per pixel (one task per tile)
+    size_t tileSamples = 0ul;
+
+    // if set, the coordinator also saves the merged accumulation buffer, which
+    // can be merged with other runs of the same frame (monte-toad-merge)
+    std::string accumulationFile;
+  };
+
+  // renders the image by handing out tile tasks to connected workers, the
+  // merged result is saved to render.outputFile (& config.accumulationFile)
+  bool RunCoordinator(
+    mt::core::RenderInfo & render
+  , mt::PluginInfo & plugin
+  , Config const & config
+  );
+
+  // connects to the coordinator and renders tiles until told to finish
+  bool RunWorker(
+    mt::core::RenderInfo & render
+  , mt::PluginInfo & plugin
+  , Config const & config
+  );
+}
@@ -34,6 +34,28 @@ bool AttemptJsonStore(
   return false;
 }
 
+bool AttemptJsonStore(
+  nlohmann::json const & info
+, float & value, std::string const & label
+) {
+  if (auto s = info.find(label); s != info.end() && s->is_number()) {
+    value = s->get<float>();
+    return true;
+  }
+  return false;
+}
+
+bool AttemptJsonStore(
+  nlohmann::json const & info
+, bool & value, std::string const & label
+) {
+  if (auto s = info.find(label); s != info.end() && s->is_boolean()) {
+    value = s->get<bool>();
+    return true;
+  }
+  return false;
+}
+
 void LoadPluginIntegrator(
   mt::PluginInfoIntegrator & /*integrator*/
 , mt::core::IntegratorData & data
@@ -49,7 +71,33 @@ void LoadPluginIntegrator(
 
   ::AttemptJsonStore(info, data.samplesPerPixel, "samples-per-pixel");
   ::AttemptJsonStore(info, data.pathsPerSample, "paths-per-sample");
+
+  if (
+    auto s = info.find("russian-roulette");
+    s != info.end() && s->is_string()
+  ) {
+    data.russianRoulette =
+      mt::ToRussianRoulette(s->get<std::string>().c_str());
+  }
+
+  ::AttemptJsonStore(
+    info, data.russianRouletteDepth, "russian-roulette-depth"
+  );
+  ::AttemptJsonStore(
+    info, data.russianRouletteMinChance, "russian-roulette-min-chance"
+  );
+  ::AttemptJsonStore(
+    info, data.russianRouletteWindow, "russian-roulette-window"
+  );
+  ::AttemptJsonStore(info, data.maxSplitting, "max-splitting");
+  data.maxSplitting = glm::clamp(data.maxSplitting, 1ul, 16ul);
   ::AttemptJsonStore(info, data.blockIteratorStride, "block-stride");
+  ::AttemptJsonStore(info, data.spectral, "spectral");
+  ::AttemptJsonStore(info, data.kahanAccumulation, "kahan-accumulation");
+  ::AttemptJsonStore(
+    info, data.materialSortedDispatch, "material-sorted-dispatch"
+  );
+  ::AttemptJsonStore(info, data.halfFloatTexture, "half-float-texture");
   ::AttemptJsonStore(info, data.imageResolution.x, "resolution");
   data.overrideImGuiImageResolution =
     ::AttemptJsonStore(info, data.imguiImageResolution, "imgui-resolution");
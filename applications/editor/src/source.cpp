@@ -1,9 +1,11 @@
 /*
 */
 
+#include "distributed.hpp"
 #include "fileutil.hpp"
 #include "ui.hpp"
 
+#include <monte-toad/core/camerainfo.hpp>
 #include <monte-toad/core/integratordata.hpp>
 #include <monte-toad/core/log.hpp>
 #include <monte-toad/core/renderinfo.hpp>
@@ -65,6 +67,57 @@ mt::core::RenderInfo ParseRenderInfo(cxxopts::ParseResult const & result) {
   return self;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+distributed::Config ParseDistributedConfig(
+  cxxopts::ParseResult const & result
+, char const * executable
+) {
+  distributed::Config self;
+  self.modelFile          = result["file"]           .as<std::string>();
+  self.environmentMapFile = result["environment-map"].as<std::string>();
+  self.skyboxEmitterLabel = result["skybox"]         .as<std::string>();
+  self.spawnWorkers       = result["spawn-workers"]  .as<uint32_t>();
+  self.tileSamples        = result["tile-samples"]   .as<uint32_t>();
+  self.accumulationFile   =
+    result["accumulation-output"].as<std::string>();
+  self.executable         = executable;
+
+  self.address =
+    result.count("worker")
+      ? result["worker"].as<std::string>()
+      : result["coordinator"].as<std::string>()
+  ;
+
+  return self;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+mt::core::CameraInfo ParseCamera(cxxopts::ParseResult const & result) {
+  mt::core::CameraInfo self;
+
+  auto origin = result["camera-origin"].as<std::vector<float>>();
+  if (origin.size() != 3) {
+    spdlog::error("Camera origin must be in format X,Y,Z");
+    origin = {{ 1.0f, 1.0f, 1.0f }};
+  }
+
+  auto target = result["camera-target"].as<std::vector<float>>();
+  if (target.size() != 3) {
+    spdlog::error("Camera target must be in format X,Y,Z");
+    target = {{ 0.0f, 0.0f, 0.0f }};
+  }
+
+  self.origin = glm::vec3(origin[0], origin[1], origin[2]);
+  self.direction =
+    glm::normalize(glm::vec3(target[0], target[1], target[2]) - self.origin);
+  self.fieldOfView = result["fov"].as<float>();
+
+  if (result["up-axis"].as<bool>())
+    { self.upAxis = glm::vec3(0.0f, 0.0f, -1.0f); }
+
+  return self;
+}
+
 } // -- namespace
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -126,6 +179,28 @@ int main(int argc, char** argv) {
     ) (
       "p,noprogress", "does not display progress"
     , cxxopts::value<bool>()->default_value("false")
+    ) (
+      "coordinator"
+    , "render headless, handing out tiles to workers connecting to the address"
+      " (\"unix:/path\" or \"host:port\")"
+    , cxxopts::value<std::string>()
+    ) (
+      "worker", "render headless tiles for the coordinator at the address"
+    , cxxopts::value<std::string>()
+    ) (
+      "spawn-workers", "number of local workers the coordinator spawns"
+    , cxxopts::value<uint32_t>()->default_value("0")
+    ) (
+      "tile-samples"
+    , "samples per pixel of a single tile task, 0 renders all samples at once"
+    , cxxopts::value<uint32_t>()->default_value("0")
+    ) (
+      "skybox", "label of the skybox emitter plugin used by headless renders"
+    , cxxopts::value<std::string>()->default_value("")
+    ) (
+      "accumulation-output"
+    , "coordinator also saves the accumulation buffer, for monte-toad-merge"
+    , cxxopts::value<std::string>()->default_value("")
     ) (
       "h,help", "print usage"
     )
@@ -133,6 +208,8 @@ int main(int argc, char** argv) {
 
   // -- load up renderinfo from command line
   mt::core::RenderInfo render;
+  distributed::Config distributedConfig;
+  enum struct Mode { Editor, Coordinator, Worker } mode = Mode::Editor;
   { // -- parse options
     auto result = options.parse(argc, argv);
 
@@ -142,6 +219,12 @@ int main(int argc, char** argv) {
     }
 
     render = ParseRenderInfo(result);
+
+    if (result.count("coordinator") || result.count("worker")) {
+      mode = result.count("worker") ? Mode::Worker : Mode::Coordinator;
+      distributedConfig = ParseDistributedConfig(result, argv[0]);
+      render.camera = ParseCamera(result);
+    }
   }
 
   omp_set_num_threads(static_cast<int32_t>(render.numThreads));
@@ -153,6 +236,15 @@ int main(int argc, char** argv) {
   mt::PluginInfo plugin;
   fileutil::LoadEditorConfig(render, plugin);
 
+  // -- headless rendering
+  if (mode == Mode::Coordinator) {
+    return distributed::RunCoordinator(render, plugin, distributedConfig) ? 0 : 1;
+  }
+
+  if (mode == Mode::Worker) {
+    return distributed::RunWorker(render, plugin, distributedConfig) ? 0 : 1;
+  }
+
   if (!ui::Initialize(render, plugin)) {
     return 1;
   }
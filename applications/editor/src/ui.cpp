@@ -55,6 +55,10 @@ namespace ImGui {
 namespace {
 mt::core::Scene scene;
 
+// the environment map is decoded in the background while the scene renders
+// without it, & is taken once it's done
+mt::util::TextureLoad environmentMapLoad;
+
 bool reloadPlugin = false;
 
 struct GuiLogMessage {
@@ -110,11 +114,38 @@ void LoadScene(mt::core::RenderInfo & render, mt::PluginInfo & plugin) {
   , render.modelFile
   );
 
-  ::scene.emissionSource.environmentMap =
-    mt::util::LoadTexture(render.environmentMapFile);
+  ::scene.emissionSource.environmentMap = {};
+  ::environmentMapLoad = {};
+  if (render.environmentMapFile != "") {
+    ::environmentMapLoad =
+      mt::util::LoadLinearTextureAsync(
+        render.environmentMapFile, ::scene.textureTileCache
+      );
+  }
+
+  for (auto & emitter : plugin.emitters)
+    { emitter.Precompute(scene, render, plugin); }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void PollEnvironmentMap(
+  mt::core::RenderInfo & render
+, mt::PluginInfo & plugin
+) {
+  if (!::environmentMapLoad.Ready()) { return; }
+
+  ::scene.emissionSource.environmentMap = ::environmentMapLoad.Take();
+  if (!::scene.emissionSource.environmentMap.Valid()) {
+    spdlog::error(
+      "Could not load environment map '{}'", ::environmentMapLoad.filename
+    );
+  }
 
+  // the emitters' distributions were built without the environment map
   for (auto & emitter : plugin.emitters)
     { emitter.Precompute(scene, render, plugin); }
+
+  render.ClearImageBuffers();
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -452,6 +483,9 @@ bool ui::Initialize(
     ImGui_ImplOpenGL3_Init("#version 330 core");
   }
 
+  // created by the editor so streamed textures outlive reloaded plugins
+  ::scene.textureTileCache = mt::core::CreateTextureTileCache();
+
   if (render.modelFile != "")
   { // -- load scene
     LoadScene(render, plugin);
@@ -497,6 +531,8 @@ void ui::Run(mt::core::RenderInfo & render, mt::PluginInfo & plugin) {
     ImGui_ImplGlfw_NewFrame();
     ImGui::NewFrame();
 
+    ::PollEnvironmentMap(render, plugin);
+
     ::UiEntry(render, plugin);
 
     ::DispatchRender(render, plugin);
@@ -523,10 +559,23 @@ void ui::Run(mt::core::RenderInfo & render, mt::PluginInfo & plugin) {
     glfwSwapBuffers(app::DisplayWindow());
 
     if (reloadPlugin) {
+      // the compiled materials hold functions & a deallocator of the plugins,
+      // so they're freed before the plugins are unloaded & compiled again
+      // from the reloaded material plugin
+      ::scene.compiledMaterials.Clear();
+
+      // streamed textures are kept as they are; their tile cache was created
+      // by the editor, which allocates & releases the tiles & files through
+      // the editor's code even when a plugin faulted them in or streamed them
+
       // update plugins, should be ran every frame with a file checker in the
       // future
       mt::UpdatePlugins(plugin);
       reloadPlugin = false;
+
+      if (plugin.material.Compile && ::scene.meshes.size() > 0ul)
+        { plugin.material.Compile(::scene, plugin); }
+      render.ClearImageBuffers();
     }
   }
 
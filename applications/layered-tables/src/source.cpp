@@ -0,0 +1,99 @@
+/*
+  generates the fresnel microfacet & total internal reflection tables of the
+  layered material offline, so renders can map them instead of integrating
+  them every run
+*/
+
+#include <monte-toad/core/log.hpp>
+#include <monte-toad/material/layered-material-generator.hpp>
+#include <monte-toad/material/layered.hpp>
+
+#include <cxxopts.hpp>
+
+#include <string>
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv) {
+  auto options =
+    cxxopts::Options(
+      "monte-toad-layered-tables"
+    , "generates the precomputed tables of the layered material"
+    );
+  options.add_options()
+    (
+      "f,fresnel-output", "fresnel microfacet table output file"
+    , cxxopts::value<std::string>()->default_value("fresnel.mtt")
+    ) (
+      "t,tir-output", "total internal reflection table output file"
+    , cxxopts::value<std::string>()->default_value("tir.mtt")
+    ) (
+      "r,resolution", "entries along each dimension of the tables"
+    , cxxopts::value<uint32_t>()->default_value("32")
+    ) (
+      "s,samples", "samples integrating each entry"
+    , cxxopts::value<size_t>()->default_value("1024")
+    ) (
+      "eta-max", "largest relative index of refraction"
+    , cxxopts::value<float>()->default_value("4.0")
+    ) (
+      "kappa-max", "largest extinction coefficient"
+    , cxxopts::value<float>()->default_value("8.0")
+    ) (
+      "h,help", "print usage"
+    )
+  ;
+
+  auto result = options.parse(argc, argv);
+
+  if (result.count("help")) {
+    printf("%s\n", options.help().c_str());
+    return 0;
+  }
+
+  uint32_t const resolution = result["resolution"].as<uint32_t>();
+  size_t const samples = result["samples"].as<size_t>();
+  float const
+    etaMax = result["eta-max"].as<float>()
+  , kappaMax = result["kappa-max"].as<float>()
+  ;
+
+  if (resolution == 0u) {
+    spdlog::error("resolution must be at least 1");
+    return 1;
+  }
+
+  // tables are indexed by the incoming cosine, alpha, eta & kappa
+  auto const fresnelTable =
+    mt::material::layered::GenerateFresnelMicrofacetTable(
+      glm::u32vec4(resolution)
+    , glm::vec4(0.0f, 0.0f, 1.0f/etaMax, 0.0f)
+    , glm::vec4(1.0f, 1.0f, etaMax, kappaMax)
+    , samples
+    );
+
+  if (
+    !mt::material::layered::SaveTable(
+      fresnelTable, result["fresnel-output"].as<std::string>()
+    )
+  ) {
+    return 1;
+  }
+
+  auto const tirTable =
+    mt::material::layered::GenerateTotalInternalReflectionTable(
+      glm::u32vec3(resolution)
+    , glm::vec3(0.0f, 0.0f, 1.0f/etaMax)
+    , glm::vec3(1.0f, 1.0f, etaMax)
+    , samples
+    );
+
+  if (
+    !mt::material::layered::SaveTable(
+      tirTable, result["tir-output"].as<std::string>()
+    )
+  ) {
+    return 1;
+  }
+
+  return 0;
+}
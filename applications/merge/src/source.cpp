@@ -0,0 +1,88 @@
+/*
+  merges accumulation buffers of partial renders of the same frame into a
+  single image, weighted by the sample count of each pixel
+*/
+
+#include <monte-toad/accumulationbuffer.hpp>
+#include <monte-toad/core/log.hpp>
+#include <monte-toad/core/span.hpp>
+#include <monte-toad/imagebuffer.hpp>
+
+#include <cxxopts.hpp>
+
+#include <string>
+#include <vector>
+
+////////////////////////////////////////////////////////////////////////////////
+int main(int argc, char** argv) {
+  auto options =
+    cxxopts::Options(
+      "monte-toad-merge", "merges accumulation buffers of partial renders"
+    );
+  options.add_options()
+    (
+      "i,input", "accumulation buffers to merge"
+    , cxxopts::value<std::vector<std::string>>()
+    ) (
+      "o,output", "image output file"
+    , cxxopts::value<std::string>()->default_value("out.ppm")
+    ) (
+      "a,accumulation-output"
+    , "also saves the merged accumulation buffer, so it can be merged again"
+    , cxxopts::value<std::string>()->default_value("")
+    ) (
+      "p,noprogress", "does not display progress"
+    , cxxopts::value<bool>()->default_value("false")
+    ) (
+      "h,help", "print usage"
+    )
+  ;
+
+  options.parse_positional({"input"});
+  options.positional_help("<accumulation buffers...>");
+
+  auto result = options.parse(argc, argv);
+
+  if (result.count("help") || !result.count("input")) {
+    printf("%s\n", options.help().c_str());
+    return result.count("help") ? 0 : 1;
+  }
+
+  auto const inputs = result["input"].as<std::vector<std::string>>();
+
+  mt::AccumulationBuffer merged;
+  for (size_t idx = 0ul; idx < inputs.size(); ++ idx) {
+    mt::AccumulationBuffer buffer;
+    if (!mt::LoadAccumulationBuffer(buffer, inputs[idx])) { return 1; }
+
+    if (idx == 0ul) {
+      merged = std::move(buffer);
+      continue;
+    }
+
+    if (!mt::Merge(merged, buffer)) {
+      spdlog::error("'{}' does not match the resolution of '{}'"
+      , inputs[idx], inputs[0]
+      );
+      return 1;
+    }
+  }
+
+  spdlog::info("Merged {} accumulation buffers", inputs.size());
+
+  if (auto const accumulationOutput =
+        result["accumulation-output"].as<std::string>();
+      accumulationOutput != ""
+  ) {
+    if (!mt::SaveAccumulationBuffer(merged, accumulationOutput)) { return 1; }
+  }
+
+  auto image = mt::Resolve(merged);
+  mt::SaveImage(
+    make_span(image), merged.resolution.x, merged.resolution.y
+  , result["output"].as<std::string>()
+  , !result["noprogress"].as<bool>()
+  );
+
+  return 0;
+}
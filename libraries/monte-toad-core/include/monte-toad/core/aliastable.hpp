@@ -0,0 +1,24 @@
+#pragma once
+
+#include <vector>
+
+namespace mt::core {
+  // walker alias table, samples a discrete distribution in constant time
+  struct AliasTable {
+    // probability of keeping a bin rather than choosing its alias
+    std::vector<float> probability;
+    std::vector<size_t> alias;
+
+    // normalized weight of each bin, ei the pdf of it being sampled
+    std::vector<float> pdf;
+
+    // weights need not be normalized; an empty table is constructed if they
+    // don't sum to a positive value
+    static AliasTable Construct(std::vector<float> const & weights);
+
+    bool Valid() const { return this->alias.size() > 0ul; }
+  };
+
+  // samples a bin with a single uniform in [0, 1)
+  size_t Sample(AliasTable const & self, float const uniform);
+}
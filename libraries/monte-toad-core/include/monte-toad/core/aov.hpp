@@ -0,0 +1,92 @@
+#pragma once
+
+#include <monte-toad/core/enum.hpp>
+
+#include <string>
+#include <vector>
+
+// arbitrary output variables (AOVs); named channels that offline integrators
+// write per sample alongside the color (such as a direct/indirect split),
+// which the dispatcher accumulates per pixel by the rule of each channel.
+// Realtime multi-channel integrators write IntegratorData::channelBuffer
+// instead, as their channels are overwritten every dispatch
+
+namespace mt::core { struct IntegratorData; }
+
+namespace mt::core {
+  struct AovChannel {
+    std::string label;
+    mt::AovType type = mt::AovType::Vec3;
+    mt::AovAccumulation accumulation = mt::AovAccumulation::Average;
+
+    // per pixel; sum of the samples (or the last sample), the sum of their
+    // squares (only for variance) & the amount of samples written
+    std::vector<glm::vec3> sum, sumSquared;
+    std::vector<uint32_t> count;
+  };
+
+  // values an integrator wrote to the channels during a single sample,
+  // channels that weren't written to are not accumulated
+  struct AovSample {
+    std::vector<glm::vec3> values;
+    std::vector<uint8_t> written;
+
+    void Write(size_t const channel, glm::vec3 const & value) {
+      if (channel >= this->values.size()) { return; }
+      this->values[channel] = value;
+      this->written[channel] = 1u;
+    }
+
+    void Write(size_t const channel, float const value) {
+      this->Write(channel, glm::vec3(value));
+    }
+  };
+
+  // registers the channel to the integrator, returning its index; a channel
+  // of the same label is reused
+  size_t RegisterAov(
+    mt::core::IntegratorData & self
+  , std::string const & label
+  , mt::AovType const type
+  , mt::AovAccumulation const accumulation
+  );
+
+  // index of the channel with the label, -1lu if there is none
+  size_t FindAov(
+    mt::core::IntegratorData const & self
+  , std::string const & label
+  );
+
+  // allocates the channels to the image resolution & clears them
+  void AllocateAovs(mt::core::IntegratorData & self);
+  void ClearAovs(mt::core::IntegratorData & self);
+
+  // prepares a sample for the channels of the integrator
+  void ResetAovSample(
+    mt::core::IntegratorData const & self
+  , mt::core::AovSample & sample
+  );
+
+  // accumulates the written channels of the sample into the pixel, samples of
+  // the same pixel can be accumulated concurrently
+  void AccumulateAovSample(
+    mt::core::IntegratorData & self
+  , size_t const pixelIdx
+  , mt::core::AovSample const & sample
+  );
+
+  glm::vec3 ResolveAov(
+    mt::core::IntegratorData const & self
+  , size_t const channel
+  , size_t const pixelIdx
+  );
+
+  // displayed value of the pixel; its mean color, or the displayed channel
+  glm::vec3 ResolvePixel(
+    mt::core::IntegratorData const & self
+  , size_t const pixelIdx
+  );
+
+  // channels of every offline integrator, written by the dispatcher
+  constexpr size_t aovSampleCount = 0ul, aovVariance = 1ul;
+}
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <monte-toad/core/math.hpp>
+#include <monte-toad/core/span.hpp>
+
+#include <cstdint>
+#include <vector>
+
+// structure-of-arrays batches of surfaces shaded by the same bsdf, so that a
+// wavefront or sorted shading stage evaluates many hits in a single plugin
+// call, which the plugin can vectorize over. Every span of a batch has the
+// length of the batch
+
+namespace mt::core { struct SurfaceInfo; }
+
+namespace mt::core {
+  struct SurfaceBatch {
+    span<glm::vec3 const> normal, incomingAngle;
+    span<glm::vec2 const> uvcoord;
+    span<float const> uvFootprint;
+    span<float const> indexOfRefraction;
+
+    // distance travelled to the surface, & 1 if the previous surface of the
+    // path had the same material (so the path travelled through its medium)
+    span<float const> distance;
+    span<uint8_t const> sameMedium;
+
+    size_t Size() const { return normal.size(); }
+  };
+
+  // directions & their evaluation; the Fs & Pdf batches read wo, the Sample
+  // batch writes all of them
+  struct BsdfBatch {
+    span<glm::vec3> wo, fs;
+    span<float> pdf;
+  };
+
+  // gathers surfaces into a batch
+  struct SurfaceBatchStorage {
+    std::vector<glm::vec3> normal, incomingAngle;
+    std::vector<glm::vec2> uvcoord;
+    std::vector<float> uvFootprint, indexOfRefraction, distance;
+    std::vector<uint8_t> sameMedium;
+
+    void Clear();
+    void Push(SurfaceInfo const & surface, float const indexOfRefraction);
+
+    size_t Size() const { return normal.size(); }
+    SurfaceBatch View() const;
+  };
+
+  // storage of a BsdfBatch
+  struct BsdfBatchStorage {
+    std::vector<glm::vec3> wo, fs;
+    std::vector<float> pdf;
+
+    void Resize(size_t const size);
+    BsdfBatch View();
+  };
+}
@@ -11,6 +11,13 @@ namespace mt::core {
     float fieldOfView = 90.0f;
   };
 
+  // angle between the rays of neighbouring pixels, the spread of the ray
+  // cones traced from the camera
+  float PixelSpreadAngle(
+    mt::core::CameraInfo const & camera
+  , glm::u16vec2 const & imageResolution
+  );
+
   // updates camera for plugin and clears image buffer
   void UpdateCamera(
     mt::PluginInfo const & plugin
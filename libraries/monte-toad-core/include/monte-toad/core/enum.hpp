@@ -47,6 +47,28 @@ namespace mt {
   , FillBlockCw
   };
 
+  // how offline integrators terminate (or split) paths after a bounce
+  enum struct RussianRoulette : uint8_t {
+    Off        // paths only end at the maximum depth
+  , Throughput // terminates paths relative to their throughput
+  , Adjoint    // keeps the expected contribution of paths, estimated from
+               // learnt incident radiance, within a window by terminating
+               // or splitting them (adjoint-driven russian roulette)
+  , Size
+  };
+
+  // components stored by an arbitrary output variable (AOV) channel
+  enum struct AovType : uint8_t { Float, Vec3 };
+
+  // how the samples of an AOV channel are combined into its pixel
+  enum struct AovAccumulation : uint8_t {
+    Average  // mean of the samples written to the channel
+  , Sum      // total of the samples, such as a sample count
+  , Variance // variance of the mean of the samples
+  , Last     // the last sample written
+  , Size
+  };
+
   enum struct BsdfTypeHint : uint8_t {
     Diffuse
   , Specular
@@ -66,8 +88,11 @@ namespace mt {
 
   RenderingState ToRenderingState(char const * label);
   AspectRatio ToAspectRatio(char const * label);
+  RussianRoulette ToRussianRoulette(char const * label);
   void ApplyAspectRatioY(mt::AspectRatio ratio, uint16_t const x, uint16_t & y);
 
   char const * ToString(mt::IntegratorTypeHint hint);
   char const * ToString(mt::KernelDispatchTiming timing);
+  char const * ToString(mt::RussianRoulette roulette);
+  char const * ToString(mt::AovAccumulation accumulation);
 }
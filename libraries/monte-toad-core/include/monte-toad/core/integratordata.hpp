@@ -1,5 +1,6 @@
 #pragma once
 
+#include <monte-toad/core/aov.hpp>
 #include <monte-toad/core/enum.hpp>
 #include <monte-toad/core/glutil.hpp>
 #include <monte-toad/core/kerneldispatchinfo.hpp>
@@ -7,17 +8,46 @@
 
 #include <vector>
 #include <chrono>
+#include <unordered_map>
 
 namespace mt::core { struct KernelDispatchInfo; }
 
 namespace mt::core {
+  // pixels of a dispatched region, in the order they're shaded
+  struct ShadingOrder {
+    size_t minX, minY, maxX, maxY, strideX, strideY;
+    std::vector<size_t> pixels;
+  };
+
   struct IntegratorData {
     std::vector<glm::vec3> mappedImageTransitionBuffer;
-    std::vector<uint16_t> pixelCountBuffer;
+
+    // samples are accumulated as a sum of colors & amount of samples per pixel,
+    // which the transition buffer is resolved from. The compensation buffer is
+    // only used with kahan accumulation
+    std::vector<glm::vec3> accumulatedColorBuffer;
+    std::vector<glm::vec3> accumulatedColorCompensationBuffer;
+    std::vector<uint32_t> pixelCountBuffer;
     mt::core::GlTexture renderedTexture;
+    mt::core::GlBuffer renderedPixelUnpackBuffer;
 
     std::vector<glm::vec3> previewMappedImageTransitionBuffer;
     mt::core::GlTexture previewRenderedTexture;
+    mt::core::GlBuffer previewPixelUnpackBuffer;
+
+    // arbitrary output variables of offline integrators, & the channel that
+    // is displayed instead of the color (-1lu for the color)
+    std::vector<mt::core::AovChannel> aovs;
+    size_t displayedAov = -1lu;
+
+    // channels written in one pass by multi-channel integrators (such as a
+    // g-buffer); the channelCount channels of a pixel are stored contiguously
+    std::vector<glm::vec3> channelBuffer;
+    size_t channelCount = 0ul;
+    size_t displayedChannel = 0ul;
+
+    // stores rendered textures as half floats, halving upload bandwidth
+    bool halfFloatTexture = false;
 
     // used to build integrators that are necessary
     std::array<std::vector<glm::vec3>, Idx(mt::IntegratorTypeHint::Size)> 
@@ -43,8 +73,41 @@ namespace mt::core {
     mt::RenderingState renderingState = mt::RenderingState::Off;
 
     size_t samplesPerPixel = 1;
+
+    // maximum amount of bounces of a path
     size_t pathsPerSample = 1;
 
+    // -- russian roulette & splitting of paths after a bounce, which trades
+    //    the cost of a path against its expected contribution
+    mt::RussianRoulette russianRoulette = mt::RussianRoulette::Throughput;
+
+    // bounces before paths can be terminated, & their lowest survival chance
+    size_t russianRouletteDepth = 4ul;
+    float russianRouletteMinChance = 0.05f;
+
+    // adjoint; paths whose expected contribution is within [1/window, window]
+    // of the pixel estimate are left as is, brighter paths are split into at
+    // most maxSplitting paths, which is kept between 1 & 16
+    float russianRouletteWindow = 5.0f;
+    size_t maxSplitting = 4ul;
+
+    // traces hero wavelength spectral paths instead of RGB paths, for
+    // integrators that support it
+    bool spectral = false;
+
+    // shades the pixels of a block ordered by the material of their primary
+    // hit, so that consecutive samples of a thread run the same material &
+    // bsdf code over the same data; it doesn't change the rendered image
+    bool materialSortedDispatch = false;
+
+    // material sorted orders of the dispatched regions keyed by their first
+    // pixel, built the first time a region is dispatched & dropped on Clear
+    std::unordered_map<size_t, mt::core::ShadingOrder> shadingOrders;
+
+    // compensates accumulated float sums, but then samples of a pixel can't be
+    // processed concurrently
+    bool kahanAccumulation = false;
+
     bool renderingFinished = false;
 
     bool imagePixelClicked = false;
@@ -98,4 +161,10 @@ namespace mt::core {
     std::chrono::time_point<std::chrono::system_clock>
       startTime, endTime;
   };
+
+  // returns the (compensated) sum of sample colors of the pixel
+  glm::vec3 AccumulatedColor(
+    mt::core::IntegratorData const & self
+  , size_t const pixelIdx
+  );
 }
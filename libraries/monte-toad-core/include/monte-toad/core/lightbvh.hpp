@@ -0,0 +1,65 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+// light hierarchy (conty & kulla), each node bounds the origins, emission
+// directions & power of its lights, which allows choosing a light relative to
+// a shading point in logarithmic time, favouring close, bright & facing lights
+
+namespace mt::core {
+  // light directions are bound by double-sided cones, as emissive triangles
+  // emit from both of their faces
+  struct LightBvhPrimitive {
+    glm::vec3 boundsMin, boundsMax;
+    glm::vec3 axis;
+    float power;
+  };
+
+  struct LightBvhNode {
+    glm::vec3 boundsMin, boundsMax;
+
+    // cone of emission normals, thetaO is the angle the normals spread around
+    // the axis, thetaE the angle emission spreads around each normal
+    glm::vec3 axis;
+    float thetaO, thetaE;
+
+    float power;
+
+    // internal nodes have their left child directly after them
+    size_t rightChild = -1lu;
+    size_t primitive = -1lu;
+
+    bool Leaf() const { return this->rightChild == -1lu; }
+  };
+
+  struct LightBvh {
+    std::vector<LightBvhNode> nodes;
+
+    // path from the root to the leaf of each primitive, bit N set means the
+    // right child is taken at depth N
+    std::vector<uint64_t> primitiveTrail;
+
+    static LightBvh Construct(
+      std::vector<LightBvhPrimitive> const & primitives
+    );
+
+    bool Valid() const { return this->nodes.size() > 0ul; }
+  };
+
+  // chooses a primitive relative to the shading point, returns -1lu if no
+  // primitive can contribute
+  size_t Sample(
+    LightBvh const & self
+  , glm::vec3 const & origin, glm::vec3 const & normal
+  , float uniform
+  , float & pdf
+  );
+
+  // probability of Sample choosing the primitive from the shading point
+  float Pdf(
+    LightBvh const & self
+  , glm::vec3 const & origin, glm::vec3 const & normal
+  , size_t const primitive
+  );
+}
@@ -17,6 +17,13 @@ template <typename T> T saturate(T const & t) {
   return glm::clamp(t, T(0), T(1));
 }
 
+// multiple importance sampling weight of strategy f against strategy g, with
+// a power of two (veach)
+inline float PowerHeuristic(float fPdf, float gPdf) {
+  float const f2 = fPdf*fPdf, g2 = gPdf*gPdf;
+  return f2 + g2 > 0.0f ? f2/(f2 + g2) : 0.0f;
+}
+
 // returns true if any component of a is greater than b
 bool GreaterThan(glm::vec3 a, glm::vec3 b);
 
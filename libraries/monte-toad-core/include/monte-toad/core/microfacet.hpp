@@ -0,0 +1,62 @@
+#pragma once
+
+#include <monte-toad/core/math.hpp>
+
+// GGX (Trowbridge-Reitz) microfacet distribution, shared by the microfacet
+// bsdfs. Directions are in the local shading frame, where z is the normal of
+// the side the incoming direction is on; alpha is the squared roughness
+
+namespace mt::core {
+  // local shading frame of a surface, around its normal
+  struct MicrofacetFrame {
+    glm::vec3 tangent, binormal, normal;
+
+    glm::vec3 ToLocal(glm::vec3 const & v) const;
+    glm::vec3 ToWorld(glm::vec3 const & v) const;
+
+    static MicrofacetFrame Construct(glm::vec3 const & normal);
+  };
+
+  // smallest alpha, below which the distribution isn't numerically stable
+  constexpr float ggxMinAlpha = 1e-3f;
+
+  float GgxD(glm::vec3 const & h, float const alpha);
+
+  // height-correlated shadowing-masking ("Understanding the Masking-Shadowing
+  // Function in Microfacet-Based BRDFs", Heitz 2014)
+  float GgxLambda(glm::vec3 const & w, float const alpha);
+  float GgxG1(glm::vec3 const & w, float const alpha);
+  float GgxG2(glm::vec3 const & wi, glm::vec3 const & wo, float const alpha);
+
+  // samples a microfacet normal visible from wi, which has to be in the upper
+  // hemisphere ("Sampling the GGX Distribution of Visible Normals", Heitz 2018)
+  glm::vec3 GgxSampleVisibleNormal(
+    glm::vec3 const & wi
+  , float const alpha
+  , glm::vec2 const & u
+  );
+
+  float GgxVisibleNormalPdf(
+    glm::vec3 const & wi
+  , glm::vec3 const & h
+  , float const alpha
+  );
+
+  // -- directional albedo of single scattering, for multiple scattering
+  //    energy compensation ("Practical multiple scattering compensation for
+  //    microfacet models", Turquin 2019). The albedos are integrated into
+  //    lookup tables the first time they're used
+
+  // albedo of GGX reflection with a fresnel of 1
+  float GgxReflectionAlbedo(float const cosTheta, float const alpha);
+
+  // albedo of GGX transmission without a fresnel term, where eta is the
+  // relative index of refraction of the incoming side over the outgoing side
+  // (between 1/3 and 3); microfacets that would totally internally reflect
+  // don't transmit anything
+  float GgxTransmissionAlbedo(
+    float const cosTheta
+  , float const alpha
+  , float const eta
+  );
+}
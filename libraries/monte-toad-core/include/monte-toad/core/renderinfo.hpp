@@ -21,6 +21,8 @@ namespace mt::core {
 
   size_t BlockIteratorMax(mt::core::IntegratorData & self);
 
+  // uploads the region [min, max) of the image (& the entire preview image, if
+  // it was generated) to their textures
   void DispatchImageCopy(
     mt::core::IntegratorData & self
   , size_t minX, size_t maxX, size_t minY, size_t maxY
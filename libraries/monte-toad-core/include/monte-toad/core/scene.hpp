@@ -1,9 +1,12 @@
 #pragma once
 
+#include <monte-toad/core/aliastable.hpp>
 #include <monte-toad/core/any.hpp>
+#include <monte-toad/core/lightbvh.hpp>
 #include <monte-toad/core/span.hpp>
 #include <monte-toad/core/texture.hpp>
 
+#include <deque>
 #include <filesystem>
 #include <string>
 #include <vector>
@@ -22,6 +25,17 @@ namespace mt::core {
   struct EmissionSource {
     std::vector<size_t> triangles;
 
+    // samples from triangles, weighted by area * emitted power, used when
+    // there is no shading point to sample relative to
+    mt::core::AliasTable triangleTable;
+
+    // samples from triangles relative to a shading point
+    mt::core::LightBvh lightBvh;
+
+    // index into triangles, indexed by the triangle idx of the scene (-1lu for
+    // non-emissive triangles)
+    std::vector<size_t> triangleEntry;
+
     mt::core::Texture environmentMap;
 
     size_t skyboxEmitterPluginIdx = -1lu;
@@ -38,9 +52,20 @@ namespace mt::core {
 
     std::vector<mt::core::Mesh> meshes;
 
-    std::vector<mt::core::Texture> textures;
+    // a deque so materials' pointers to textures stay valid as textures are
+    // added
+    std::deque<mt::core::Texture> textures;
+
+    // streams the large textures of the scene, created by the application as
+    // it outlives the plugins
+    std::shared_ptr<mt::core::TextureTileCache> textureTileCache;
+
+    size_t triangleCount = 0ul;
 
     mt::core::Any accelStructure;
+
+    // materials of the meshes as compiled by the material plugin, if it does
+    mt::core::Any compiledMaterials;
     EmissionSource emissionSource;
 
     glm::vec3 bboxMin, bboxMax;
@@ -53,8 +78,35 @@ namespace mt::core {
   , size_t const ignoredTriangle
   );
 
+  // collects the emissive triangles of the scene & builds their alias table,
+  // must be called whenever the emitters of materials change
+  void UpdateEmissionSource(Scene & scene, mt::PluginInfo const & plugin);
+
+  // picks an emissive triangle, proportional to its area & emitted power, & a
+  // uniformly distributed barycentric coordinate on it
+  std::tuple<mt::core::Triangle, glm::vec2> EmissionSourceTriangle(
+    Scene const & scene
+  , mt::PluginInfo const & plugin
+  );
+
+  // picks an emissive triangle through the light hierarchy, favouring those
+  // that contribute most to the surface
   std::tuple<mt::core::Triangle, glm::vec2> EmissionSourceTriangle(
     Scene const & scene
   , mt::PluginInfo const & plugin
+  , mt::core::SurfaceInfo const & surface
+  );
+
+  // pdf, with respect to area, of EmissionSourceTriangle generating a point on
+  // the triangle
+  float EmissionSourceTrianglePdf(
+    Scene const & scene
+  , mt::core::Triangle const & triangle
+  );
+
+  float EmissionSourceTrianglePdf(
+    Scene const & scene
+  , mt::core::SurfaceInfo const & surface
+  , mt::core::Triangle const & triangle
   );
 }
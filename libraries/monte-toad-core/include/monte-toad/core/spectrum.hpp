@@ -1,8 +1,60 @@
 #pragma once
 
+#include <monte-toad/core/math.hpp>
+
 namespace mt::core {
   struct BsdfSampleInfo {
     glm::vec3 wo = glm::vec3(0.0f), fs = glm::vec3(0.0f);
     float pdf = 0.0f;
+
+    // wo depends on the wavelength (such as a refraction with dispersion), so
+    // it is only valid for the hero wavelength of a spectral path
+    bool dispersive = false;
   };
+
+  // hero wavelength sampling ("Hero Wavelength Spectral Sampling", Wilkie et
+  // al. 2014); a path carries 4 wavelengths in nm, the hero wavelength & 3
+  // others equally spaced over the visible range, so a path is traced once
+  // for all of them & the lanes of a glm::vec4 store a value per wavelength
+  struct SampledWavelengths {
+    glm::vec4 lambda = glm::vec4(0.0f);
+    bool secondaryTerminated = false;
+  };
+
+  // wavelengths are sampled uniformly over the range
+  constexpr float wavelengthMin = 380.0f, wavelengthMax = 780.0f;
+
+  SampledWavelengths SampleWavelengths(float const u);
+
+  // keeps only the hero wavelength of the path throughput, for when the path
+  // continues in a direction that is only valid for it; the hero wavelength
+  // then stands in for all wavelengths of the estimate
+  void TerminateSecondaryWavelengths(
+    SampledWavelengths & self
+  , glm::vec4 & throughput
+  );
+
+  // reflectance (or emission, as it is scaled linearly) of an RGB colour at
+  // the wavelengths ("An RGB to Spectrum Conversion for Reflectances", Smits
+  // 1999)
+  glm::vec4 RgbToSpectrum(
+    glm::vec3 const & rgb
+  , SampledWavelengths const & wavelengths
+  );
+
+  // estimate of the linear RGB colour of the spectral samples, a constant
+  // spectrum of 1 is white
+  glm::vec3 SpectrumToRgb(
+    glm::vec4 const & spectrum
+  , SampledWavelengths const & wavelengths
+  );
+
+  // index of refraction at the wavelength of a material with the index of
+  // refraction at the sodium d-line & Abbe number, using Cauchy's equation;
+  // an Abbe number of 0 has no dispersion
+  float DispersiveIndexOfRefraction(
+    float const indexOfRefraction
+  , float const abbeNumber
+  , float const wavelength
+  );
 }
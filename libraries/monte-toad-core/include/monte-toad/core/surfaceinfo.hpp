@@ -25,6 +25,17 @@ namespace mt::core {
 
     size_t material = -1lu;
 
+    // hero wavelength (in nm) of the spectral path that hit the surface, 0
+    // when rendering in RGB
+    float wavelength = 0.0f;
+
+    // ray cone the surface was hit with ("Texture Level of Detail Strategies
+    // for Real-Time Ray Tracing", Akenine-Möller 2019); its width at the
+    // surface, its spread angle & the width of its footprint in uv space,
+    // which picks the mip level of textures
+    float coneWidth = 0.0f, coneSpread = 0.0f;
+    float uvFootprint = 0.0f;
+
     // TODO i really shouldn't need a shared ptr
     std::shared_ptr<mt::core::SurfaceInfo> previousSurface = nullptr;
 
@@ -43,4 +54,13 @@ namespace mt::core {
     , glm::vec3 incomingAngle
     );
   };
+
+  // widens the ray cone of width originWidth leaving the origin of the ray
+  // over the distance to the surface, & projects it into the uv space of the
+  // triangle that was hit
+  void PropagateRayCone(
+    SurfaceInfo & surface
+  , float const originWidth
+  , float const spread
+  );
 }
@@ -1,33 +1,109 @@
 #pragma once
 
 #include <array>
+#include <memory>
 #include <string>
 #include <vector>
 
 namespace mt::core { struct Scene; }
+namespace mt::core { struct SurfaceInfo; }
+namespace mt::core { struct TextureTileCache; }
+namespace mt::core { struct TextureTileFile; }
 
 namespace mt::core {
+  // storage of each channel of a texel, which is converted to a float when
+  // it's read; 8 bit channels are normalized to [0, 1]
+  enum class TexelFormat : uint8_t { Unorm8, Half, Float };
+
+  size_t TexelFormatByteSize(TexelFormat format);
+
+  // texels are stored in square tiles, so the texels of a filter footprint
+  // share cache lines & pages; tiles are stored row by row & the texels of a
+  // tile in morton order. Edge tiles are padded to the full tile size
+  constexpr size_t textureTileSize = 32ul;
+  constexpr size_t textureTileTexels = textureTileSize*textureTileSize;
+
+  //////////////////////////////////////////////////////////////////////////////
+  struct TextureLevel {
+    uint64_t width, height;
+    uint64_t tilesX, tilesY;
+    // texels in the channel count & format of the texture, empty if the
+    // texture is streamed
+    std::vector<uint8_t> data;
+    // byte offset of the level's tiles in the tile file of a streamed texture
+    uint64_t tileFileOffset = 0ul;
+
+    // index of the texel in the tiled layout, & of its tile
+    size_t Idx(size_t x, size_t y) const;
+    size_t TileIdx(size_t x, size_t y) const;
+
+    static TextureLevel Construct(
+      uint64_t width, uint64_t height, size_t texelByteSize
+    );
+  };
+
   //////////////////////////////////////////////////////////////////////////////
   struct Texture {
     uint64_t width, height;
-    std::vector<glm::vec4> data;
+    // textures keep the channels of their source, so masks aren't stored as
+    // RGBA; a single channel reads as grey & two channels as grey & alpha
+    uint8_t channels = 4u;
+    TexelFormat format = TexelFormat::Unorm8;
+    // mip pyramid built at construction; level 0 is the full resolution image
+    // & every level after is box filtered to half the size, down to 1x1
+    std::vector<TextureLevel> levels;
     std::string label;
 
+    // the tiles of streamed textures are faulted in from this file through the
+    // texture tile cache, rather than held by the levels
+    std::shared_ptr<TextureTileFile const> tileFile;
+
     Texture() = default;
 
+    // data holds width*height texels of colorChannels channels in the format
     static Texture Construct(
       size_t width, size_t height, size_t colorChannels
+    , TexelFormat format
     , void const * data
     );
 
-    bool Valid() const { return data.size() > 0; }
-    size_t Idx(size_t x, size_t y) const { return y*this->width + x; }
+    bool Valid() const { return levels.size() > 0; }
+
+    size_t TexelByteSize() const {
+      return this->channels * mt::core::TexelFormatByteSize(this->format);
+    }
+
+    glm::vec4 Texel(size_t level, size_t x, size_t y) const;
   };
 
+  // -- streaming; a tile cache is shared by the streamed textures it's given
+  //    & evicts the least recently used tiles once it's over its capacity,
+  //    so textures larger than memory render within a bounded amount of it
+
+  // the cache allocates its tiles & files through the module that creates
+  // it, so it must be created by the application rather than a plugin that
+  // can be reloaded
+  std::shared_ptr<TextureTileCache> CreateTextureTileCache();
+
+  // writes the tiles of the texture to an anonymous file in the directory &
+  // releases its texels, returns false if the file couldn't be written
+  bool StreamTexture(
+    Texture & texture
+  , std::shared_ptr<TextureTileCache> const & cache
+  , std::string const & directory
+  );
+
+  // capacity of the tile cache in bytes
+  void SetTextureTileCacheCapacity(TextureTileCache & cache, size_t bytes);
+  size_t TextureTileCacheCapacity(TextureTileCache & cache);
+
   // TODO BELOW should probably go into a different header
   template <typename T> struct TextureOption {
     bool GuiApply(mt::core::Scene const & scene);
-    T Get(glm::vec2 const & uv) const;
+
+    // the footprint is the width of the region of uv space to filter over
+    T Get(glm::vec2 const & uv, float const footprint = 0.0f) const;
+    T Get(mt::core::SurfaceInfo const & surface) const;
 
     std::string label = "N/A";
     float minRange = 0.0f, maxRange = 1.0f;
@@ -47,6 +123,13 @@ namespace mt::core {
   // TODO namespace
   glm::vec4 Sample(Texture const & texture, glm::vec2 uvCoords);
   glm::vec4 SampleBilinear(Texture const & texture, glm::vec2 uvCoords);
+
+  // trilinear lookup of the mip level whose texels match the footprint, the
+  // width of the region of uv space to filter over; a footprint of 0 is a
+  // bilinear lookup of the full resolution image
+  glm::vec4 Sample(
+    Texture const & texture, glm::vec2 uvCoords, float const footprint
+  );
   /* glm::vec4 Sample(CubemapTexture const & texture, glm::vec3 dir); */
   glm::vec4 Sample(Texture const & texture, glm::vec3 dir); // spherical
 }
@@ -46,8 +46,7 @@ namespace mt::core {
     bvh::Vector<float, 3> center() const;
     glm::vec3 Center() const;
 
-    /* // Required by BVH if splitting is to be performed */
-    /* float area() const; */
+    float Area() const;
 
     std::optional<BvhIntersection> intersect(bvh::Ray<float> const & ray) const;
   };
@@ -0,0 +1,68 @@
+#include <monte-toad/core/aliastable.hpp>
+
+#include <algorithm>
+
+////////////////////////////////////////////////////////////////////////////////
+mt::core::AliasTable mt::core::AliasTable::Construct(
+  std::vector<float> const & weights
+) {
+  mt::core::AliasTable self;
+
+  double total = 0.0;
+  for (auto const weight : weights) { total += static_cast<double>(weight); }
+  if (total <= 0.0) { return self; }
+
+  size_t const size = weights.size();
+  self.probability.resize(size);
+  self.alias.resize(size);
+  self.pdf.resize(size);
+
+  // scale weights such that the average bin has a probability of 1, then
+  // split bins into those under & over the average (vose)
+  std::vector<double> scaled(size);
+  std::vector<size_t> small, large;
+  for (size_t idx = 0ul; idx < size; ++ idx) {
+    self.pdf[idx] = static_cast<float>(static_cast<double>(weights[idx])/total);
+    scaled[idx] =
+      static_cast<double>(weights[idx]) * static_cast<double>(size) / total;
+    (scaled[idx] < 1.0 ? small : large).emplace_back(idx);
+  }
+
+  // fill each small bin with the remainder of a large bin
+  while (small.size() > 0ul && large.size() > 0ul) {
+    size_t const smallIdx = small.back(); small.pop_back();
+    size_t const largeIdx = large.back(); large.pop_back();
+
+    self.probability[smallIdx] = static_cast<float>(scaled[smallIdx]);
+    self.alias[smallIdx] = largeIdx;
+
+    scaled[largeIdx] = (scaled[largeIdx] + scaled[smallIdx]) - 1.0;
+    (scaled[largeIdx] < 1.0 ? small : large).emplace_back(largeIdx);
+  }
+
+  // remaining bins are (within floating point error) exactly average
+  for (auto const idx : large) {
+    self.probability[idx] = 1.0f;
+    self.alias[idx] = idx;
+  }
+  for (auto const idx : small) {
+    self.probability[idx] = 1.0f;
+    self.alias[idx] = idx;
+  }
+
+  return self;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t mt::core::Sample(
+  mt::core::AliasTable const & self
+, float const uniform
+) {
+  float const scaled = uniform * static_cast<float>(self.alias.size());
+  size_t const idx =
+    std::min(static_cast<size_t>(scaled), self.alias.size() - 1ul);
+
+  // reuse the fractional part of the uniform to choose between bin & alias
+  return scaled - static_cast<float>(idx) < self.probability[idx]
+    ? idx : self.alias[idx];
+}
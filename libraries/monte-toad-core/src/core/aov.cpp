@@ -0,0 +1,183 @@
+#include <monte-toad/core/aov.hpp>
+
+#include <monte-toad/core/integratordata.hpp>
+#include <monte-toad/core/log.hpp>
+
+#include <algorithm>
+#include <atomic>
+
+namespace {
+
+void AtomicAdd(glm::vec3 & sum, glm::vec3 const & value) {
+  for (glm::length_t component = 0; component < 3; ++ component) {
+    std::atomic_ref<float>(sum[component])
+      .fetch_add(value[component], std::memory_order_relaxed);
+  }
+}
+
+void AtomicStore(glm::vec3 & sum, glm::vec3 const & value) {
+  for (glm::length_t component = 0; component < 3; ++ component) {
+    std::atomic_ref<float>(sum[component])
+      .store(value[component], std::memory_order_relaxed);
+  }
+}
+
+} // -- namespace
+
+////////////////////////////////////////////////////////////////////////////////
+size_t mt::core::RegisterAov(
+  mt::core::IntegratorData & self
+, std::string const & label
+, mt::AovType const type
+, mt::AovAccumulation const accumulation
+) {
+  if (auto const idx = mt::core::FindAov(self, label); idx != -1lu) {
+    if (
+        self.aovs[idx].type != type
+     || self.aovs[idx].accumulation != accumulation
+    ) {
+      spdlog::error(
+        "AOV '{}' registered again with a different type or accumulation"
+      , label
+      );
+    }
+    return idx;
+  }
+
+  auto & channel = self.aovs.emplace_back();
+  channel.label = label;
+  channel.type = type;
+  channel.accumulation = accumulation;
+
+  return self.aovs.size() - 1ul;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t mt::core::FindAov(
+  mt::core::IntegratorData const & self
+, std::string const & label
+) {
+  for (size_t idx = 0ul; idx < self.aovs.size(); ++ idx) {
+    if (self.aovs[idx].label == label) { return idx; }
+  }
+  return -1lu;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void mt::core::AllocateAovs(mt::core::IntegratorData & self) {
+  size_t const pixelLength = self.imageResolution.x * self.imageResolution.y;
+
+  for (auto & channel : self.aovs) {
+    channel.sum.resize(pixelLength);
+    channel.count.resize(pixelLength);
+
+    // only variance needs the squared samples
+    channel.sumSquared.resize(
+      channel.accumulation == mt::AovAccumulation::Variance ? pixelLength : 0ul
+    );
+  }
+
+  mt::core::ClearAovs(self);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void mt::core::ClearAovs(mt::core::IntegratorData & self) {
+  for (auto & channel : self.aovs) {
+    std::fill(channel.sum.begin(), channel.sum.end(), glm::vec3(0.0f));
+    std::fill(
+      channel.sumSquared.begin(), channel.sumSquared.end(), glm::vec3(0.0f)
+    );
+    std::fill(channel.count.begin(), channel.count.end(), 0u);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void mt::core::ResetAovSample(
+  mt::core::IntegratorData const & self
+, mt::core::AovSample & sample
+) {
+  sample.values.resize(self.aovs.size());
+  sample.written.assign(self.aovs.size(), 0u);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void mt::core::AccumulateAovSample(
+  mt::core::IntegratorData & self
+, size_t const pixelIdx
+, mt::core::AovSample const & sample
+) {
+  size_t const channels = glm::min(self.aovs.size(), sample.written.size());
+  for (size_t idx = 0ul; idx < channels; ++ idx) {
+    if (!sample.written[idx]) { continue; }
+
+    auto & channel = self.aovs[idx];
+    if (pixelIdx >= channel.sum.size()) { continue; }
+
+    glm::vec3 const & value = sample.values[idx];
+
+    switch (channel.accumulation) {
+      default: break;
+      case mt::AovAccumulation::Variance:
+        ::AtomicAdd(channel.sumSquared[pixelIdx], value*value);
+      [[fallthrough]];
+      case mt::AovAccumulation::Average:
+      case mt::AovAccumulation::Sum:
+        ::AtomicAdd(channel.sum[pixelIdx], value);
+      break;
+      case mt::AovAccumulation::Last:
+        ::AtomicStore(channel.sum[pixelIdx], value);
+      break;
+    }
+
+    std::atomic_ref<uint32_t>(channel.count[pixelIdx])
+      .fetch_add(1u, std::memory_order_relaxed);
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+glm::vec3 mt::core::ResolveAov(
+  mt::core::IntegratorData const & self
+, size_t const channelIdx
+, size_t const pixelIdx
+) {
+  auto const & channel = self.aovs[channelIdx];
+  auto const count = static_cast<float>(channel.count[pixelIdx]);
+
+  switch (channel.accumulation) {
+    default: return glm::vec3(0.0f);
+    case mt::AovAccumulation::Sum:
+    case mt::AovAccumulation::Last:
+      return channel.sum[pixelIdx];
+    case mt::AovAccumulation::Average:
+      return count > 0.0f ? channel.sum[pixelIdx] / count : glm::vec3(0.0f);
+    case mt::AovAccumulation::Variance: {
+      if (count <= 1.0f) { return glm::vec3(0.0f); }
+
+      // unbiased sample variance, over the amount of samples for the variance
+      // of their mean
+      glm::vec3 const mean = channel.sum[pixelIdx] / count;
+      glm::vec3 const variance =
+        (channel.sumSquared[pixelIdx] / count - mean*mean)
+      * (count / (count - 1.0f));
+
+      return glm::max(variance, glm::vec3(0.0f)) / count;
+    }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+glm::vec3 mt::core::ResolvePixel(
+  mt::core::IntegratorData const & self
+, size_t const pixelIdx
+) {
+  if (self.displayedAov < self.aovs.size()) {
+    return mt::core::ResolveAov(self, self.displayedAov, pixelIdx);
+  }
+
+  auto const pixelCount = self.pixelCountBuffer[pixelIdx];
+  if (pixelCount == 0u) { return glm::vec3(0.0f); }
+
+  return
+    mt::core::AccumulatedColor(self, pixelIdx)
+  / static_cast<float>(pixelCount);
+}
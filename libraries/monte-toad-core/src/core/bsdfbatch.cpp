@@ -0,0 +1,60 @@
+#include <monte-toad/core/bsdfbatch.hpp>
+
+#include <monte-toad/core/surfaceinfo.hpp>
+
+////////////////////////////////////////////////////////////////////////////////
+void mt::core::SurfaceBatchStorage::Clear() {
+  this->normal.clear();
+  this->incomingAngle.clear();
+  this->uvcoord.clear();
+  this->uvFootprint.clear();
+  this->indexOfRefraction.clear();
+  this->distance.clear();
+  this->sameMedium.clear();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void mt::core::SurfaceBatchStorage::Push(
+  mt::core::SurfaceInfo const & surface
+, float const ior
+) {
+  this->normal.emplace_back(surface.normal);
+  this->incomingAngle.emplace_back(surface.incomingAngle);
+  this->uvcoord.emplace_back(surface.uvcoord);
+  this->uvFootprint.emplace_back(surface.uvFootprint);
+  this->indexOfRefraction.emplace_back(ior);
+  this->distance.emplace_back(surface.distance);
+  this->sameMedium.emplace_back(
+      surface.previousSurface
+   && surface.previousSurface->material == surface.material
+  );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+mt::core::SurfaceBatch mt::core::SurfaceBatchStorage::View() const {
+  mt::core::SurfaceBatch batch;
+  batch.normal = make_span(this->normal);
+  batch.incomingAngle = make_span(this->incomingAngle);
+  batch.uvcoord = make_span(this->uvcoord);
+  batch.uvFootprint = make_span(this->uvFootprint);
+  batch.indexOfRefraction = make_span(this->indexOfRefraction);
+  batch.distance = make_span(this->distance);
+  batch.sameMedium = make_span(this->sameMedium);
+  return batch;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void mt::core::BsdfBatchStorage::Resize(size_t const size) {
+  this->wo.resize(size);
+  this->fs.resize(size);
+  this->pdf.resize(size);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+mt::core::BsdfBatch mt::core::BsdfBatchStorage::View() {
+  mt::core::BsdfBatch batch;
+  batch.wo = make_span(this->wo);
+  batch.fs = make_span(this->fs);
+  batch.pdf = make_span(this->pdf);
+  return batch;
+}
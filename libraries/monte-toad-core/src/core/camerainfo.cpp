@@ -3,6 +3,19 @@
 #include <monte-toad/core/renderinfo.hpp>
 #include <mt-plugin/plugin.hpp>
 
+////////////////////////////////////////////////////////////////////////////////
+float mt::core::PixelSpreadAngle(
+  mt::core::CameraInfo const & camera
+, glm::u16vec2 const & imageResolution
+) {
+  return
+    glm::atan(
+      2.0f * glm::tan(glm::radians(camera.fieldOfView)*0.5f)
+    / static_cast<float>(glm::max(imageResolution.y, uint16_t{1}))
+    );
+}
+
+////////////////////////////////////////////////////////////////////////////////
 void mt::core::UpdateCamera(
   mt::PluginInfo const & plugin
 , mt::core::RenderInfo & render
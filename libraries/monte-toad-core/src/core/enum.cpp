@@ -38,6 +38,21 @@ mt::AspectRatio mt::ToAspectRatio(char const * label) {
   return mt::AspectRatio::e4_3;
 }
 
+mt::RussianRoulette mt::ToRussianRoulette(char const * label) {
+  auto fixLabel = std::string{label};
+  for (auto & c : fixLabel) { c = static_cast<char>(::tolower(c)); }
+
+  if (fixLabel == "off")        { return mt::RussianRoulette::Off;        }
+  if (fixLabel == "throughput") { return mt::RussianRoulette::Throughput; }
+  if (fixLabel == "adjoint")    { return mt::RussianRoulette::Adjoint;    }
+
+  spdlog::error(
+    "unknown russian roulette '{}', defaulting to throughput", label
+  );
+
+  return mt::RussianRoulette::Throughput;
+}
+
 void mt::ApplyAspectRatioY(
   mt::AspectRatio ratio
 , uint16_t const x, uint16_t & y
@@ -74,3 +89,22 @@ char const * mt::ToString(mt::KernelDispatchTiming timing) {
     case mt::KernelDispatchTiming::Last:    return "Last";
   }
 }
+
+char const * mt::ToString(mt::RussianRoulette roulette) {
+  switch (roulette) {
+    default: return "";
+    case mt::RussianRoulette::Off:        return "Off";
+    case mt::RussianRoulette::Throughput: return "Throughput";
+    case mt::RussianRoulette::Adjoint:    return "Adjoint";
+  }
+}
+
+char const * mt::ToString(mt::AovAccumulation accumulation) {
+  switch (accumulation) {
+    default: return "";
+    case mt::AovAccumulation::Average:  return "Average";
+    case mt::AovAccumulation::Sum:      return "Sum";
+    case mt::AovAccumulation::Variance: return "Variance";
+    case mt::AovAccumulation::Last:     return "Last";
+  }
+}
@@ -22,7 +22,7 @@ glm::vec3 ReorientHemisphere(glm::vec3 wo, glm::vec3 normal) {
 
 //------------------------------------------------------------------------------
 glm::vec3 Cartesian(float cosTheta, float phi) {
-  float sinTheta = glm::sqrt(glm::max(0.0f, 1.0f - cosTheta));
+  float sinTheta = glm::sqrt(glm::max(0.0f, 1.0f - cosTheta*cosTheta));
   return glm::vec3(glm::cos(phi)*sinTheta, glm::sin(phi)*sinTheta, cosTheta);
 }
 
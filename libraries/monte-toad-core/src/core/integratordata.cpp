@@ -8,3 +8,14 @@ auto mt::core::IntegratorData::HasPreview() -> bool {
    && this->kernelDispatchers.back().timing == mt::KernelDispatchTiming::Preview
  ;
 }
+
+glm::vec3 mt::core::AccumulatedColor(
+  mt::core::IntegratorData const & self
+, size_t const pixelIdx
+) {
+  // the compensation holds the low-order bits that were lost from the sum
+  return
+    self.accumulatedColorBuffer[pixelIdx]
+  - self.accumulatedColorCompensationBuffer[pixelIdx]
+  ;
+}
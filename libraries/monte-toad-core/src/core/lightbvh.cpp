@@ -0,0 +1,273 @@
+#include <monte-toad/core/lightbvh.hpp>
+
+#include <monte-toad/core/math.hpp>
+
+#include <algorithm>
+
+namespace {
+
+struct BuildPrimitive {
+  mt::core::LightBvhPrimitive primitive;
+  glm::vec3 centroid;
+  size_t idx;
+};
+
+// merges two double-sided cones into a single cone bounding both
+void ConeUnion(
+  glm::vec3 axisA, float thetaA
+, glm::vec3 axisB, float thetaB
+, glm::vec3 & axis, float & theta
+) {
+  // cones are double-sided, so the axis of b can be flipped towards a
+  if (glm::dot(axisA, axisB) < 0.0f) { axisB = -axisB; }
+
+  if (thetaB > thetaA) {
+    std::swap(axisA, axisB);
+    std::swap(thetaA, thetaB);
+  }
+
+  float const thetaD =
+    glm::acos(glm::clamp(glm::dot(axisA, axisB), -1.0f, 1.0f));
+
+  // b is already contained in a
+  if (glm::min(thetaD + thetaB, glm::Pi) <= thetaA) {
+    axis = axisA; theta = thetaA;
+    return;
+  }
+
+  // a double-sided cone of half a pi bounds every direction
+  theta = 0.5f*(thetaA + thetaD + thetaB);
+  if (theta >= 0.5f*glm::Pi) {
+    axis = axisA; theta = 0.5f*glm::Pi;
+    return;
+  }
+
+  // rotate a towards b, such that the cone just covers both
+  glm::vec3 const ortho = axisB - glm::dot(axisA, axisB)*axisA;
+  if (glm::dot(ortho, ortho) <= 0.0f) { axis = axisA; return; }
+
+  float const thetaR = theta - thetaA;
+  axis =
+    glm::normalize(
+      glm::cos(thetaR)*axisA + glm::sin(thetaR)*glm::normalize(ortho)
+    );
+}
+
+mt::core::LightBvhNode Union(
+  mt::core::LightBvhNode const & a
+, mt::core::LightBvhNode const & b
+) {
+  mt::core::LightBvhNode node;
+  node.boundsMin = glm::min(a.boundsMin, b.boundsMin);
+  node.boundsMax = glm::max(a.boundsMax, b.boundsMax);
+  node.power = a.power + b.power;
+  node.thetaE = glm::max(a.thetaE, b.thetaE);
+  ::ConeUnion(a.axis, a.thetaO, b.axis, b.thetaO, node.axis, node.thetaO);
+  return node;
+}
+
+size_t Build(
+  mt::core::LightBvh & self
+, std::vector<::BuildPrimitive> & primitives
+, size_t const begin, size_t const end
+, size_t const depth
+, uint64_t const trail
+) {
+  size_t const nodeIdx = self.nodes.size();
+  self.nodes.emplace_back();
+
+  if (end - begin == 1ul) {
+    auto const & primitive = primitives[begin];
+    auto & node = self.nodes[nodeIdx];
+    node.boundsMin = primitive.primitive.boundsMin;
+    node.boundsMax = primitive.primitive.boundsMax;
+    node.axis = primitive.primitive.axis;
+    node.thetaO = 0.0f;
+    node.thetaE = 0.5f*glm::Pi;
+    node.power = primitive.primitive.power;
+    node.primitive = primitive.idx;
+    self.primitiveTrail[primitive.idx] = trail;
+    return nodeIdx;
+  }
+
+  // split at the median centroid of the largest axis
+  glm::vec3 centroidMin = primitives[begin].centroid;
+  glm::vec3 centroidMax = primitives[begin].centroid;
+  for (size_t idx = begin; idx < end; ++ idx) {
+    centroidMin = glm::min(centroidMin, primitives[idx].centroid);
+    centroidMax = glm::max(centroidMax, primitives[idx].centroid);
+  }
+
+  glm::vec3 const extent = centroidMax - centroidMin;
+  int const axis =
+      extent.x > extent.y && extent.x > extent.z ? 0
+    : extent.y > extent.z ? 1 : 2
+  ;
+
+  size_t const mid = (begin + end) / 2ul;
+  std::nth_element(
+    primitives.begin() + begin, primitives.begin() + mid
+  , primitives.begin() + end
+  , [axis](::BuildPrimitive const & a, ::BuildPrimitive const & b) {
+      return a.centroid[axis] < b.centroid[axis];
+    }
+  );
+
+  size_t const left = ::Build(self, primitives, begin, mid, depth+1, trail);
+  size_t const right =
+    ::Build(self, primitives, mid, end, depth+1, trail | (1ul << depth));
+
+  // nodes may have been reallocated, so only reference them now
+  auto node = ::Union(self.nodes[left], self.nodes[right]);
+  node.rightChild = right;
+  self.nodes[nodeIdx] = node;
+
+  return nodeIdx;
+}
+
+// estimates the contribution of the lights of a node to the shading point
+float Importance(
+  mt::core::LightBvhNode const & node
+, glm::vec3 const & origin, glm::vec3 const & normal
+) {
+  glm::vec3 const center = 0.5f*(node.boundsMin + node.boundsMax);
+  float const radius = 0.5f*glm::length(node.boundsMax - node.boundsMin);
+
+  glm::vec3 const toCenter = center - origin;
+  float const distanceSqr = glm::dot(toCenter, toCenter);
+
+  // shading point is within the bounds, so every direction is possible
+  if (distanceSqr <= radius*radius) {
+    return node.power / glm::max(distanceSqr, 0.25f*radius*radius);
+  }
+
+  glm::vec3 const wi = toCenter / glm::sqrt(distanceSqr);
+
+  // angle the bounds subtend from the shading point
+  float const thetaU =
+    glm::asin(glm::min(1.0f, radius/glm::sqrt(distanceSqr)));
+
+  // angle between emission normals & the shading point
+  float const theta =
+    glm::acos(glm::min(1.0f, glm::abs(glm::dot(node.axis, wi))));
+  float const thetaP = glm::max(0.0f, theta - node.thetaO - thetaU);
+  if (thetaP >= node.thetaE) { return 0.0f; }
+
+  // angle between the shading normal & the lights, either hemisphere is
+  // accepted as the surface could be transmittive
+  float cosThetaI = 1.0f;
+  if (glm::dot(normal, normal) > 0.0f) {
+    float const thetaI =
+      glm::acos(glm::min(1.0f, glm::abs(glm::dot(normal, wi))));
+    cosThetaI = glm::cos(glm::max(0.0f, thetaI - thetaU));
+  }
+
+  return node.power * glm::cos(thetaP) * cosThetaI / distanceSqr;
+}
+
+} // -- namespace
+
+////////////////////////////////////////////////////////////////////////////////
+mt::core::LightBvh mt::core::LightBvh::Construct(
+  std::vector<mt::core::LightBvhPrimitive> const & primitives
+) {
+  mt::core::LightBvh self;
+  if (primitives.size() == 0ul) { return self; }
+
+  std::vector<::BuildPrimitive> buildPrimitives;
+  buildPrimitives.reserve(primitives.size());
+  for (size_t idx = 0ul; idx < primitives.size(); ++ idx) {
+    auto const & primitive = primitives[idx];
+    buildPrimitives.emplace_back(::BuildPrimitive {
+      primitive, 0.5f*(primitive.boundsMin + primitive.boundsMax), idx
+    });
+  }
+
+  self.nodes.reserve(primitives.size()*2ul - 1ul);
+  self.primitiveTrail.resize(primitives.size());
+  ::Build(self, buildPrimitives, 0ul, buildPrimitives.size(), 0ul, 0ul);
+
+  return self;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t mt::core::Sample(
+  mt::core::LightBvh const & self
+, glm::vec3 const & origin, glm::vec3 const & normal
+, float uniform
+, float & pdf
+) {
+  pdf = 0.0f;
+  if (!self.Valid()) { return -1lu; }
+
+  pdf = 1.0f;
+  size_t nodeIdx = 0ul;
+  while (!self.nodes[nodeIdx].Leaf()) {
+    size_t const
+      left  = nodeIdx + 1ul
+    , right = self.nodes[nodeIdx].rightChild
+    ;
+
+    float const
+      importanceLeft  = ::Importance(self.nodes[left],  origin, normal)
+    , importanceRight = ::Importance(self.nodes[right], origin, normal)
+    ;
+
+    if (importanceLeft + importanceRight <= 0.0f) { pdf = 0.0f; return -1lu; }
+
+    // choose a child & rescale the uniform so it can be reused
+    float const probabilityLeft =
+      importanceLeft / (importanceLeft + importanceRight);
+
+    if (uniform < probabilityLeft) {
+      nodeIdx = left;
+      pdf *= probabilityLeft;
+      uniform = uniform / probabilityLeft;
+    } else {
+      nodeIdx = right;
+      pdf *= 1.0f - probabilityLeft;
+      uniform = (uniform - probabilityLeft) / (1.0f - probabilityLeft);
+    }
+
+    uniform = glm::min(uniform, 0.99999994f);
+  }
+
+  return self.nodes[nodeIdx].primitive;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+float mt::core::Pdf(
+  mt::core::LightBvh const & self
+, glm::vec3 const & origin, glm::vec3 const & normal
+, size_t const primitive
+) {
+  if (primitive >= self.primitiveTrail.size()) { return 0.0f; }
+
+  uint64_t const trail = self.primitiveTrail[primitive];
+
+  float pdf = 1.0f;
+  size_t nodeIdx = 0ul, depth = 0ul;
+  while (!self.nodes[nodeIdx].Leaf()) {
+    size_t const
+      left  = nodeIdx + 1ul
+    , right = self.nodes[nodeIdx].rightChild
+    ;
+
+    float const
+      importanceLeft  = ::Importance(self.nodes[left],  origin, normal)
+    , importanceRight = ::Importance(self.nodes[right], origin, normal)
+    ;
+
+    if (importanceLeft + importanceRight <= 0.0f) { return 0.0f; }
+
+    bool const takeRight = (trail >> depth) & 1ul;
+    pdf *=
+      (takeRight ? importanceRight : importanceLeft)
+    / (importanceLeft + importanceRight);
+
+    nodeIdx = takeRight ? right : left;
+    ++ depth;
+  }
+
+  return pdf;
+}
@@ -0,0 +1,312 @@
+#include <monte-toad/core/microfacet.hpp>
+
+#include <monte-toad/core/geometry.hpp>
+
+#include <vector>
+
+namespace {
+
+// -- albedo lookup tables; the incoming angle is tabulated over its cosine &
+//    the roughness over the square root of alpha, as the albedo changes the
+//    most at grazing angles & low roughness
+constexpr size_t
+  tableCosThetaSize = 32ul
+, tableAlphaSize = 32ul
+, tableEtaSize = 16ul
+
+  // stratified samples integrating each entry of the tables
+, integrationStrata = 16ul
+;
+
+constexpr float tableEtaMax = 3.0f;
+
+// cosines of exactly 0 have no visible microfacets
+constexpr float tableMinCosTheta = 1e-3f;
+
+float TableCosTheta(size_t const idx) {
+  return
+    glm::max(
+      ::tableMinCosTheta
+    , static_cast<float>(idx) / static_cast<float>(::tableCosThetaSize - 1ul)
+    );
+}
+
+float TableAlpha(size_t const idx) {
+  float const roughness =
+    static_cast<float>(idx) / static_cast<float>(::tableAlphaSize - 1ul);
+  return glm::max(mt::core::ggxMinAlpha, roughness*roughness);
+}
+
+// eta is tabulated logarithmically, so it's as dense below 1 as above it
+float TableEta(size_t const idx) {
+  float const t =
+    static_cast<float>(idx) / static_cast<float>(::tableEtaSize - 1ul);
+  return glm::pow(::tableEtaMax, 2.0f*t - 1.0f);
+}
+
+// continuous coordinates of a lookup into the tables
+float CosThetaCoord(float const cosTheta) {
+  return
+    glm::clamp(cosTheta, 0.0f, 1.0f)
+  * static_cast<float>(::tableCosThetaSize - 1ul);
+}
+
+float AlphaCoord(float const alpha) {
+  return
+    glm::sqrt(glm::clamp(alpha, 0.0f, 1.0f))
+  * static_cast<float>(::tableAlphaSize - 1ul);
+}
+
+float EtaCoord(float const eta) {
+  float const t =
+    0.5f * (glm::log(eta) / glm::log(::tableEtaMax) + 1.0f);
+  return
+    glm::clamp(t, 0.0f, 1.0f) * static_cast<float>(::tableEtaSize - 1ul);
+}
+
+// lower index & interpolant of a continuous coordinate
+struct TableCoord {
+  size_t idx;
+  float t;
+};
+
+::TableCoord Split(float const coord, size_t const size) {
+  size_t const idx = glm::min(static_cast<size_t>(coord), size - 2ul);
+  return { idx, coord - static_cast<float>(idx) };
+}
+
+// averages the estimator over stratified visible normals
+template <typename Fn> float Integrate(
+  float const cosTheta
+, float const alpha
+, Fn && estimator
+) {
+  glm::vec3 const wi =
+    glm::vec3(glm::sqrt(1.0f - cosTheta*cosTheta), 0.0f, cosTheta);
+
+  float sum = 0.0f;
+  for (size_t x = 0ul; x < ::integrationStrata; ++ x)
+  for (size_t y = 0ul; y < ::integrationStrata; ++ y) {
+    glm::vec2 const u =
+      (glm::vec2(x, y) + glm::vec2(0.5f))
+    / static_cast<float>(::integrationStrata);
+
+    sum +=
+      estimator(wi, mt::core::GgxSampleVisibleNormal(wi, alpha, u));
+  }
+
+  return sum / static_cast<float>(::integrationStrata*::integrationStrata);
+}
+
+// the estimators are fs/pdf of sampling the visible normals, which is the
+// shadowing of wo over the masking of wi
+std::vector<float> BuildReflectionTable() {
+  std::vector<float> table(::tableCosThetaSize * ::tableAlphaSize);
+
+  for (size_t alphaIdx = 0ul; alphaIdx < ::tableAlphaSize; ++ alphaIdx)
+  for (size_t cosIdx = 0ul; cosIdx < ::tableCosThetaSize; ++ cosIdx) {
+    float const alpha = ::TableAlpha(alphaIdx);
+    table[alphaIdx*::tableCosThetaSize + cosIdx] =
+      ::Integrate(
+        ::TableCosTheta(cosIdx), alpha
+      , [alpha](glm::vec3 const & wi, glm::vec3 const & h) {
+          glm::vec3 const wo = glm::reflect(-wi, h);
+          if (wo.z <= 0.0f) { return 0.0f; }
+          return
+            mt::core::GgxG2(wi, wo, alpha) / mt::core::GgxG1(wi, alpha);
+        }
+      );
+  }
+
+  return table;
+}
+
+std::vector<float> BuildTransmissionTable() {
+  std::vector<float> table(
+    ::tableCosThetaSize * ::tableAlphaSize * ::tableEtaSize
+  );
+
+  for (size_t etaIdx = 0ul; etaIdx < ::tableEtaSize; ++ etaIdx)
+  for (size_t alphaIdx = 0ul; alphaIdx < ::tableAlphaSize; ++ alphaIdx)
+  for (size_t cosIdx = 0ul; cosIdx < ::tableCosThetaSize; ++ cosIdx) {
+    float const alpha = ::TableAlpha(alphaIdx), eta = ::TableEta(etaIdx);
+    table[
+      (etaIdx*::tableAlphaSize + alphaIdx)*::tableCosThetaSize + cosIdx
+    ] =
+      ::Integrate(
+        ::TableCosTheta(cosIdx), alpha
+      , [alpha, eta](glm::vec3 const & wi, glm::vec3 const & h) {
+          glm::vec3 const wo = glm::refract(-wi, h, eta);
+          if (wo.z >= 0.0f) { return 0.0f; } // includes internal reflection
+          return
+            mt::core::GgxG2(wi, wo, alpha) / mt::core::GgxG1(wi, alpha);
+        }
+      );
+  }
+
+  return table;
+}
+
+} // -- namespace
+
+////////////////////////////////////////////////////////////////////////////////
+glm::vec3 mt::core::MicrofacetFrame::ToLocal(glm::vec3 const & v) const {
+  return
+    glm::vec3(
+      glm::dot(v, this->tangent)
+    , glm::dot(v, this->binormal)
+    , glm::dot(v, this->normal)
+    );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+glm::vec3 mt::core::MicrofacetFrame::ToWorld(glm::vec3 const & v) const {
+  return this->tangent*v.x + this->binormal*v.y + this->normal*v.z;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+mt::core::MicrofacetFrame mt::core::MicrofacetFrame::Construct(
+  glm::vec3 const & normal
+) {
+  // same basis as ReorientHemisphere
+  auto const [tangent, binormal] = OrthogonalVectors(normal);
+
+  mt::core::MicrofacetFrame frame;
+  frame.tangent = tangent;
+  frame.binormal = binormal;
+  frame.normal = normal;
+  return frame;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+float mt::core::GgxD(glm::vec3 const & h, float const alpha) {
+  if (h.z <= 0.0f) { return 0.0f; }
+
+  float const
+    alpha2 = alpha*alpha
+  , denom = h.z*h.z*(alpha2 - 1.0f) + 1.0f
+  ;
+  return alpha2 / (glm::Pi * denom*denom);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+float mt::core::GgxLambda(glm::vec3 const & w, float const alpha) {
+  float const cos2Theta = w.z*w.z;
+  if (cos2Theta <= 0.0f) { return 0.0f; }
+
+  float const tan2Theta = glm::max(0.0f, 1.0f - cos2Theta) / cos2Theta;
+  return 0.5f * (glm::sqrt(1.0f + alpha*alpha*tan2Theta) - 1.0f);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+float mt::core::GgxG1(glm::vec3 const & w, float const alpha) {
+  return 1.0f / (1.0f + mt::core::GgxLambda(w, alpha));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+float mt::core::GgxG2(
+  glm::vec3 const & wi
+, glm::vec3 const & wo
+, float const alpha
+) {
+  return
+    1.0f
+  / (1.0f + mt::core::GgxLambda(wi, alpha) + mt::core::GgxLambda(wo, alpha));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+glm::vec3 mt::core::GgxSampleVisibleNormal(
+  glm::vec3 const & wi
+, float const alpha
+, glm::vec2 const & u
+) {
+  // stretch the view direction to the hemisphere configuration
+  glm::vec3 const vh = glm::normalize(glm::vec3(alpha*wi.x, alpha*wi.y, wi.z));
+
+  // orthonormal basis around it
+  float const lengthSqr = vh.x*vh.x + vh.y*vh.y;
+  glm::vec3 const t1 =
+      lengthSqr > 0.0f
+    ? glm::vec3(-vh.y, vh.x, 0.0f) / glm::sqrt(lengthSqr)
+    : glm::vec3(1.0f, 0.0f, 0.0f);
+  glm::vec3 const t2 = glm::cross(vh, t1);
+
+  // sample the projected area of the visible hemisphere
+  float const
+    r = glm::sqrt(u.x)
+  , phi = glm::Tau * u.y
+  , p1 = r*glm::cos(phi)
+  , s = 0.5f*(1.0f + vh.z)
+  , p2 = (1.0f - s)*glm::sqrt(glm::max(0.0f, 1.0f - p1*p1)) + s*r*glm::sin(phi)
+  ;
+
+  glm::vec3 const nh =
+    p1*t1 + p2*t2 + glm::sqrt(glm::max(0.0f, 1.0f - p1*p1 - p2*p2))*vh;
+
+  // unstretch back to the ellipsoid configuration
+  return
+    glm::normalize(glm::vec3(alpha*nh.x, alpha*nh.y, glm::max(0.0f, nh.z)));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+float mt::core::GgxVisibleNormalPdf(
+  glm::vec3 const & wi
+, glm::vec3 const & h
+, float const alpha
+) {
+  if (wi.z <= 0.0f) { return 0.0f; }
+  return
+    mt::core::GgxG1(wi, alpha) * glm::max(0.0f, glm::dot(wi, h))
+  * mt::core::GgxD(h, alpha) / wi.z;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+float mt::core::GgxReflectionAlbedo(float const cosTheta, float const alpha) {
+  static std::vector<float> const table = ::BuildReflectionTable();
+
+  auto const c = ::Split(::CosThetaCoord(cosTheta), ::tableCosThetaSize);
+  auto const a = ::Split(::AlphaCoord(alpha), ::tableAlphaSize);
+
+  auto const entry = [&](size_t const cosIdx, size_t const alphaIdx) {
+    return table[alphaIdx*::tableCosThetaSize + cosIdx];
+  };
+
+  return
+    glm::mix(
+      glm::mix(entry(c.idx, a.idx), entry(c.idx+1ul, a.idx), c.t)
+    , glm::mix(entry(c.idx, a.idx+1ul), entry(c.idx+1ul, a.idx+1ul), c.t)
+    , a.t
+    );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+float mt::core::GgxTransmissionAlbedo(
+  float const cosTheta
+, float const alpha
+, float const eta
+) {
+  static std::vector<float> const table = ::BuildTransmissionTable();
+
+  auto const c = ::Split(::CosThetaCoord(cosTheta), ::tableCosThetaSize);
+  auto const a = ::Split(::AlphaCoord(alpha), ::tableAlphaSize);
+  auto const e = ::Split(::EtaCoord(eta), ::tableEtaSize);
+
+  // bilinear interpolation of the cosine & alpha in an eta slice
+  auto const slice = [&](size_t const etaIdx) {
+    auto const entry = [&](size_t const cosIdx, size_t const alphaIdx) {
+      return
+        table[
+          (etaIdx*::tableAlphaSize + alphaIdx)*::tableCosThetaSize + cosIdx
+        ];
+    };
+
+    return
+      glm::mix(
+        glm::mix(entry(c.idx, a.idx), entry(c.idx+1ul, a.idx), c.t)
+      , glm::mix(entry(c.idx, a.idx+1ul), entry(c.idx+1ul, a.idx+1ul), c.t)
+      , a.t
+      );
+  };
+
+  return glm::mix(slice(e.idx), slice(e.idx+1ul), e.t);
+}
@@ -5,9 +5,124 @@
 #include <mt-plugin/plugin.hpp>
 
 #include <glad/glad.hpp>
+#include <glm/gtc/packing.hpp>
+
+#include <cstring>
 
 namespace {
 
+size_t TexelByteSize(mt::core::IntegratorData const & self) {
+  return self.halfFloatTexture ? 3ul*sizeof(uint16_t) : sizeof(glm::vec3);
+}
+
+void AllocateTexture(
+  mt::core::GlTexture & texture
+, mt::core::GlBuffer & pixelUnpackBuffer
+, mt::core::IntegratorData const & self
+) {
+  auto const & resolution = self.imageResolution;
+
+  texture.Construct(GL_TEXTURE_2D);
+  glTexImage2D(
+    GL_TEXTURE_2D
+  , 0
+  , self.halfFloatTexture ? GL_RGB16F : GL_RGB32F
+  , resolution.x, resolution.y
+  , 0, GL_RGB, GL_FLOAT
+  , nullptr
+  );
+
+  { // -- set parameters
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+  }
+
+  // the unpack buffer mirrors the image layout, so a region can be written to
+  // its own offset without waiting on uploads of other regions
+  pixelUnpackBuffer.Construct(
+    GL_PIXEL_UNPACK_BUFFER
+  , resolution.x*resolution.y*::TexelByteSize(self)
+  , GL_STREAM_DRAW
+  );
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
+// uploads only the region [min, max) of the image to the texture
+void UploadRegion(
+  mt::core::GlTexture const & texture
+, mt::core::GlBuffer const & pixelUnpackBuffer
+, mt::core::IntegratorData const & self
+, std::vector<glm::vec3> const & image
+, size_t minX, size_t maxX, size_t minY, size_t maxY
+) {
+  auto const & resolution = self.imageResolution;
+
+  maxX = glm::min(maxX, static_cast<size_t>(resolution.x));
+  maxY = glm::min(maxY, static_cast<size_t>(resolution.y));
+  if (minX >= maxX || minY >= maxY) { return; }
+  if (image.size() != resolution.x*resolution.y) { return; }
+
+  size_t const
+    width = maxX - minX
+  , height = maxY - minY
+  , texelSize = ::TexelByteSize(self)
+  , offset = (minY*resolution.x + minX)*texelSize
+  , length = ((height-1ul)*resolution.x + width)*texelSize
+  ;
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, pixelUnpackBuffer.handle);
+
+  auto mapped =
+    reinterpret_cast<uint8_t *>(
+      glMapBufferRange(
+        GL_PIXEL_UNPACK_BUFFER, offset, length
+      , GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_RANGE_BIT
+      )
+    );
+
+  if (!mapped) {
+    spdlog::error("Could not map pixel unpack buffer");
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    return;
+  }
+
+  for (size_t y = 0ul; y < height; ++ y) {
+    size_t const imageIdx = (minY + y)*resolution.x + minX;
+    uint8_t * row = mapped + y*resolution.x*texelSize;
+
+    if (!self.halfFloatTexture) {
+      std::memcpy(row, image.data() + imageIdx, width*sizeof(glm::vec3));
+      continue;
+    }
+
+    auto rowHalf = reinterpret_cast<uint16_t *>(row);
+    for (size_t x = 0ul; x < width; ++ x)
+    for (glm::length_t component = 0; component < 3; ++ component) {
+      rowHalf[x*3ul + component] =
+        glm::packHalf1x16(image[imageIdx + x][component]);
+    }
+  }
+
+  glUnmapBuffer(GL_PIXEL_UNPACK_BUFFER);
+
+  glBindTexture(GL_TEXTURE_2D, texture.handle);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, self.halfFloatTexture ? 2 : 4);
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, resolution.x);
+  glTexSubImage2D(
+    GL_TEXTURE_2D
+  , 0
+  , minX, minY, width, height
+  , GL_RGB, self.halfFloatTexture ? GL_HALF_FLOAT : GL_FLOAT
+  , reinterpret_cast<void const *>(offset)
+  );
+  glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+  glPixelStorei(GL_UNPACK_ALIGNMENT, 4);
+
+  glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+}
+
 } // anon namespace
 
 void mt::core::Clear(mt::core::IntegratorData & self) {
@@ -17,6 +132,18 @@ void mt::core::Clear(mt::core::IntegratorData & self) {
   , 0
   );
 
+  std::fill(
+    self.accumulatedColorBuffer.begin()
+  , self.accumulatedColorBuffer.end()
+  , glm::vec3(0.0f)
+  );
+
+  std::fill(
+    self.accumulatedColorCompensationBuffer.begin()
+  , self.accumulatedColorCompensationBuffer.end()
+  , glm::vec3(0.0f)
+  );
+
   std::fill(
     self.mappedImageTransitionBuffer.begin()
   , self.mappedImageTransitionBuffer.end()
@@ -35,6 +162,8 @@ void mt::core::Clear(mt::core::IntegratorData & self) {
     imagePtrs = {};
   }
 
+  mt::core::ClearAovs(self);
+
   self.dispatchedCycles = 0;
   self.bufferCleared = true;
   self.blockIterator = 0ul;
@@ -43,6 +172,9 @@ void mt::core::Clear(mt::core::IntegratorData & self) {
   self.fillBlockLayer = 1ul; self.fillBlockLeg = 0ul;
   self.previewDispatch = true;
 
+  // primary hits, and thus the material sorted orders, can change
+  self.shadingOrders.clear();
+
   // clear block samples
   self.blockPixelsFinished.resize(mt::core::BlockIteratorMax(self));
   std::fill(
@@ -86,31 +218,24 @@ size_t mt::core::BlockIteratorMax(mt::core::IntegratorData & self) {
 
 void mt::core::DispatchImageCopy(
   mt::core::IntegratorData & self
-, size_t, size_t, size_t, size_t
+, size_t minX, size_t maxX, size_t minY, size_t maxY
 ) {
-  glBindTexture(GL_TEXTURE_2D, self.renderedTexture.handle);
-  glTexImage2D(
-    GL_TEXTURE_2D
-  , 0
-  , GL_RGB32F
-  , self.imageResolution.x, self.imageResolution.y
-  , 0, GL_RGB, GL_FLOAT
-  , self.mappedImageTransitionBuffer.data()
+  ::UploadRegion(
+    self.renderedTexture, self.renderedPixelUnpackBuffer
+  , self, self.mappedImageTransitionBuffer
+  , minX, maxX, minY, maxY
   );
 
+  // previews are generated over the entire image
   if (
       !self.realtime
     && self.generatePreviewOutput
     && self.HasPreview()
   ) {
-    glBindTexture(GL_TEXTURE_2D, self.previewRenderedTexture.handle);
-    glTexImage2D(
-      GL_TEXTURE_2D
-    , 0
-    , GL_RGB32F
-    , self.imageResolution.x, self.imageResolution.y
-    , 0, GL_RGB, GL_FLOAT
-    , self.previewMappedImageTransitionBuffer.data()
+    ::UploadRegion(
+      self.previewRenderedTexture, self.previewPixelUnpackBuffer
+    , self, self.previewMappedImageTransitionBuffer
+    , 0ul, self.imageResolution.x, 0ul, self.imageResolution.y
     );
   }
 }
@@ -136,47 +261,41 @@ void mt::core::AllocateResources(
     self.previewMappedImageTransitionBuffer.resize(imagePixelLength);
   }
 
+  self.accumulatedColorBuffer.resize(imagePixelLength);
+  self.accumulatedColorCompensationBuffer.resize(imagePixelLength);
   self.pixelCountBuffer.resize(imagePixelLength);
 
-  // -- construct texture
-  self.renderedTexture.Construct(GL_TEXTURE_2D);
-
-  // generate texture memory
-  glBindTexture(GL_TEXTURE_2D, self.renderedTexture.handle);
-  glTexImage2D(
-    GL_TEXTURE_2D
-  , 0
-  , GL_RGB32F
-  , self.imageResolution.x, self.imageResolution.y
-  , 0, GL_RGB, GL_FLOAT
-  , nullptr
-  );
+  self.channelCount =
+    plugin.integrators[pluginIdx].ChannelCount
+      ? plugin.integrators[pluginIdx].ChannelCount() : 0ul;
+  self.channelBuffer.resize(imagePixelLength*self.channelCount);
+  self.displayedChannel =
+    glm::min(self.displayedChannel, glm::max(self.channelCount, 1ul) - 1ul);
+
+  // -- register output channels, the integrator's channels come after the
+  //    channels every offline integrator has
+  self.aovs.clear();
+  if (!self.realtime) {
+    mt::core::RegisterAov(
+      self, "sample count", mt::AovType::Float, mt::AovAccumulation::Sum
+    );
+    mt::core::RegisterAov(
+      self, "variance", mt::AovType::Vec3, mt::AovAccumulation::Variance
+    );
 
-  { // -- set parameters
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-    glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+    if (plugin.integrators[pluginIdx].RegisterAovs)
+      { plugin.integrators[pluginIdx].RegisterAovs(self); }
   }
+  mt::core::AllocateAovs(self);
+  if (self.displayedAov >= self.aovs.size()) { self.displayedAov = -1lu; }
+
+  // -- construct textures
+  ::AllocateTexture(self.renderedTexture, self.renderedPixelUnpackBuffer, self);
 
   if (!self.realtime && self.HasPreview()) {
-    self.previewRenderedTexture.Construct(GL_TEXTURE_2D);
-    glBindTexture(GL_TEXTURE_2D, self.previewRenderedTexture.handle);
-    glTexImage2D(
-      GL_TEXTURE_2D
-    , 0
-    , GL_RGB32F
-    , self.imageResolution.x, self.imageResolution.y
-    , 0, GL_RGB, GL_FLOAT
-    , nullptr
+    ::AllocateTexture(
+      self.previewRenderedTexture, self.previewPixelUnpackBuffer, self
     );
-
-    { // -- set parameters
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
-      glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
-    }
   }
 
   // set unfinishedPixels
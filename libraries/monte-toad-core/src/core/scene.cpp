@@ -1,5 +1,6 @@
 #include <monte-toad/core/scene.hpp>
 
+#include <monte-toad/core/geometry.hpp>
 #include <monte-toad/core/intersection.hpp>
 #include <monte-toad/core/log.hpp>
 #include <monte-toad/core/surfaceinfo.hpp>
@@ -163,6 +164,23 @@ mt::core::TriangleMesh LoadAssetIntoScene(
 /*   } */
 /* } */
 
+////////////////////////////////////////////////////////////////////////////////
+// random barycentric coords, uniformly distributed over the area
+glm::vec2 SampleBarycentric(mt::PluginInfo const & plugin) {
+  glm::vec2 const u = plugin.random.SampleUniform2();
+  float const su = glm::sqrt(u.x);
+  return glm::vec2(1.0f - su, u.y*su);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t TriangleEntry(
+  mt::core::Scene const & scene
+, mt::core::Triangle const & triangle
+) {
+  auto const & entries = scene.emissionSource.triangleEntry;
+  return triangle.idx < entries.size() ? entries[triangle.idx] : -1lu;
+}
+
 } // -- end namespace
 
 /* mt::Material mt::Material::Construct( */
@@ -254,11 +272,88 @@ void mt::core::Scene::Construct(
 
   // load models & parse into BVH tree
   self.meshes.clear();
+  auto triangleMesh = LoadAssetIntoScene(self, plugin, filename);
+  self.triangleCount = triangleMesh.meshIndices.size();
   self.accelStructure =
-    plugin
-      .accelerationStructure
-      .Construct(LoadAssetIntoScene(self, plugin, filename))
-  ;
+    plugin.accelerationStructure.Construct(std::move(triangleMesh));
+
+  if (plugin.material.Compile) { plugin.material.Compile(self, plugin); }
+
+  mt::core::UpdateEmissionSource(self, plugin);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void mt::core::UpdateEmissionSource(
+  mt::core::Scene & scene
+, mt::PluginInfo const & plugin
+) {
+  auto & emission = scene.emissionSource;
+  emission.triangles.clear();
+  emission.triangleEntry.assign(scene.triangleCount, -1lu);
+  emission.triangleTable = {};
+  emission.lightBvh = {};
+
+  // emitters can't be evaluated without a material
+  if (!plugin.material.IsEmitter || !plugin.material.EmitterFs) { return; }
+
+  std::vector<float> weights;
+  std::vector<mt::core::LightBvhPrimitive> primitives;
+  for (size_t idx = 0ul; idx < scene.triangleCount; ++ idx) {
+    auto const triangle =
+      plugin.accelerationStructure.GetTriangle(scene.accelStructure, idx);
+
+    // evaluate emission at the center of the triangle, facing its normal
+    auto const & normals = triangle.mesh->normals;
+    glm::vec3 const normal =
+      BarycentricInterpolation(
+        normals[idx*3 + 0], normals[idx*3 + 1], normals[idx*3 + 2]
+      , glm::vec2(1.0f/3.0f)
+      );
+
+    mt::core::BvhIntersection intersection;
+    intersection.triangleIdx = idx;
+    intersection.length = 0.0f;
+    intersection.barycentricUv = glm::vec2(1.0f/3.0f);
+
+    auto const surface =
+      mt::core::SurfaceInfo::Construct(
+        scene, triangle, intersection, triangle.Center(), -normal
+      );
+
+    if (!plugin.material.IsEmitter(surface, scene, plugin)) { continue; }
+
+    glm::vec3 const emitted =
+      plugin.material.EmitterFs(surface, scene, plugin);
+    float const power =
+      glm::dot(emitted, glm::vec3(0.2126f, 0.7152f, 0.0722f))
+    * triangle.Area();
+
+    // unlit or degenerate triangles can never be chosen
+    if (!(power > 0.0f)) { continue; }
+
+    emission.triangleEntry[idx] = emission.triangles.size();
+    emission.triangles.emplace_back(idx);
+    weights.emplace_back(power);
+
+    auto const & origins = triangle.mesh->origins;
+    glm::vec3 const
+      v0 = origins[idx*3 + 0]
+    , v1 = origins[idx*3 + 1]
+    , v2 = origins[idx*3 + 2]
+    ;
+
+    mt::core::LightBvhPrimitive primitive;
+    primitive.boundsMin = glm::min(v0, glm::min(v1, v2));
+    primitive.boundsMax = glm::max(v0, glm::max(v1, v2));
+    primitive.axis = glm::normalize(glm::cross(v1 - v0, v2 - v0));
+    primitive.power = power;
+    primitives.emplace_back(primitive);
+  }
+
+  emission.triangleTable = mt::core::AliasTable::Construct(weights);
+  emission.lightBvh = mt::core::LightBvh::Construct(primitives);
+
+  spdlog::info("Collected {} emissive triangles", emission.triangles.size());
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -296,23 +391,72 @@ mt::core::EmissionSourceTriangle(
   mt::core::Scene const & scene
 , mt::PluginInfo const & plugin
 ) {
-  if (scene.emissionSource.triangles.size() == 0)
+  if (!scene.emissionSource.triangleTable.Valid())
     { return std::make_pair(mt::core::Triangle{}, glm::vec2()); }
 
-  // this needs to take into account triangle surface area as that plays heavily
-  // into which ones need to be sampled
   auto const tri =
     plugin
       .accelerationStructure
       .GetTriangle(
         scene.accelStructure
       , scene.emissionSource.triangles[
-          plugin.random.SampleUniform1() * scene.emissionSource.triangles.size()
+          mt::core::Sample(
+            scene.emissionSource.triangleTable, plugin.random.SampleUniform1()
+          )
         ]
       );
 
-  // generate random barycentric coords
-  glm::vec2 u = plugin.random.SampleUniform2();
-  u.y *= (1.0f - u.x);
-  return std::make_pair(tri, u);
+  return std::make_pair(tri, ::SampleBarycentric(plugin));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::tuple<mt::core::Triangle, glm::vec2>
+mt::core::EmissionSourceTriangle(
+  mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+, mt::core::SurfaceInfo const & surface
+) {
+  float pdf;
+  size_t const entry =
+    mt::core::Sample(
+      scene.emissionSource.lightBvh, surface.origin, surface.normal
+    , plugin.random.SampleUniform1(), pdf
+    );
+
+  if (entry == -1lu)
+    { return std::make_pair(mt::core::Triangle{}, glm::vec2()); }
+
+  auto const tri =
+    plugin
+      .accelerationStructure
+      .GetTriangle(scene.accelStructure, scene.emissionSource.triangles[entry]);
+
+  return std::make_pair(tri, ::SampleBarycentric(plugin));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+float mt::core::EmissionSourceTrianglePdf(
+  mt::core::Scene const & scene
+, mt::core::Triangle const & triangle
+) {
+  size_t const entry = ::TriangleEntry(scene, triangle);
+  if (entry == -1lu) { return 0.0f; }
+
+  return scene.emissionSource.triangleTable.pdf[entry] / triangle.Area();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+float mt::core::EmissionSourceTrianglePdf(
+  mt::core::Scene const & scene
+, mt::core::SurfaceInfo const & surface
+, mt::core::Triangle const & triangle
+) {
+  size_t const entry = ::TriangleEntry(scene, triangle);
+  if (entry == -1lu) { return 0.0f; }
+
+  return
+    mt::core::Pdf(
+      scene.emissionSource.lightBvh, surface.origin, surface.normal, entry
+    )
+  / triangle.Area();
 }
@@ -0,0 +1,232 @@
+#include <monte-toad/core/spectrum.hpp>
+
+#include <array>
+
+namespace {
+
+// -- spectra of Smits, in 10 bins over [380, 720] nm
+using SmitsSpectrum = std::array<float, 10>;
+
+constexpr float smitsMin = 380.0f, smitsBinWidth = 34.0f;
+
+constexpr SmitsSpectrum
+  smitsWhite = {{
+    1.0000f, 1.0000f, 0.9999f, 0.9993f, 0.9992f
+  , 0.9998f, 1.0000f, 1.0000f, 1.0000f, 1.0000f
+  }}
+, smitsCyan = {{
+    0.9710f, 0.9426f, 1.0007f, 1.0007f, 1.0007f
+  , 1.0007f, 0.1564f, 0.0000f, 0.0000f, 0.0000f
+  }}
+, smitsMagenta = {{
+    1.0000f, 1.0000f, 0.9685f, 0.2229f, 0.0000f
+  , 0.0458f, 0.8369f, 1.0000f, 1.0000f, 0.9959f
+  }}
+, smitsYellow = {{
+    0.0001f, 0.0000f, 0.1088f, 0.6651f, 1.0000f
+  , 1.0000f, 0.9996f, 0.9586f, 0.9685f, 0.9840f
+  }}
+, smitsRed = {{
+    0.1012f, 0.0515f, 0.0000f, 0.0000f, 0.0000f
+  , 0.0000f, 0.8325f, 1.0149f, 1.0149f, 1.0149f
+  }}
+, smitsGreen = {{
+    0.0000f, 0.0000f, 0.0273f, 0.7937f, 1.0000f
+  , 0.9418f, 0.1719f, 0.0000f, 0.0000f, 0.0025f
+  }}
+, smitsBlue = {{
+    1.0000f, 1.0000f, 0.8916f, 0.3323f, 0.0000f
+  , 0.0000f, 0.0003f, 0.0369f, 0.0483f, 0.0496f
+  }}
+;
+
+// linearly interpolates the spectrum between the centers of its bins
+float Sample(SmitsSpectrum const & spectrum, float const wavelength) {
+  float const bin =
+    glm::clamp(
+      (wavelength - ::smitsMin) / ::smitsBinWidth - 0.5f
+    , 0.0f, static_cast<float>(spectrum.size() - 1ul)
+    );
+
+  size_t const idx = glm::min(static_cast<size_t>(bin), spectrum.size() - 2ul);
+  return
+    glm::mix(
+      spectrum[idx], spectrum[idx+1ul], bin - static_cast<float>(idx)
+    );
+}
+
+glm::vec4 Sample(
+  SmitsSpectrum const & spectrum
+, mt::core::SampledWavelengths const & wavelengths
+) {
+  return
+    glm::vec4(
+      ::Sample(spectrum, wavelengths.lambda.x)
+    , ::Sample(spectrum, wavelengths.lambda.y)
+    , ::Sample(spectrum, wavelengths.lambda.z)
+    , ::Sample(spectrum, wavelengths.lambda.w)
+    );
+}
+
+// piecewise gaussian lobe of the CIE fit
+float Lobe(
+  float const wavelength
+, float const mean, float const sigmaLow, float const sigmaHigh
+) {
+  float const t =
+    (wavelength - mean) / (wavelength < mean ? sigmaLow : sigmaHigh);
+  return glm::exp(-0.5f * t*t);
+}
+
+// CIE 1931 2° colour matching functions, using the multi-lobe fit of "Simple
+// Analytic Approximations to the CIE XYZ Color Matching Functions" (Wyman et
+// al. 2013)
+glm::vec3 ColorMatching(float const wavelength) {
+  return
+    glm::vec3(
+      1.056f*::Lobe(wavelength, 599.8f, 37.9f, 31.0f)
+    + 0.362f*::Lobe(wavelength, 442.0f, 16.0f, 26.7f)
+    - 0.065f*::Lobe(wavelength, 501.1f, 20.4f, 26.2f)
+
+    , 0.821f*::Lobe(wavelength, 568.8f, 46.9f, 40.5f)
+    + 0.286f*::Lobe(wavelength, 530.9f, 16.3f, 31.1f)
+
+    , 1.217f*::Lobe(wavelength, 437.0f, 11.8f, 36.0f)
+    + 0.681f*::Lobe(wavelength, 459.0f, 26.0f, 13.8f)
+    );
+}
+
+// XYZ to linear sRGB, column-major
+glm::mat3 const xyzToRgb =
+  glm::mat3(
+     3.2404542f, -0.9692660f,  0.0556434f
+  , -1.5371385f,  1.8760108f, -0.2040259f
+  , -0.4985314f,  0.0415560f,  1.0572252f
+  );
+
+// RGB of a constant spectrum of 1 over the sampled range, which is used to
+// white balance the estimates
+glm::vec3 WhiteRgb() {
+  glm::vec3 xyz = glm::vec3(0.0f);
+  for (
+    float wavelength = mt::core::wavelengthMin + 0.5f;
+    wavelength < mt::core::wavelengthMax;
+    wavelength += 1.0f
+  ) {
+    xyz += ::ColorMatching(wavelength);
+  }
+
+  return ::xyzToRgb * xyz;
+}
+
+} // -- namespace
+
+////////////////////////////////////////////////////////////////////////////////
+mt::core::SampledWavelengths mt::core::SampleWavelengths(float const u) {
+  float const range = mt::core::wavelengthMax - mt::core::wavelengthMin;
+
+  mt::core::SampledWavelengths wavelengths;
+  for (glm::length_t idx = 0; idx < 4; ++ idx) {
+    float offset = u + 0.25f*static_cast<float>(idx);
+    if (offset >= 1.0f) { offset -= 1.0f; }
+
+    wavelengths.lambda[idx] = mt::core::wavelengthMin + offset*range;
+  }
+  return wavelengths;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void mt::core::TerminateSecondaryWavelengths(
+  mt::core::SampledWavelengths & self
+, glm::vec4 & throughput
+) {
+  if (self.secondaryTerminated) { return; }
+  self.secondaryTerminated = true;
+
+  // the estimate averages over the 4 wavelengths, so the hero wavelength is
+  // now weighted as all of them
+  throughput = glm::vec4(throughput.x * 4.0f, 0.0f, 0.0f, 0.0f);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+glm::vec4 mt::core::RgbToSpectrum(
+  glm::vec3 const & rgb
+, mt::core::SampledWavelengths const & wavelengths
+) {
+  float const r = rgb.r, g = rgb.g, b = rgb.b;
+  auto const spectrum = [&](::SmitsSpectrum const & s) {
+    return ::Sample(s, wavelengths);
+  };
+
+  glm::vec4 result;
+  if (r <= g && r <= b) {
+    result = r * spectrum(::smitsWhite);
+    if (g <= b) {
+      result += (g - r)*spectrum(::smitsCyan) + (b - g)*spectrum(::smitsBlue);
+    } else {
+      result += (b - r)*spectrum(::smitsCyan) + (g - b)*spectrum(::smitsGreen);
+    }
+  } else if (g <= r && g <= b) {
+    result = g * spectrum(::smitsWhite);
+    if (r <= b) {
+      result +=
+        (r - g)*spectrum(::smitsMagenta) + (b - r)*spectrum(::smitsBlue);
+    } else {
+      result +=
+        (b - g)*spectrum(::smitsMagenta) + (r - b)*spectrum(::smitsRed);
+    }
+  } else {
+    result = b * spectrum(::smitsWhite);
+    if (r <= g) {
+      result +=
+        (r - b)*spectrum(::smitsYellow) + (g - r)*spectrum(::smitsGreen);
+    } else {
+      result +=
+        (g - b)*spectrum(::smitsYellow) + (r - g)*spectrum(::smitsRed);
+    }
+  }
+
+  return glm::max(result, glm::vec4(0.0f));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+glm::vec3 mt::core::SpectrumToRgb(
+  glm::vec4 const & spectrum
+, mt::core::SampledWavelengths const & wavelengths
+) {
+  static glm::vec3 const whiteRgb = ::WhiteRgb();
+
+  // monte carlo estimate over the uniformly sampled wavelengths, the white
+  // balance shares the scale of the range (integrated in 1 nm steps)
+  glm::vec3 xyz = glm::vec3(0.0f);
+  for (glm::length_t idx = 0; idx < 4; ++ idx) {
+    xyz += spectrum[idx] * ::ColorMatching(wavelengths.lambda[idx]);
+  }
+
+  float const range = mt::core::wavelengthMax - mt::core::wavelengthMin;
+  return (::xyzToRgb * (xyz * range * 0.25f)) / whiteRgb;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+float mt::core::DispersiveIndexOfRefraction(
+  float const indexOfRefraction
+, float const abbeNumber
+, float const wavelength
+) {
+  if (abbeNumber <= 0.0f || wavelength <= 0.0f) { return indexOfRefraction; }
+
+  // Fraunhofer d, F & C lines, in μm
+  float constexpr lineD = 0.5876f, lineF = 0.4861f, lineC = 0.6563f;
+
+  // n(λ) = A + B/λ², such that n(d) is the index of refraction & the Abbe
+  // number is (n(d) - 1) / (n(F) - n(C))
+  float const
+    b =
+      (indexOfRefraction - 1.0f)
+    / (abbeNumber * (1.0f/(lineF*lineF) - 1.0f/(lineC*lineC)))
+  , a = indexOfRefraction - b/(lineD*lineD)
+  , lambda = wavelength * 0.001f
+  ;
+
+  return a + b/(lambda*lambda);
+}
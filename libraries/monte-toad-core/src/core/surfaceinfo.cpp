@@ -53,3 +53,43 @@ mt::core::SurfaceInfo mt::core::SurfaceInfo::Construct(
 
   return surface;
 }
+
+void mt::core::PropagateRayCone(
+  mt::core::SurfaceInfo & surface
+, float const originWidth
+, float const spread
+) {
+  surface.coneSpread = spread;
+  surface.coneWidth = originWidth + spread*surface.distance;
+  surface.uvFootprint = 0.0f;
+
+  if (!surface.triangle.Valid()) { return; }
+
+  auto const & mesh = *surface.triangle.mesh;
+  auto const idx = surface.triangle.idx;
+
+  // uv units per world unit of the triangle
+  glm::vec2 const
+    uvEdge0 = mesh.uvCoords[idx*3+1] - mesh.uvCoords[idx*3+0]
+  , uvEdge1 = mesh.uvCoords[idx*3+2] - mesh.uvCoords[idx*3+0]
+  ;
+  float const
+    uvArea = glm::abs(uvEdge0.x*uvEdge1.y - uvEdge0.y*uvEdge1.x)
+  , worldArea =
+      glm::length(
+        glm::cross(
+          mesh.origins[idx*3+1] - mesh.origins[idx*3+0]
+        , mesh.origins[idx*3+2] - mesh.origins[idx*3+0]
+        )
+      )
+  ;
+
+  if (worldArea <= 0.0f) { return; }
+
+  // the cone stretches over the surface at grazing angles
+  float const cosTheta =
+    glm::max(glm::abs(glm::dot(surface.normal, surface.incomingAngle)), 1e-3f);
+
+  surface.uvFootprint =
+    surface.coneWidth * glm::sqrt(uvArea/worldArea) / cosTheta;
+}
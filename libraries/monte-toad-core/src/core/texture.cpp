@@ -2,6 +2,18 @@
 
 #include <monte-toad/core/log.hpp>
 
+#include <glm/gtc/packing.hpp>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <cstring>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
 /*
 
   Textures represent a set of discrete infinitesimal colour values (texels),
@@ -90,9 +102,383 @@
     approximation of the ground-truth image.
 */
 
+namespace mt::core {
+  // -- tile cache; tiles are looked up by their file, level & index, & are
+  //    ordered from the most to the least recently used
+  struct TextureTileKey {
+    uint64_t file, level, tile;
+
+    bool operator==(TextureTileKey const & other) const {
+      return
+        this->file == other.file && this->level == other.level
+     && this->tile == other.tile;
+    }
+  };
+
+  struct TextureTileKeyHash {
+    size_t operator()(TextureTileKey const & key) const {
+      return
+        std::hash<uint64_t>{}(
+          (key.file * 0x9E3779B97F4A7C15ul) ^ (key.level << 48ul) ^ key.tile
+        );
+    }
+  };
+
+  struct TextureTileCache {
+    using Tile = std::shared_ptr<std::vector<uint8_t> const>;
+
+    std::mutex mutex;
+    std::list<std::pair<TextureTileKey, Tile>> lru;
+    std::unordered_map<
+      TextureTileKey, std::list<std::pair<TextureTileKey, Tile>>::iterator
+    , TextureTileKeyHash
+    > entries;
+
+    size_t capacity = 1ul << 30ul, size = 0ul;
+
+    // identifies the files of the cache's tiles
+    std::atomic<uint64_t> nextFileId { 0ul };
+
+    // every plugin links its own copy of this library, so tiles & files are
+    // allocated through the module that created the cache; otherwise their
+    // shared pointers would release them through the code of a plugin that
+    // could've been unloaded since
+    std::shared_ptr<std::vector<uint8_t>> (*allocateTile)(size_t bytes)
+      = nullptr;
+    std::shared_ptr<TextureTileFile> (*allocateFile)() = nullptr;
+  };
+
+  // anonymous file holding the tiles of a streamed texture, which is deleted
+  // once it's closed
+  struct TextureTileFile {
+    TextureTileFile() = default;
+    TextureTileFile(TextureTileFile const &) = delete;
+    TextureTileFile & operator=(TextureTileFile const &) = delete;
+    ~TextureTileFile() { if (this->fd >= 0) { close(this->fd); } }
+
+    int fd = -1;
+
+    // shared with all the modules that sample the texture, & kept alive for
+    // as long as the file's tiles can be fetched
+    std::shared_ptr<mt::core::TextureTileCache> cache;
+
+    // identifies the file's tiles in its cache, unlike its address it's never
+    // reused after the file is closed
+    uint64_t id = 0ul;
+  };
+}
+
+namespace {
+
+// interleaves the bits of coordinates within a tile
+size_t Morton(size_t const x, size_t const y) {
+  auto const spread = [](size_t v) {
+    v = (v | (v << 8ul)) & 0x00FF00FFul;
+    v = (v | (v << 4ul)) & 0x0F0F0F0Ful;
+    v = (v | (v << 2ul)) & 0x33333333ul;
+    v = (v | (v << 1ul)) & 0x55555555ul;
+    return v;
+  };
+  return spread(x) | (spread(y) << 1ul);
+}
+
+using Tile = mt::core::TextureTileCache::Tile;
+
+std::shared_ptr<std::vector<uint8_t>> AllocateTile(size_t const bytes) {
+  return std::make_shared<std::vector<uint8_t>>(bytes, 0u);
+}
+
+std::shared_ptr<mt::core::TextureTileFile> AllocateFile() {
+  return std::make_shared<mt::core::TextureTileFile>();
+}
+
+// must be called with the cache locked; the most recent tile is kept even if
+// it alone is over the capacity
+void EvictTiles(mt::core::TextureTileCache & cache) {
+  while (cache.size > cache.capacity && cache.lru.size() > 1ul) {
+    auto const & [key, tile] = cache.lru.back();
+    cache.size -= tile->size();
+    cache.entries.erase(key);
+    cache.lru.pop_back();
+  }
+}
+
+::Tile FetchCachedTile(
+  mt::core::Texture const & texture
+, mt::core::TextureTileKey const & key
+) {
+  auto & cache = *texture.tileFile->cache;
+
+  {
+    std::lock_guard<std::mutex> lock(cache.mutex);
+    if (auto entry = cache.entries.find(key); entry != cache.entries.end()) {
+      cache.lru.splice(cache.lru.begin(), cache.lru, entry->second);
+      return entry->second->second;
+    }
+  }
+
+  // faulted in without holding the lock, so other threads keep hitting the
+  // cache; if two threads fault the same tile the first one inserted is kept
+  size_t const tileBytes =
+    mt::core::textureTileTexels * texture.TexelByteSize();
+  auto tile = cache.allocateTile(tileBytes);
+
+  ssize_t const bytesRead =
+    pread(
+      texture.tileFile->fd, tile->data(), tileBytes
+    , static_cast<off_t>(
+        texture.levels[key.level].tileFileOffset + key.tile*tileBytes
+      )
+    );
+  if (bytesRead != static_cast<ssize_t>(tileBytes)) {
+    spdlog::error(
+      "failed to read tile {} of texture level {}", key.tile, key.level
+    );
+    std::fill(tile->begin(), tile->end(), uint8_t{0u});
+  }
+
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  if (auto entry = cache.entries.find(key); entry != cache.entries.end()) {
+    cache.lru.splice(cache.lru.begin(), cache.lru, entry->second);
+    return entry->second->second;
+  }
+
+  cache.lru.emplace_front(key, tile);
+  cache.entries.emplace(key, cache.lru.begin());
+  cache.size += tileBytes;
+  ::EvictTiles(cache);
+
+  return tile;
+}
+
+// each thread keeps the tiles it read most recently in front of the cache, so
+// the texels of a filter footprint, which mostly share a tile, don't each
+// take the cache's lock. Tiles are never written to & the kept file can't be
+// reused, so a kept tile stays valid after the cache evicts it
+struct RecentTile {
+  std::shared_ptr<mt::core::TextureTileFile const> file;
+  mt::core::TextureTileKey key {};
+  ::Tile tile;
+};
+
+constexpr size_t recentTileCount = 8ul;
+
+::Tile FetchTile(
+  mt::core::Texture const & texture
+, size_t const levelIdx
+, size_t const tileIdx
+) {
+  mt::core::TextureTileKey const key {
+    texture.tileFile->id, levelIdx, tileIdx
+  };
+
+  thread_local std::array<::RecentTile, ::recentTileCount> recentTiles;
+  auto & recent =
+    recentTiles[mt::core::TextureTileKeyHash{}(key) % ::recentTileCount];
+
+  if (recent.tile && recent.file == texture.tileFile && recent.key == key)
+    { return recent.tile; }
+
+  recent = { texture.tileFile, key, ::FetchCachedTile(texture, key) };
+  return recent.tile;
+}
+
+bool WriteAll(int const fd, uint8_t const * data, size_t bytes, off_t offset) {
+  while (bytes > 0ul) {
+    ssize_t const written = pwrite(fd, data, bytes, offset);
+    if (written <= 0) { return false; }
+    data += written;
+    bytes -= static_cast<size_t>(written);
+    offset += written;
+  }
+  return true;
+}
+
+float ReadComponent(
+  uint8_t const * texel
+, mt::core::TexelFormat const format
+, size_t const component
+) {
+  switch (format) {
+    case mt::core::TexelFormat::Unorm8:
+      return static_cast<float>(texel[component]) / 255.0f;
+    case mt::core::TexelFormat::Half: {
+      uint16_t value;
+      std::memcpy(&value, texel + component*sizeof(uint16_t), sizeof(value));
+      return glm::unpackHalf1x16(value);
+    }
+    case mt::core::TexelFormat::Float: {
+      float value;
+      std::memcpy(&value, texel + component*sizeof(float), sizeof(value));
+      return value;
+    }
+  }
+  return 0.0f;
+}
+
+void WriteComponent(
+  uint8_t * texel
+, mt::core::TexelFormat const format
+, size_t const component
+, float const value
+) {
+  switch (format) {
+    case mt::core::TexelFormat::Unorm8:
+      texel[component] =
+        static_cast<uint8_t>(glm::round(glm::saturate(value) * 255.0f));
+    break;
+    case mt::core::TexelFormat::Half: {
+      uint16_t const half = glm::packHalf1x16(value);
+      std::memcpy(texel + component*sizeof(uint16_t), &half, sizeof(half));
+    } break;
+    case mt::core::TexelFormat::Float:
+      std::memcpy(texel + component*sizeof(float), &value, sizeof(value));
+    break;
+  }
+}
+
+// halves the last level with a box filter, averaging in float; each texel of
+// the smaller level covers 2x2 texels, except that the last column & row of an
+// odd sized level also cover the leftover texel, so their footprint is 3 wide
+void Downsample(mt::core::Texture & texture) {
+  size_t const levelIdx = texture.levels.size() - 1ul;
+  uint64_t const
+    width = texture.levels[levelIdx].width
+  , height = texture.levels[levelIdx].height
+  ;
+  size_t const texelSize = texture.TexelByteSize();
+
+  mt::core::TextureLevel half =
+    mt::core::TextureLevel::Construct(
+      glm::max(width/2ul, 1ul), glm::max(height/2ul, 1ul), texelSize
+    );
+
+  // raw channels rather than Texel, which expands them to RGBA
+  auto const & level = texture.levels[levelIdx];
+  auto const raw = [&level, texelSize](size_t const x, size_t const y) {
+    return level.data.data() + level.Idx(x, y)*texelSize;
+  };
+
+  for (size_t y = 0ul; y < half.height; ++ y)
+  for (size_t x = 0ul; x < half.width; ++ x) {
+    // footprint of [begin, end) texels along each axis
+    size_t const
+      x0 = x*2ul, x1 = x+1ul == half.width ? width  : x*2ul+2ul
+    , y0 = y*2ul, y1 = y+1ul == half.height ? height : y*2ul+2ul
+    ;
+    float const weight = 1.0f / static_cast<float>((x1-x0)*(y1-y0));
+
+    uint8_t * const texel = half.data.data() + half.Idx(x, y)*texelSize;
+    for (size_t c = 0ul; c < texture.channels; ++ c) {
+      float sum = 0.0f;
+      for (size_t fy = y0; fy < y1; ++ fy)
+      for (size_t fx = x0; fx < x1; ++ fx)
+        { sum += ::ReadComponent(raw(fx, fy), texture.format, c); }
+      ::WriteComponent(texel, texture.format, c, weight*sum);
+    }
+  }
+
+  texture.levels.emplace_back(std::move(half));
+}
+
+void GenerateMips(mt::core::Texture & texture) {
+  while (
+      texture.levels.back().width > 1ul || texture.levels.back().height > 1ul
+  ) {
+    ::Downsample(texture);
+  }
+}
+
+// wraps a texel coordinate, as uv coordinates repeat
+size_t Wrap(int64_t const coord, uint64_t const size) {
+  int64_t const wrapped = coord % static_cast<int64_t>(size);
+  return static_cast<size_t>(
+    wrapped < 0 ? wrapped + static_cast<int64_t>(size) : wrapped
+  );
+}
+
+glm::vec4 SampleLevelBilinear(
+  mt::core::Texture const & texture
+, size_t const levelIdx
+, glm::vec2 uvCoords
+) {
+  auto const & level = texture.levels[levelIdx];
+  uvCoords.y = 1.0f - uvCoords.y;
+
+  glm::vec2 const
+    st = uvCoords*glm::vec2(level.width, level.height) - glm::vec2(0.5f)
+  , iuv = glm::floor(st)
+  , fuv = st - iuv
+  ;
+
+  size_t const
+    x0 = ::Wrap(static_cast<int64_t>(iuv.x), level.width)
+  , y0 = ::Wrap(static_cast<int64_t>(iuv.y), level.height)
+  , x1 = ::Wrap(static_cast<int64_t>(iuv.x) + 1, level.width)
+  , y1 = ::Wrap(static_cast<int64_t>(iuv.y) + 1, level.height)
+  ;
+
+  return
+    glm::mix(
+      glm::mix(
+        texture.Texel(levelIdx, x0, y0), texture.Texel(levelIdx, x1, y0), fuv.x
+      )
+    , glm::mix(
+        texture.Texel(levelIdx, x0, y1), texture.Texel(levelIdx, x1, y1), fuv.x
+      )
+    , fuv.y
+    );
+}
+
+} // -- namespace
+
+////////////////////////////////////////////////////////////////////////////////
+size_t mt::core::TexelFormatByteSize(mt::core::TexelFormat const format) {
+  switch (format) {
+    case mt::core::TexelFormat::Unorm8: return sizeof(uint8_t);
+    case mt::core::TexelFormat::Half:   return sizeof(uint16_t);
+    case mt::core::TexelFormat::Float:  return sizeof(float);
+  }
+  return 0ul;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t mt::core::TextureLevel::Idx(size_t const x, size_t const y) const {
+  return
+    this->TileIdx(x, y)*mt::core::textureTileTexels
+  + ::Morton(x % mt::core::textureTileSize, y % mt::core::textureTileSize);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t mt::core::TextureLevel::TileIdx(size_t const x, size_t const y) const {
+  return
+    (y / mt::core::textureTileSize)*this->tilesX
+  + (x / mt::core::textureTileSize);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+mt::core::TextureLevel mt::core::TextureLevel::Construct(
+  uint64_t const width, uint64_t const height, size_t const texelByteSize
+) {
+  mt::core::TextureLevel level;
+  level.width = width;
+  level.height = height;
+
+  // rounded up, so the edges of the level get padded tiles
+  size_t const tileSize = mt::core::textureTileSize;
+  level.tilesX = (width  + tileSize - 1ul) / tileSize;
+  level.tilesY = (height + tileSize - 1ul) / tileSize;
+  level.data.resize(
+    level.tilesX*level.tilesY*mt::core::textureTileTexels*texelByteSize, 0u
+  );
+  return level;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 mt::core::Texture mt::core::Texture::Construct(
-  size_t width, size_t height, size_t colorChannels, void const * data
+  size_t width, size_t height, size_t colorChannels
+, mt::core::TexelFormat format
+, void const * data
 ) {
   mt::core::Texture texture;
   texture.width = width;
@@ -103,24 +489,153 @@ mt::core::Texture mt::core::Texture::Construct(
     return texture;
   }
 
-  texture.data.resize(texture.width*texture.height);
-  for (size_t i = 0; i < texture.data.size(); ++ i) {
-    size_t x = i%texture.width, y = i/texture.width;
-
-    uint8_t const * byte =
-      reinterpret_cast<uint8_t const *>(data)
-    + texture.Idx(x, y)*sizeof(uint8_t)*4
-    ;
+  if (colorChannels < 1ul || colorChannels > 4ul) {
+    spdlog::critical("texture has unsupported channel count {}", colorChannels);
+    return texture;
+  }
 
-    // load all color channels, in case of R, RGB, etc set the unused channels
-    //   to 1.0f
-    for (size_t j = 0; j < 4; ++ j)
-      { texture.data[i][j] = colorChannels >= j ? *(byte + j)/255.0f : 1.0f; }
+  texture.channels = static_cast<uint8_t>(colorChannels);
+  texture.format = format;
+
+  // the source is in rows, which are reordered into tiles
+  size_t const texelSize = texture.TexelByteSize();
+  auto level = mt::core::TextureLevel::Construct(width, height, texelSize);
+  uint8_t const * const source = reinterpret_cast<uint8_t const *>(data);
+  for (size_t y = 0ul; y < height; ++ y)
+  for (size_t x = 0ul; x < width; ++ x) {
+    std::memcpy(
+      level.data.data() + level.Idx(x, y)*texelSize
+    , source + (y*width + x)*texelSize
+    , texelSize
+    );
   }
 
+  texture.levels.emplace_back(std::move(level));
+  ::GenerateMips(texture);
+
   return texture;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+glm::vec4 mt::core::Texture::Texel(
+  size_t const levelIdx, size_t const x, size_t const y
+) const {
+  auto const & level = this->levels[levelIdx];
+  size_t const texelSize = this->TexelByteSize();
+
+  // holds a streamed tile while it's read, as it could be evicted meanwhile
+  ::Tile tile;
+  uint8_t const * texel;
+  if (this->tileFile) {
+    tile = ::FetchTile(*this, levelIdx, level.TileIdx(x, y));
+    texel =
+      tile->data()
+    + (level.Idx(x, y) % mt::core::textureTileTexels)*texelSize;
+  } else {
+    texel = level.data.data() + level.Idx(x, y)*texelSize;
+  }
+
+  auto const component = [&](size_t const c) {
+    return ::ReadComponent(texel, this->format, c);
+  };
+
+  switch (this->channels) {
+    case 1u: {
+      float const grey = component(0ul);
+      return glm::vec4(grey, grey, grey, 1.0f);
+    }
+    case 2u: {
+      float const grey = component(0ul);
+      return glm::vec4(grey, grey, grey, component(1ul));
+    }
+    case 3u:
+      return glm::vec4(component(0ul), component(1ul), component(2ul), 1.0f);
+    default:
+      return
+        glm::vec4(
+          component(0ul), component(1ul), component(2ul), component(3ul)
+        );
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::shared_ptr<mt::core::TextureTileCache>
+mt::core::CreateTextureTileCache() {
+  auto cache = std::make_shared<mt::core::TextureTileCache>();
+  cache->allocateTile = &::AllocateTile;
+  cache->allocateFile = &::AllocateFile;
+  return cache;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool mt::core::StreamTexture(
+  mt::core::Texture & texture
+, std::shared_ptr<mt::core::TextureTileCache> const & cache
+, std::string const & directory
+) {
+  if (texture.tileFile) { return true; }
+  if (!texture.Valid() || !cache) { return false; }
+
+  std::string path = directory + "/mt-texture-XXXXXX";
+  int const fd = mkstemp(path.data());
+  if (fd < 0) {
+    spdlog::error("could not create texture tile file in '{}'", directory);
+    return false;
+  }
+
+  // the file stays until its descriptor is closed
+  unlink(path.c_str());
+
+  auto file = cache->allocateFile();
+  file->fd = fd;
+  file->cache = cache;
+  file->id = cache->nextFileId ++;
+
+  // levels are already tiled, so they're written as they are
+  uint64_t offset = 0ul;
+  for (auto & level : texture.levels) {
+    if (
+      !::WriteAll(
+        fd, level.data.data(), level.data.size(), static_cast<off_t>(offset)
+      )
+    ) {
+      spdlog::error("failed to write texture tile file in '{}'", directory);
+      return false;
+    }
+    level.tileFileOffset = offset;
+    offset += level.data.size();
+  }
+
+  for (auto & level : texture.levels)
+    { std::vector<uint8_t>().swap(level.data); }
+
+  texture.tileFile = std::move(file);
+
+  spdlog::info(
+    "Streaming {}x{} texture through the tile cache"
+  , texture.width, texture.height
+  );
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void mt::core::SetTextureTileCacheCapacity(
+  mt::core::TextureTileCache & cache
+, size_t const bytes
+) {
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  cache.capacity = bytes;
+  ::EvictTiles(cache);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+size_t mt::core::TextureTileCacheCapacity(
+  mt::core::TextureTileCache & cache
+) {
+  std::lock_guard<std::mutex> lock(cache.mutex);
+  return cache.capacity;
+}
+
 ////////////////////////////////////////////////////////////////////////////////
 glm::vec4 mt::core::Sample(
   mt::core::Texture const & texture
@@ -140,7 +655,7 @@ glm::vec4 mt::core::Sample(
       )
   ;
 
-  return texture.data[texture.Idx(x, y)];
+  return texture.Texel(0ul, x, y);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -148,25 +663,35 @@ glm::vec4 mt::core::SampleBilinear(
   mt::core::Texture const & texture
 , glm::vec2 uvCoords
 ) {
-  glm::vec2 res = glm::vec2(texture.width, texture.height);
+  return ::SampleLevelBilinear(texture, 0ul, uvCoords);
+}
 
-  glm::vec2 st = uvCoords*res - glm::vec2(0.5f);
+////////////////////////////////////////////////////////////////////////////////
+glm::vec4 mt::core::Sample(
+  mt::core::Texture const & texture
+, glm::vec2 uvCoords
+, float const footprint
+) {
+  // the level whose texels are as wide as the footprint
+  float const
+    texels =
+      footprint * static_cast<float>(glm::max(texture.width, texture.height))
+  , lod =
+      glm::clamp(
+        glm::log2(glm::max(texels, 1.0f))
+      , 0.0f, static_cast<float>(texture.levels.size() - 1ul)
+      )
+  ;
 
-  glm::vec2 iuv = glm::floor(st);
-  glm::vec2 fuv = glm::fract(st);
+  size_t const level = static_cast<size_t>(lod);
+  float const t = lod - static_cast<float>(level);
 
-  glm::vec4
-    a = mt::core::Sample(texture, (iuv + glm::vec2(0.5f,0.5f))/res)
-  , b = mt::core::Sample(texture, (iuv + glm::vec2(1.5f,0.5f))/res)
-  , c = mt::core::Sample(texture, (iuv + glm::vec2(0.5f,1.5f))/res)
-  , d = mt::core::Sample(texture, (iuv + glm::vec2(1.5f,1.5f))/res)
-  ;
+  glm::vec4 const sample = ::SampleLevelBilinear(texture, level, uvCoords);
+  if (t <= 0.0f || level+1ul >= texture.levels.size()) { return sample; }
 
   return
-    mix(
-      mix(a, b, fuv.x)
-    , mix( c, d, fuv.x)
-    , fuv.y
+    glm::mix(
+      sample, ::SampleLevelBilinear(texture, level+1ul, uvCoords), t
     );
 }
 
@@ -191,6 +716,7 @@ glm::vec4 mt::core::Sample(mt::core::Texture const & texture, glm::vec3 dir) {
 }
 
 #include <monte-toad/core/scene.hpp>
+#include <monte-toad/core/surfaceinfo.hpp>
 
 #include <imgui/imgui.hpp>
 
@@ -242,10 +768,11 @@ template <> bool mt::core::TextureOption<float>::GuiApply(
 
 template <> float mt::core::TextureOption<float>::Get(
   glm::vec2 const & uv
+, float const footprint
 ) const {
   auto value = this->userValue;
   if (this->userTexture) {
-    value = mt::core::Sample(*this->userTexture, uv).r;
+    value = mt::core::Sample(*this->userTexture, uv, footprint).r;
     value = glm::mix(this->minRange, this->maxRange, value);
   }
   return value;
@@ -278,13 +805,26 @@ template <> bool mt::core::TextureOption<glm::vec3>::GuiApply(
 
 template <> glm::vec3 mt::core::TextureOption<glm::vec3>::Get(
   glm::vec2 const & uv
+, float const footprint
 ) const {
   auto value = this->userValue;
   if (this->userTexture) {
-    auto v = mt::core::Sample(*this->userTexture, uv);
+    auto v = mt::core::Sample(*this->userTexture, uv, footprint);
     value.x = v.x; value.y = v.y; value.z = v.z;
     value =
       glm::mix(glm::vec3(this->minRange), glm::vec3(this->maxRange), value);
   }
   return value;
 }
+
+template <> float mt::core::TextureOption<float>::Get(
+  mt::core::SurfaceInfo const & surface
+) const {
+  return this->Get(surface.uvcoord, surface.uvFootprint);
+}
+
+template <> glm::vec3 mt::core::TextureOption<glm::vec3>::Get(
+  mt::core::SurfaceInfo const & surface
+) const {
+  return this->Get(surface.uvcoord, surface.uvFootprint);
+}
@@ -133,11 +133,15 @@ glm::vec3 mt::core::Triangle::Center() const {
   return (v0 + v1 + v2) * (1.0f/3.0f);
 }
 
-/* float mt::core::Triangle::area() const { */
-/*   auto const edge0 = this->v0 - this->v1; */
-/*   auto const edge1 = this->v2 - this->v0; */
-/*   return glm::length(glm::cross(edge0, edge1)) * 0.5f; */
-/* } */
+float mt::core::Triangle::Area() const {
+  auto const & origins = this->mesh->origins;
+  auto const
+    v0 = origins[this->idx*3 + 0]
+  , v1 = origins[this->idx*3 + 1]
+  , v2 = origins[this->idx*3 + 2]
+  ;
+  return glm::length(glm::cross(v1 - v0, v2 - v0)) * 0.5f;
+}
 
 std::optional<mt::core::BvhIntersection> mt::core::Triangle::intersect(
   bvh::Ray<float> const & ray
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// decodes OpenEXR images, limited to single part scanline files with
+// uncompressed, RLE or zip compressed chunks, which is what most environment
+// maps are saved as
+
+namespace mt::util {
+  struct ExrImage {
+    size_t width, height;
+
+    // RGB(A) if the file has red, green & blue channels, luminance (& alpha)
+    // if it has a Y channel, otherwise its first channel
+    size_t channels;
+
+    // linear values, row-major from the top row
+    std::vector<float> texels;
+  };
+
+  bool LoadExr(std::string const & filename, mt::util::ExrImage & image);
+}
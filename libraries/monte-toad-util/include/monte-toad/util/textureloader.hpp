@@ -1,9 +1,50 @@
 #pragma once
 
-#include <string>
+#include <monte-toad/core/math.hpp>
+#include <monte-toad/core/texture.hpp>
 
-namespace mt::core { struct Texture; }
+#include <future>
+#include <string>
 
 namespace mt::util {
-  mt::core::Texture LoadTexture(std::string const & filename);
+  // exr & radiance hdr files are loaded as floats, other files keep their 8
+  // bits as they are. Large textures are streamed through the tile cache if
+  // one is given, otherwise they're held in memory
+  mt::core::Texture LoadTexture(
+    std::string const & filename
+  , std::shared_ptr<mt::core::TextureTileCache> const & tileCache = nullptr
+  );
+
+  // same as LoadTexture, but 8-bit files are linearized from their 2.2 gamma
+  // into halfs, for textures that are radiance such as environment maps
+  mt::core::Texture LoadLinearTexture(
+    std::string const & filename
+  , std::shared_ptr<mt::core::TextureTileCache> const & tileCache = nullptr
+  );
+
+  // -- asynchronous loading; textures are decoded in parallel by a pool of
+  //    background threads, while the thread that owns the scene keeps
+  //    rendering with whatever it had & takes each texture once it's done
+
+  struct TextureLoad {
+    std::string filename;
+    std::future<mt::core::Texture> texture;
+
+    bool Valid() const { return texture.valid(); }
+
+    // doesn't block, only true once until the texture is taken
+    bool Ready() const;
+
+    // blocks until the texture is decoded, after which the load is invalid
+    mt::core::Texture Take();
+  };
+
+  TextureLoad LoadTextureAsync(
+    std::string const & filename
+  , std::shared_ptr<mt::core::TextureTileCache> tileCache = nullptr
+  );
+  TextureLoad LoadLinearTextureAsync(
+    std::string const & filename
+  , std::shared_ptr<mt::core::TextureTileCache> tileCache = nullptr
+  );
 }
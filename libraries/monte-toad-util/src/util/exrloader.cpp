@@ -0,0 +1,422 @@
+#include <monte-toad/util/exrloader.hpp>
+
+#include <monte-toad/core/log.hpp>
+
+#pragma GCC diagnostic push
+  #pragma GCC diagnostic ignored "-Wdouble-promotion"
+  #include <stb_image.hpp>
+#pragma GCC diagnostic pop
+
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <fstream>
+#include <iterator>
+
+namespace {
+
+constexpr std::array<uint8_t, 4ul> exrMagic = {{ 0x76, 0x2f, 0x31, 0x01 }};
+
+// -- version field flags of files that aren't single part scanline images
+constexpr uint32_t
+  exrFlagTiled     = 0x200u
+, exrFlagDeep      = 0x800u
+, exrFlagMultipart = 0x1000u
+;
+
+enum class ExrCompression : uint8_t {
+  None = 0, Rle = 1, Zips = 2, Zip = 3
+};
+
+enum class ExrPixelType : int32_t {
+  Uint = 0, Half = 1, Float = 2
+};
+
+struct ExrChannel {
+  std::string name;
+  ::ExrPixelType type;
+};
+
+struct ExrHeader {
+  std::vector<::ExrChannel> channels;
+  ::ExrCompression compression = ::ExrCompression::None;
+  int32_t xMin = 0, yMin = 0, xMax = -1, yMax = -1;
+};
+
+size_t PixelTypeByteSize(::ExrPixelType const type) {
+  return type == ::ExrPixelType::Half ? 2ul : 4ul;
+}
+
+// scanlines stored in each chunk
+size_t ChunkLines(::ExrCompression const compression) {
+  return compression == ::ExrCompression::Zip ? 16ul : 1ul;
+}
+
+// bounds checked reads over the bytes of the file; any read past the end
+// invalidates the reader
+struct Reader {
+  std::vector<uint8_t> const & bytes;
+  size_t offset = 0ul;
+  bool valid = true;
+
+  template <typename T> T Read() {
+    T value {};
+    if (
+        this->offset > this->bytes.size()
+     || sizeof(T) > this->bytes.size() - this->offset
+    ) {
+      this->valid = false;
+      return value;
+    }
+    std::memcpy(&value, this->bytes.data() + this->offset, sizeof(T));
+    this->offset += sizeof(T);
+    return value;
+  }
+
+  std::string ReadString() {
+    std::string value;
+    while (
+        this->offset < this->bytes.size() && this->bytes[this->offset] != 0u
+    ) { value.push_back(static_cast<char>(this->bytes[this->offset ++])); }
+
+    if (this->offset >= this->bytes.size()) { this->valid = false; }
+    else { ++ this->offset; } // null terminator
+    return value;
+  }
+};
+
+bool ReadHeader(::Reader & reader, ::ExrHeader & header) {
+  while (reader.valid) {
+    std::string const name = reader.ReadString();
+    if (name.empty()) { break; } // end of the header
+
+    std::string const type = reader.ReadString();
+    int32_t const size = reader.Read<int32_t>();
+
+    // the offset must always move forward, or a crafted header could loop
+    if (
+        !reader.valid || size < 0
+     || static_cast<size_t>(size) > reader.bytes.size() - reader.offset
+    ) {
+      spdlog::error("exr attribute '{}' has an invalid size {}", name, size);
+      return false;
+    }
+
+    size_t const end = reader.offset + static_cast<size_t>(size);
+
+    if (name == "channels" && type == "chlist") {
+      while (reader.valid) {
+        std::string channelName = reader.ReadString();
+        if (channelName.empty()) { break; }
+
+        auto const pixelType = reader.Read<int32_t>();
+        reader.offset += 4ul; // linear flag & reserved bytes
+        auto const xSampling = reader.Read<int32_t>();
+        auto const ySampling = reader.Read<int32_t>();
+
+        if (pixelType < 0 || pixelType > 2) {
+          spdlog::error("unknown exr pixel type {}", pixelType);
+          return false;
+        }
+        if (xSampling != 1 || ySampling != 1) {
+          spdlog::error("subsampled exr channels are not supported");
+          return false;
+        }
+
+        header.channels.push_back(
+          { std::move(channelName), static_cast<::ExrPixelType>(pixelType) }
+        );
+      }
+    } else if (name == "compression") {
+      auto const compression = reader.Read<uint8_t>();
+      if (compression > static_cast<uint8_t>(::ExrCompression::Zip)) {
+        spdlog::error(
+          "exr compression {} is not supported, only none, rle & zip are"
+        , compression
+        );
+        return false;
+      }
+      header.compression = static_cast<::ExrCompression>(compression);
+    } else if (name == "dataWindow") {
+      header.xMin = reader.Read<int32_t>();
+      header.yMin = reader.Read<int32_t>();
+      header.xMax = reader.Read<int32_t>();
+      header.yMax = reader.Read<int32_t>();
+    }
+
+    reader.offset = end;
+  }
+
+  if (!reader.valid) {
+    spdlog::error("exr header is truncated");
+    return false;
+  }
+
+  if (header.channels.empty() || header.xMax < header.xMin
+   || header.yMax < header.yMin) {
+    spdlog::error("exr header has no channels or an empty data window");
+    return false;
+  }
+
+  return true;
+}
+
+bool DecodeRle(
+  uint8_t const * data, size_t const size
+, std::vector<uint8_t> & decoded
+) {
+  size_t in = 0ul, out = 0ul;
+  while (in < size) {
+    auto const count = static_cast<int8_t>(data[in ++]);
+
+    if (count < 0) { // run of literal bytes
+      size_t const length = static_cast<size_t>(-count);
+      if (in + length > size || out + length > decoded.size())
+        { return false; }
+      std::memcpy(decoded.data() + out, data + in, length);
+      in += length;
+      out += length;
+    } else { // repeated byte
+      size_t const length = static_cast<size_t>(count) + 1ul;
+      if (in >= size || out + length > decoded.size()) { return false; }
+      std::memset(decoded.data() + out, data[in ++], length);
+      out += length;
+    }
+  }
+  return out == decoded.size();
+}
+
+// both rle & zip chunks are delta encoded, then split into the even & odd
+// bytes before compression
+void UndoPredictor(std::vector<uint8_t> & decoded) {
+  for (size_t i = 1ul; i < decoded.size(); ++ i) {
+    decoded[i] =
+      static_cast<uint8_t>(
+        static_cast<int>(decoded[i-1ul]) + static_cast<int>(decoded[i]) - 128
+      );
+  }
+
+  std::vector<uint8_t> interleaved(decoded.size());
+  size_t even = 0ul, odd = (decoded.size() + 1ul) / 2ul;
+  for (size_t i = 0ul; i < interleaved.size(); ++ i) {
+    interleaved[i] = decoded[(i % 2ul == 0ul) ? even ++ : odd ++];
+  }
+  decoded = std::move(interleaved);
+}
+
+bool DecodeChunk(
+  ::ExrCompression const compression
+, uint8_t const * data, size_t const size
+, std::vector<uint8_t> & decoded
+) {
+  // chunks that wouldn't shrink are stored uncompressed
+  if (compression == ::ExrCompression::None || size == decoded.size()) {
+    if (size != decoded.size()) { return false; }
+    std::memcpy(decoded.data(), data, size);
+    return true;
+  }
+
+  if (compression == ::ExrCompression::Rle) {
+    if (!::DecodeRle(data, size, decoded)) { return false; }
+  } else {
+    int const length =
+      stbi_zlib_decode_buffer(
+        reinterpret_cast<char *>(decoded.data())
+      , static_cast<int>(decoded.size())
+      , reinterpret_cast<char const *>(data)
+      , static_cast<int>(size)
+      );
+    if (length != static_cast<int>(decoded.size())) { return false; }
+  }
+
+  ::UndoPredictor(decoded);
+  return true;
+}
+
+float ReadValue(uint8_t const * data, ::ExrPixelType const type) {
+  switch (type) {
+    case ::ExrPixelType::Uint: {
+      uint32_t value;
+      std::memcpy(&value, data, sizeof(uint32_t));
+      return static_cast<float>(value);
+    }
+    case ::ExrPixelType::Half: {
+      uint16_t value;
+      std::memcpy(&value, data, sizeof(uint16_t));
+      return glm::unpackHalf1x16(value);
+    }
+    case ::ExrPixelType::Float: {
+      float value;
+      std::memcpy(&value, data, sizeof(float));
+      return value;
+    }
+  }
+  return 0.0f;
+}
+
+// indices of the file's channels that make up the channels of the image
+std::vector<size_t> ImageChannels(std::vector<::ExrChannel> const & channels) {
+  auto const find = [&channels](char const * name) {
+    for (size_t i = 0ul; i < channels.size(); ++ i)
+      { if (channels[i].name == name) { return i; } }
+    return -1lu;
+  };
+
+  size_t const
+    r = find("R"), g = find("G"), b = find("B"), a = find("A"), y = find("Y")
+  ;
+
+  std::vector<size_t> indices;
+  if (r != -1lu && g != -1lu && b != -1lu) { indices = { r, g, b }; }
+  else if (y != -1lu) { indices = { y }; }
+  else { return { 0ul }; }
+
+  if (a != -1lu) { indices.emplace_back(a); }
+  return indices;
+}
+
+} // -- namespace
+
+////////////////////////////////////////////////////////////////////////////////
+bool mt::util::LoadExr(
+  std::string const & filename
+, mt::util::ExrImage & image
+) {
+  std::vector<uint8_t> bytes;
+  {
+    std::ifstream file(filename, std::ios::binary);
+    if (!file) {
+      spdlog::error("could not open exr file '{}'", filename);
+      return false;
+    }
+    bytes.assign(
+      std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>()
+    );
+  }
+
+  ::Reader reader { bytes };
+
+  auto const magic = reader.Read<std::array<uint8_t, 4ul>>();
+  auto const version = reader.Read<uint32_t>();
+  if (!reader.valid || magic != ::exrMagic) {
+    spdlog::error("'{}' is not an exr file", filename);
+    return false;
+  }
+
+  if (version & (::exrFlagTiled | ::exrFlagDeep | ::exrFlagMultipart)) {
+    spdlog::error(
+      "'{}' is a tiled, deep or multipart exr file, which aren't supported"
+    , filename
+    );
+    return false;
+  }
+
+  ::ExrHeader header;
+  if (!::ReadHeader(reader, header)) {
+    spdlog::error("could not read the header of exr file '{}'", filename);
+    return false;
+  }
+
+  // extents are computed in 64 bits, as the difference of the int32 bounds
+  // can overflow
+  size_t const
+    width =
+      static_cast<size_t>(
+        static_cast<int64_t>(header.xMax) - static_cast<int64_t>(header.xMin)
+      ) + 1ul
+  , height =
+      static_cast<size_t>(
+        static_cast<int64_t>(header.yMax) - static_cast<int64_t>(header.yMin)
+      ) + 1ul
+  , chunkLines = ::ChunkLines(header.compression)
+  , chunks = (height + chunkLines - 1ul) / chunkLines
+  ;
+
+  // the offset table must fit in the file before anything is allocated from
+  // the data window; zip can't deflate data more than about a thousand times,
+  // so windows with far more texels than the file has bytes are rejected too
+  size_t const remaining = bytes.size() - reader.offset;
+  if (
+      chunks > remaining / sizeof(uint64_t)
+   || width > (1ul << 24ul) || height > (1ul << 24ul)
+   || width*height > remaining*1024ul / header.channels.size()
+  ) {
+    spdlog::error(
+      "exr file '{}' has a {}x{} data window that doesn't fit its {} bytes"
+    , filename, width, height, bytes.size()
+    );
+    return false;
+  }
+
+  // channels are stored one after the other in each scanline, in the order
+  // of the header
+  std::vector<size_t> channelOffsets;
+  size_t lineByteSize = 0ul;
+  for (auto const & channel : header.channels) {
+    channelOffsets.emplace_back(lineByteSize);
+    lineByteSize += width * ::PixelTypeByteSize(channel.type);
+  }
+
+  std::vector<size_t> const imageChannels = ::ImageChannels(header.channels);
+
+  image.width = width;
+  image.height = height;
+  image.channels = imageChannels.size();
+  image.texels.assign(width*height*image.channels, 0.0f);
+
+  std::vector<uint64_t> chunkOffsets(chunks);
+  for (auto & offset : chunkOffsets) { offset = reader.Read<uint64_t>(); }
+
+  std::vector<uint8_t> decoded;
+  for (uint64_t const chunkOffset : chunkOffsets) {
+    reader.offset = static_cast<size_t>(chunkOffset);
+    int32_t const chunkY = reader.Read<int32_t>();
+    int32_t const chunkSize = reader.Read<int32_t>();
+
+    if (
+        !reader.valid || chunkY < header.yMin || chunkY > header.yMax
+     || chunkSize < 0
+     || static_cast<size_t>(chunkSize) > bytes.size() - reader.offset
+    ) {
+      spdlog::error("exr file '{}' has an invalid chunk", filename);
+      return false;
+    }
+
+    size_t const dataSize = static_cast<size_t>(chunkSize);
+
+    size_t const
+      firstLine = static_cast<size_t>(chunkY - header.yMin)
+    , lines = std::min(chunkLines, height - firstLine)
+    ;
+
+    decoded.resize(lines * lineByteSize);
+    if (
+      !::DecodeChunk(
+        header.compression, bytes.data() + reader.offset, dataSize, decoded
+      )
+    ) {
+      spdlog::error("could not decode a chunk of exr file '{}'", filename);
+      return false;
+    }
+
+    for (size_t line = 0ul; line < lines; ++ line)
+    for (size_t c = 0ul; c < imageChannels.size(); ++ c) {
+      size_t const channelIdx = imageChannels[c];
+      auto const type = header.channels[channelIdx].type;
+      uint8_t const * channelData =
+        decoded.data() + line*lineByteSize + channelOffsets[channelIdx];
+
+      float * texels =
+        image.texels.data() + (firstLine + line)*width*image.channels + c;
+
+      for (size_t x = 0ul; x < width; ++ x) {
+        texels[x*image.channels] =
+          ::ReadValue(channelData + x*::PixelTypeByteSize(type), type);
+      }
+    }
+  }
+
+  return true;
+}
@@ -2,6 +2,7 @@
 
 #include <monte-toad/core/log.hpp>
 #include <monte-toad/core/texture.hpp>
+#include <monte-toad/util/exrloader.hpp>
 
 #pragma GCC diagnostic push
   #pragma GCC diagnostic ignored "-Wdouble-promotion"
@@ -9,27 +10,250 @@
   #include <stb_image.hpp>
 #pragma GCC diagnostic pop
 
+#include <glm/gtc/packing.hpp>
+
+#include <algorithm>
+#include <condition_variable>
+#include <deque>
 #include <filesystem>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace {
+
+// textures whose full resolution is larger than this are streamed through the
+// texture tile cache instead of being held in memory
+constexpr size_t streamingThreshold = 256ul << 20ul;
 
-mt::core::Texture mt::util::LoadTexture(std::string const & filename) {
-  stbi_set_flip_vertically_on_load(false);
+// decodes a file in its native precision; linear data (exr & radiance hdr)
+// is kept as floats, 8-bit data is kept as is unless it's linearized, in
+// which case it's converted once to halfs
+mt::core::Texture Decode(std::string const & filename, bool const linearize) {
+  // the flag is per thread, as textures are decoded on the loading threads
+  stbi_set_flip_vertically_on_load_thread(false);
+
+  auto const extension = std::filesystem::path(filename).extension().string();
+  if (extension == ".exr" || extension == ".EXR") {
+    mt::util::ExrImage image;
+    if (!mt::util::LoadExr(filename, image)) { return {}; }
+    return
+      mt::core::Texture::Construct(
+        image.width, image.height, image.channels
+      , mt::core::TexelFormat::Float, image.texels.data()
+      );
+  }
 
   int width, height, channels;
+
+  // loads the channels of the file as they are, rather than expanded to RGBA
+  if (stbi_is_hdr(filename.c_str())) {
+    float * rawData =
+      stbi_loadf(filename.c_str(), &width, &height, &channels, 0);
+
+    auto texture =
+      mt::core::Texture::Construct(
+        width, height, channels, mt::core::TexelFormat::Float, rawData
+      );
+
+    stbi_image_free(rawData);
+    return texture;
+  }
+
+  if (linearize) {
+    // stb removes the 2.2 gamma of ldr files when loading them as floats
+    float * rawData =
+      stbi_loadf(filename.c_str(), &width, &height, &channels, 0);
+
+    std::vector<uint16_t> halfs;
+    if (rawData) {
+      size_t const size =
+        static_cast<size_t>(width)*static_cast<size_t>(height)
+      * static_cast<size_t>(channels);
+      halfs.resize(size);
+      for (size_t i = 0ul; i < size; ++ i)
+        { halfs[i] = glm::packHalf1x16(rawData[i]); }
+    }
+
+    auto texture =
+      mt::core::Texture::Construct(
+        width, height, channels, mt::core::TexelFormat::Half
+      , rawData ? halfs.data() : nullptr
+      );
+
+    stbi_image_free(rawData);
+    return texture;
+  }
+
   uint8_t * rawByteData =
     stbi_load(
       filename.c_str(),
       &width, &height, &channels,
-      STBI_rgb_alpha
+      0
     );
 
   auto texture =
-    mt::core::Texture::Construct(width, height, channels, rawByteData);
+    mt::core::Texture::Construct(
+      width, height, channels, mt::core::TexelFormat::Unorm8, rawByteData
+    );
 
   stbi_image_free(rawByteData);
+  return texture;
+}
+
+void StreamIfLarge(
+  mt::core::Texture & texture
+, std::string const & filename
+, std::shared_ptr<mt::core::TextureTileCache> const & tileCache
+) {
+  if (
+      !texture.Valid() || !tileCache
+   || texture.width*texture.height*texture.TexelByteSize()
+   <= ::streamingThreshold
+  ) { return; }
 
+  std::error_code error;
+  auto const directory = std::filesystem::temp_directory_path(error);
+  if (
+      error
+   || !mt::core::StreamTexture(texture, tileCache, directory.string())
+  ) {
+    spdlog::error(
+      "could not stream texture '{}', it's held in memory instead", filename
+    );
+  }
+}
+
+mt::core::Texture Load(
+  std::string const & filename
+, bool const linearize
+, std::shared_ptr<mt::core::TextureTileCache> const & tileCache
+) {
+  auto texture = ::Decode(filename, linearize);
+  ::StreamIfLarge(texture, filename, tileCache);
   return texture;
 }
 
+// decodes queued textures on a thread per core, which are started by the
+// first asynchronous load & live until the process exits; textures that are
+// still queued then are dropped
+struct LoadingPool {
+  std::mutex mutex;
+  std::condition_variable wake;
+  std::deque<std::packaged_task<mt::core::Texture()>> tasks;
+  std::vector<std::thread> threads;
+  bool stopping = false;
+
+  LoadingPool() {
+    size_t const threadCount =
+      std::max(1u, std::thread::hardware_concurrency());
+    for (size_t i = 0ul; i < threadCount; ++ i)
+      { this->threads.emplace_back([this]() { this->Work(); }); }
+  }
+
+  ~LoadingPool() {
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->stopping = true;
+    }
+    this->wake.notify_all();
+    for (auto & thread : this->threads) { thread.join(); }
+  }
+
+  void Work() {
+    while (true) {
+      std::packaged_task<mt::core::Texture()> task;
+      {
+        std::unique_lock<std::mutex> lock(this->mutex);
+        this->wake.wait(
+          lock, [this]() { return this->stopping || !this->tasks.empty(); }
+        );
+        if (this->stopping) { return; }
+        task = std::move(this->tasks.front());
+        this->tasks.pop_front();
+      }
+      task();
+    }
+  }
+
+  mt::util::TextureLoad Push(
+    std::string const & filename
+  , bool const linearize
+  , std::shared_ptr<mt::core::TextureTileCache> tileCache
+  ) {
+    std::packaged_task<mt::core::Texture()> task(
+      [filename, linearize, tileCache = std::move(tileCache)]() {
+        return ::Load(filename, linearize, tileCache);
+      }
+    );
+
+    mt::util::TextureLoad load;
+    load.filename = filename;
+    load.texture = task.get_future();
+
+    {
+      std::lock_guard<std::mutex> lock(this->mutex);
+      this->tasks.emplace_back(std::move(task));
+    }
+    this->wake.notify_one();
+
+    return load;
+  }
+};
+
+::LoadingPool & Pool() {
+  static ::LoadingPool pool;
+  return pool;
+}
+
+} // -- namespace
+
+////////////////////////////////////////////////////////////////////////////////
+bool mt::util::TextureLoad::Ready() const {
+  return
+      this->texture.valid()
+   && this->texture.wait_for(std::chrono::seconds(0))
+   == std::future_status::ready
+  ;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+mt::core::Texture mt::util::TextureLoad::Take() {
+  return this->texture.get();
+}
+
+////////////////////////////////////////////////////////////////////////////////
+mt::core::Texture mt::util::LoadTexture(
+  std::string const & filename
+, std::shared_ptr<mt::core::TextureTileCache> const & tileCache
+) {
+  return ::Load(filename, false, tileCache);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+mt::core::Texture mt::util::LoadLinearTexture(
+  std::string const & filename
+, std::shared_ptr<mt::core::TextureTileCache> const & tileCache
+) {
+  return ::Load(filename, true, tileCache);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+mt::util::TextureLoad mt::util::LoadTextureAsync(
+  std::string const & filename
+, std::shared_ptr<mt::core::TextureTileCache> tileCache
+) {
+  return ::Pool().Push(filename, false, std::move(tileCache));
+}
+
+////////////////////////////////////////////////////////////////////////////////
+mt::util::TextureLoad mt::util::LoadLinearTextureAsync(
+  std::string const & filename
+, std::shared_ptr<mt::core::TextureTileCache> tileCache
+) {
+  return ::Pool().Push(filename, true, std::move(tileCache));
+}
+
 /* //////////////////////////////////////////////////////////////////////////////// */
 /* mt::CubemapTexture mt::CubemapTexture::Construct( */
 /*   std::string const & baseFilename */
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+// -- fwd decl
+namespace mt::core { struct IntegratorData; }
+
+// accumulation buffers store the sum of colors & amount of samples of each
+// pixel, which allows partial renders of the same frame (ei different seeds or
+// different machines) to be merged weighted by their sample counts
+
+namespace mt {
+  struct AccumulationBuffer {
+    glm::u16vec2 resolution = glm::u16vec2(0);
+    std::vector<glm::vec3> colorSum;
+    std::vector<uint64_t> sampleCount;
+  };
+
+  // resizes & clears buffer to resolution
+  void Allocate(
+    mt::AccumulationBuffer & self
+  , glm::u16vec2 const resolution
+  );
+
+  // converts the image of an integrator into an accumulation buffer
+  mt::AccumulationBuffer ToAccumulationBuffer(
+    mt::core::IntegratorData const & data
+  );
+
+  // adds other into self, returns false if resolutions do not match
+  bool Merge(
+    mt::AccumulationBuffer & self
+  , mt::AccumulationBuffer const & other
+  );
+
+  // resolves accumulated samples into a displayable image
+  std::vector<glm::vec4> Resolve(mt::AccumulationBuffer const & self);
+
+  bool SaveAccumulationBuffer(
+    mt::AccumulationBuffer const & self
+  , std::string const & filename
+  );
+
+  bool LoadAccumulationBuffer(
+    mt::AccumulationBuffer & self
+  , std::string const & filename
+  );
+}
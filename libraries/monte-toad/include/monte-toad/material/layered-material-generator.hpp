@@ -1,4 +1,30 @@
 #pragma once
 
-namespace mt::material {
+#include <monte-toad/material/layered.hpp>
+
+// -- offline generation of the precomputed tables of the layered material,
+//    the entries are integrated in parallel over the GGX visible normals, with
+//    samples (rounded down to a square number) stratified per entry. Each
+//    entry holds the value at the center of its cell, as the table lookups
+//    round down to the cell
+
+namespace mt::material::layered {
+  // directional albedo of GGX reflection weighted by the fresnel of an
+  // interface of relative complex index of refraction eta + i kappa; indexed
+  // by the incoming cosine, alpha, eta & kappa
+  mt::material::layered::FresnelMicrofacetTable GenerateFresnelMicrofacetTable(
+    glm::u32vec4 const & size
+  , glm::vec4 const & min, glm::vec4 const & max
+  , size_t const samples
+  );
+
+  // fraction of the visible microfacets that refract light out of a layer
+  // rather than totally internally reflecting it; indexed by the incoming
+  // cosine, alpha & the index of refraction of the layer above over the layer
+  mt::material::layered::TotalInternalReflectionTable
+  GenerateTotalInternalReflectionTable(
+    glm::u32vec3 const & size
+  , glm::vec3 const & min, glm::vec3 const & max
+  , size_t const samples
+  );
 }
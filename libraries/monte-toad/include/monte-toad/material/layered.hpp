@@ -1,5 +1,9 @@
 #pragma once
 
+#include <monte-toad/core/span.hpp>
+
+#include <memory>
+#include <string>
 #include <vector>
 
 // implements layered material as laid out in
@@ -11,13 +15,30 @@ namespace mt { struct PluginInfoRandom; }
 
 namespace mt::material::layered {
 
-  struct FresnelMicrofacetTable {
+  // values of a precomputed table, either generated in memory or mapped from a
+  // table file; it's shared between copies of the table
+  struct TableStorage {
+    TableStorage() = default;
+    TableStorage(TableStorage const &) = delete;
+    TableStorage & operator=(TableStorage const &) = delete;
+    ~TableStorage();
+
     std::vector<float> buffer;
+
+    // mapped table file, which values points into
+    void * mapping = nullptr;
+    size_t mappingLength = 0ul;
+
+    span<float const> values;
+  };
+
+  struct FresnelMicrofacetTable {
+    std::shared_ptr<TableStorage const> storage;
     // each element corresponds to an index T, A, N, K
     glm::u32vec4 size;
     glm::vec4 min, max;
 
-    // if buffer is empty use this
+    // if there is no storage use this
     glm::vec3 fresnelConstant = glm::vec3(0.0f);
 
     float Get(glm::vec4 const & idx) const;
@@ -30,17 +51,40 @@ namespace mt::material::layered {
   };
 
   struct TotalInternalReflectionTable {
-    std::vector<float> buffer;
+    std::shared_ptr<TableStorage const> storage;
     // each element corresponds to an index T, A, N
     glm::u32vec3 size;
     glm::vec3 min, max;
 
-    // if buffer is empty use this
+    // if there is no storage use this
     float tirConstant = 0.0f;
 
     float Get(glm::vec3 const & idx) const;
   };
 
+  // -- table files; a header followed by the values, which are memory mapped
+  //    when loaded so they're only paged in as they're read, & are shared
+  //    between processes rendering with the same tables
+  bool SaveTable(
+    mt::material::layered::FresnelMicrofacetTable const & self
+  , std::string const & filename
+  );
+
+  bool SaveTable(
+    mt::material::layered::TotalInternalReflectionTable const & self
+  , std::string const & filename
+  );
+
+  bool LoadTable(
+    mt::material::layered::FresnelMicrofacetTable & self
+  , std::string const & filename
+  );
+
+  bool LoadTable(
+    mt::material::layered::TotalInternalReflectionTable & self
+  , std::string const & filename
+  );
+
 
   struct Data {
     struct Layer {
@@ -0,0 +1,198 @@
+#include <monte-toad/accumulationbuffer.hpp>
+
+#include <monte-toad/core/integratordata.hpp>
+#include <monte-toad/core/log.hpp>
+
+#include <cstring>
+#include <fstream>
+
+namespace {
+
+// file layout; header, resolution.x*resolution.y colorSum (3 floats), then
+// resolution.x*resolution.y sampleCount (uint64)
+struct FileHeader {
+  char magic[8];
+  uint32_t version;
+  uint16_t width, height;
+};
+
+constexpr char fileMagic[8] = { 'm', 't', '-', 'a', 'c', 'c', 'u', 'm' };
+constexpr uint32_t fileVersion = 1u;
+
+} // -- namespace
+
+////////////////////////////////////////////////////////////////////////////////
+void mt::Allocate(
+  mt::AccumulationBuffer & self
+, glm::u16vec2 const resolution
+) {
+  // widened before multiplying, as u16 components promote to a signed int
+  size_t const pixelLength =
+    static_cast<size_t>(resolution.x) * static_cast<size_t>(resolution.y);
+
+  self.resolution = resolution;
+  self.colorSum.assign(pixelLength, glm::vec3(0.0f));
+  self.sampleCount.assign(pixelLength, 0ul);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+mt::AccumulationBuffer mt::ToAccumulationBuffer(
+  mt::core::IntegratorData const & data
+) {
+  mt::AccumulationBuffer self;
+  mt::Allocate(self, data.imageResolution);
+
+  for (size_t idx = 0ul; idx < self.colorSum.size(); ++ idx) {
+    self.colorSum[idx] = mt::core::AccumulatedColor(data, idx);
+    self.sampleCount[idx] = data.pixelCountBuffer[idx];
+  }
+
+  return self;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool mt::Merge(
+  mt::AccumulationBuffer & self
+, mt::AccumulationBuffer const & other
+) {
+  if (self.resolution != other.resolution) {
+    spdlog::error(
+      "can not merge accumulation buffers of resolution {} and {}"
+    , self.resolution, other.resolution
+    );
+    return false;
+  }
+
+  for (size_t idx = 0ul; idx < self.colorSum.size(); ++ idx) {
+    self.colorSum[idx] += other.colorSum[idx];
+    self.sampleCount[idx] += other.sampleCount[idx];
+  }
+
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+std::vector<glm::vec4> mt::Resolve(mt::AccumulationBuffer const & self) {
+  std::vector<glm::vec4> image(self.colorSum.size(), glm::vec4(0.0f));
+
+  for (size_t idx = 0ul; idx < image.size(); ++ idx) {
+    if (self.sampleCount[idx] == 0ul) { continue; }
+    image[idx] =
+      glm::vec4(
+        self.colorSum[idx] / static_cast<float>(self.sampleCount[idx])
+      , 1.0f
+      );
+  }
+
+  return image;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool mt::SaveAccumulationBuffer(
+  mt::AccumulationBuffer const & self
+, std::string const & filename
+) {
+  auto file = std::ofstream{filename, std::ios::binary};
+  if (!file.good()) {
+    spdlog::error("could not open accumulation buffer '{}'", filename);
+    return false;
+  }
+
+  ::FileHeader header;
+  std::memcpy(header.magic, ::fileMagic, sizeof(::fileMagic));
+  header.version = ::fileVersion;
+  header.width  = self.resolution.x;
+  header.height = self.resolution.y;
+
+  file.write(reinterpret_cast<char const *>(&header), sizeof(::FileHeader));
+  file.write(
+    reinterpret_cast<char const *>(self.colorSum.data())
+  , static_cast<std::streamsize>(self.colorSum.size()*sizeof(glm::vec3))
+  );
+  file.write(
+    reinterpret_cast<char const *>(self.sampleCount.data())
+  , static_cast<std::streamsize>(self.sampleCount.size()*sizeof(uint64_t))
+  );
+
+  if (!file.good()) {
+    spdlog::error("failed to write accumulation buffer '{}'", filename);
+    return false;
+  }
+
+  spdlog::info("Saved accumulation buffer {}", filename);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool mt::LoadAccumulationBuffer(
+  mt::AccumulationBuffer & self
+, std::string const & filename
+) {
+  auto file = std::ifstream{filename, std::ios::binary};
+  if (!file.good()) {
+    spdlog::error("could not open accumulation buffer '{}'", filename);
+    return false;
+  }
+
+  ::FileHeader header;
+  file.read(reinterpret_cast<char *>(&header), sizeof(::FileHeader));
+
+  if (
+      !file.good()
+   || std::memcmp(header.magic, ::fileMagic, sizeof(::fileMagic)) != 0
+  ) {
+    spdlog::error("'{}' is not an accumulation buffer", filename);
+    return false;
+  }
+
+  if (header.version != ::fileVersion) {
+    spdlog::error(
+      "accumulation buffer '{}' has unsupported version {}"
+    , filename, header.version
+    );
+    return false;
+  }
+
+  // the file must hold every pixel before they're allocated, otherwise a
+  // corrupt header could request gigabytes that fail to allocate
+  size_t const
+    pixelLength =
+      static_cast<size_t>(header.width) * static_cast<size_t>(header.height)
+  , expectedSize =
+      sizeof(::FileHeader)
+    + pixelLength*(sizeof(glm::vec3) + sizeof(uint64_t))
+  ;
+
+  file.seekg(0, std::ios::end);
+  auto const fileSize = file.tellg();
+  file.seekg(static_cast<std::streamoff>(sizeof(::FileHeader)), std::ios::beg);
+
+  if (
+      !file.good() || fileSize < 0
+   || static_cast<size_t>(fileSize) != expectedSize
+  ) {
+    spdlog::error(
+      "accumulation buffer '{}' of {}x{} pixels should be {} bytes"
+    , filename, header.width, header.height, expectedSize
+    );
+    return false;
+  }
+
+  mt::Allocate(self, glm::u16vec2(header.width, header.height));
+
+  file.read(
+    reinterpret_cast<char *>(self.colorSum.data())
+  , static_cast<std::streamsize>(self.colorSum.size()*sizeof(glm::vec3))
+  );
+  file.read(
+    reinterpret_cast<char *>(self.sampleCount.data())
+  , static_cast<std::streamsize>(self.sampleCount.size()*sizeof(uint64_t))
+  );
+
+  if (!file.good()) {
+    spdlog::error("accumulation buffer '{}' is truncated", filename);
+    return false;
+  }
+
+  return true;
+}
@@ -0,0 +1,201 @@
+#include <monte-toad/material/layered-material-generator.hpp>
+
+#include <monte-toad/core/log.hpp>
+#include <monte-toad/core/microfacet.hpp>
+
+#include <utility>
+
+namespace {
+
+// unpolarized fresnel reflectance of a conductor, which for a kappa of 0 is
+// the dielectric fresnel, including total internal reflection for an eta
+// below 1
+float FresnelConductor(
+  float const cosTheta
+, float const eta
+, float const kappa
+) {
+  float const
+    cos2 = cosTheta*cosTheta
+  , sin2 = 1.0f - cos2
+  , eta2 = eta*eta
+  , kappa2 = kappa*kappa
+  , t0 = eta2 - kappa2 - sin2
+  , a2b2 = glm::sqrt(t0*t0 + 4.0f*eta2*kappa2)
+  , t1 = a2b2 + cos2
+  , a = glm::sqrt(glm::max(0.0f, 0.5f*(a2b2 + t0)))
+  , t2 = 2.0f*cosTheta*a
+  , rs = (t1 - t2)/(t1 + t2)
+  , t3 = cos2*a2b2 + sin2*sin2
+  , t4 = t2*sin2
+  , rp = rs*(t3 - t4)/(t3 + t4)
+  ;
+  return 0.5f*(rp + rs);
+}
+
+// averages the estimator over stratified visible normals of wi
+template <typename Fn> float Integrate(
+  float const cosTheta
+, float const alpha
+, size_t const strata
+, Fn && estimator
+) {
+  float const sinTheta = glm::sqrt(glm::max(0.0f, 1.0f - cosTheta*cosTheta));
+  glm::vec3 const wi = glm::vec3(sinTheta, 0.0f, cosTheta);
+
+  float sum = 0.0f;
+  for (size_t x = 0ul; x < strata; ++ x)
+  for (size_t y = 0ul; y < strata; ++ y) {
+    glm::vec2 const u =
+      (glm::vec2(x, y) + glm::vec2(0.5f)) / static_cast<float>(strata);
+
+    sum += estimator(wi, mt::core::GgxSampleVisibleNormal(wi, alpha, u));
+  }
+
+  return sum / static_cast<float>(strata*strata);
+}
+
+size_t Strata(size_t const samples) {
+  return
+    glm::max(
+      1ul
+    , static_cast<size_t>(glm::sqrt(static_cast<double>(samples)))
+    );
+}
+
+template <glm::length_t L> glm::vec<L, float> CellCenter(
+  glm::vec<L, uint32_t> const & idx
+, glm::vec<L, uint32_t> const & size
+, glm::vec<L, float> const & min, glm::vec<L, float> const & max
+) {
+  return
+    min
+  + (glm::vec<L, float>(idx) + 0.5f) / glm::vec<L, float>(size) * (max - min);
+}
+
+// cosines of exactly 0 have no visible microfacets
+float EntryCosTheta(float const cosTheta) {
+  return glm::clamp(cosTheta, 1e-3f, 1.0f);
+}
+
+float EntryAlpha(float const alpha) {
+  return glm::clamp(alpha, mt::core::ggxMinAlpha, 1.0f);
+}
+
+} // -- namespace
+
+////////////////////////////////////////////////////////////////////////////////
+mt::material::layered::FresnelMicrofacetTable
+mt::material::layered::GenerateFresnelMicrofacetTable(
+  glm::u32vec4 const & size
+, glm::vec4 const & min, glm::vec4 const & max
+, size_t const samples
+) {
+  auto storage = std::make_shared<mt::material::layered::TableStorage>();
+  storage->buffer.resize(size.x*size.y*size.z*size.w);
+
+  size_t const strata = ::Strata(samples);
+
+  spdlog::info(
+    "Generating fresnel microfacet table of {} entries", storage->buffer.size()
+  );
+
+  // entries differ a lot in cost as the fresnel of conductors is more
+  // expensive, so they're scheduled dynamically
+  auto & buffer = storage->buffer;
+  #pragma omp parallel for schedule(dynamic, 64)
+  for (size_t flatIdx = 0ul; flatIdx < buffer.size(); ++ flatIdx) {
+    // same order as the lookup; T, A, N, K with K changing fastest
+    size_t it = flatIdx;
+    glm::u32vec4 idx;
+    idx.w = static_cast<uint32_t>(it % size.w); it /= size.w;
+    idx.z = static_cast<uint32_t>(it % size.z); it /= size.z;
+    idx.y = static_cast<uint32_t>(it % size.y); it /= size.y;
+    idx.x = static_cast<uint32_t>(it);
+
+    glm::vec4 const entry = ::CellCenter(idx, size, min, max);
+    float const
+      alpha = ::EntryAlpha(entry.y)
+    , eta = glm::max(entry.z, 1e-3f)
+    , kappa = glm::max(entry.w, 0.0f)
+    ;
+
+    buffer[flatIdx] =
+      ::Integrate(
+        ::EntryCosTheta(entry.x), alpha, strata
+      , [alpha, eta, kappa](glm::vec3 const & wi, glm::vec3 const & h) {
+          glm::vec3 const wo = glm::reflect(-wi, h);
+          if (wo.z <= 0.0f) { return 0.0f; }
+          return
+            ::FresnelConductor(glm::dot(wi, h), eta, kappa)
+          * mt::core::GgxG2(wi, wo, alpha) / mt::core::GgxG1(wi, alpha);
+        }
+      );
+  }
+
+  storage->values = make_span(std::as_const(storage->buffer));
+
+  mt::material::layered::FresnelMicrofacetTable table;
+  table.storage = std::move(storage);
+  table.size = size;
+  table.min = min;
+  table.max = max;
+  return table;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+mt::material::layered::TotalInternalReflectionTable
+mt::material::layered::GenerateTotalInternalReflectionTable(
+  glm::u32vec3 const & size
+, glm::vec3 const & min, glm::vec3 const & max
+, size_t const samples
+) {
+  auto storage = std::make_shared<mt::material::layered::TableStorage>();
+  storage->buffer.resize(size.x*size.y*size.z);
+
+  size_t const strata = ::Strata(samples);
+
+  spdlog::info(
+    "Generating total internal reflection table of {} entries"
+  , storage->buffer.size()
+  );
+
+  auto & buffer = storage->buffer;
+  #pragma omp parallel for schedule(dynamic, 64)
+  for (size_t flatIdx = 0ul; flatIdx < buffer.size(); ++ flatIdx) {
+    // same order as the lookup; T, A, N with N changing fastest
+    size_t it = flatIdx;
+    glm::u32vec3 idx;
+    idx.z = static_cast<uint32_t>(it % size.z); it /= size.z;
+    idx.y = static_cast<uint32_t>(it % size.y); it /= size.y;
+    idx.x = static_cast<uint32_t>(it);
+
+    glm::vec3 const entry = ::CellCenter(idx, size, min, max);
+
+    // light leaves the layer, so it refracts with the index of refraction of
+    // the layer over the layer above
+    float const
+      alpha = ::EntryAlpha(entry.y)
+    , eta = 1.0f / glm::max(entry.z, 1e-3f)
+    ;
+
+    buffer[flatIdx] =
+      ::Integrate(
+        ::EntryCosTheta(entry.x), alpha, strata
+      , [eta](glm::vec3 const & wi, glm::vec3 const & h) {
+          // refract returns 0 on total internal reflection
+          glm::vec3 const wo = glm::refract(-wi, h, eta);
+          return wo.z < 0.0f ? 1.0f : 0.0f;
+        }
+      );
+  }
+
+  storage->values = make_span(std::as_const(storage->buffer));
+
+  mt::material::layered::TotalInternalReflectionTable table;
+  table.storage = std::move(storage);
+  table.size = size;
+  table.min = min;
+  table.max = max;
+  return table;
+}
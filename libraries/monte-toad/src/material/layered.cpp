@@ -7,6 +7,14 @@
 #include <monte-toad/core/surfaceinfo.hpp>
 #include <mt-plugin/plugin.hpp>
 
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <fstream>
+
 /*
 
   A lot of documentation here is most likely just repeated information from the
@@ -940,8 +948,211 @@ glm::vec3 Evaluate(
   return bsdfValue;
 }
 
+// -- table files; header, then the values in the order of the table buffer
+struct TableFileHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t dimensions;
+  uint32_t size[4];
+  float min[4], max[4];
+};
+
+constexpr char tableFileMagic[8] = { 'm', 't', '-', 't', 'a', 'b', 'l', 'e' };
+constexpr uint32_t tableFileVersion = 1u;
+
+bool SaveTableFile(
+  std::string const & filename
+, uint32_t const dimensions
+, uint32_t const * size, float const * min, float const * max
+, span<float const> values
+) {
+  auto file = std::ofstream{filename, std::ios::binary};
+  if (!file.good()) {
+    spdlog::error("could not open table '{}'", filename);
+    return false;
+  }
+
+  ::TableFileHeader header;
+  std::memset(&header, 0, sizeof(::TableFileHeader));
+  std::memcpy(header.magic, ::tableFileMagic, sizeof(::tableFileMagic));
+  header.version = ::tableFileVersion;
+  header.dimensions = dimensions;
+  for (uint32_t i = 0u; i < 4u; ++ i) {
+    header.size[i] = i < dimensions ? size[i] : 1u;
+    header.min[i]  = i < dimensions ? min[i]  : 0.0f;
+    header.max[i]  = i < dimensions ? max[i]  : 1.0f;
+  }
+
+  file.write(
+    reinterpret_cast<char const *>(&header), sizeof(::TableFileHeader)
+  );
+  file.write(
+    reinterpret_cast<char const *>(values.data())
+  , static_cast<std::streamsize>(values.size()*sizeof(float))
+  );
+
+  if (!file.good()) {
+    spdlog::error("failed to write table '{}'", filename);
+    return false;
+  }
+
+  spdlog::info("Saved table {}", filename);
+  return true;
+}
+
+// maps the file rather than reading it, so a table is only paged in as it's
+// looked up & shares its pages with every other process using it
+std::shared_ptr<mt::material::layered::TableStorage const> LoadTableFile(
+  std::string const & filename
+, uint32_t const dimensions
+, uint32_t * size, float * min, float * max
+) {
+  int const fd = open(filename.c_str(), O_RDONLY);
+  if (fd < 0) {
+    spdlog::error("could not open table '{}'", filename);
+    return nullptr;
+  }
+
+  struct stat info;
+  if (
+      fstat(fd, &info) != 0
+   || static_cast<size_t>(info.st_size) < sizeof(::TableFileHeader)
+  ) {
+    spdlog::error("'{}' is not a table", filename);
+    close(fd);
+    return nullptr;
+  }
+
+  size_t const length = static_cast<size_t>(info.st_size);
+  void * const mapping = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+
+  if (mapping == MAP_FAILED) {
+    spdlog::error("could not map table '{}'", filename);
+    return nullptr;
+  }
+
+  // the storage owns the mapping from here, unmapping it on any failure
+  auto storage = std::make_shared<mt::material::layered::TableStorage>();
+  storage->mapping = mapping;
+  storage->mappingLength = length;
+
+  ::TableFileHeader header;
+  std::memcpy(&header, mapping, sizeof(::TableFileHeader));
+
+  if (std::memcmp(header.magic, ::tableFileMagic, sizeof(::tableFileMagic))) {
+    spdlog::error("'{}' is not a table", filename);
+    return nullptr;
+  }
+
+  if (header.version != ::tableFileVersion) {
+    spdlog::error(
+      "table '{}' has version {}, expected {}"
+    , filename, header.version, ::tableFileVersion
+    );
+    return nullptr;
+  }
+
+  if (header.dimensions != dimensions) {
+    spdlog::error(
+      "table '{}' has {} dimensions, expected {}"
+    , filename, header.dimensions, dimensions
+    );
+    return nullptr;
+  }
+
+  size_t count = 1ul;
+  for (uint32_t i = 0u; i < 4u; ++ i) { count *= header.size[i]; }
+
+  if (count == 0ul || length != sizeof(::TableFileHeader) + count*sizeof(float))
+  {
+    spdlog::error("table '{}' is truncated or malformed", filename);
+    return nullptr;
+  }
+
+  for (uint32_t i = 0u; i < dimensions; ++ i) {
+    size[i] = header.size[i];
+    min[i]  = header.min[i];
+    max[i]  = header.max[i];
+  }
+
+  storage->values =
+    span<float const>(
+      reinterpret_cast<float const *>(
+        reinterpret_cast<char const *>(mapping) + sizeof(::TableFileHeader)
+      )
+    , count
+    );
+
+  spdlog::info("Loaded table {}", filename);
+  return storage;
+}
+
 } // -- namescape
 
+////////////////////////////////////////////////////////////////////////////////
+mt::material::layered::TableStorage::~TableStorage() {
+  if (this->mapping) { munmap(this->mapping, this->mappingLength); }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool mt::material::layered::SaveTable(
+  mt::material::layered::FresnelMicrofacetTable const & self
+, std::string const & filename
+) {
+  if (!self.storage) {
+    spdlog::error("can not save an empty table to '{}'", filename);
+    return false;
+  }
+
+  return
+    ::SaveTableFile(
+      filename, 4u, &self.size[0], &self.min[0], &self.max[0]
+    , self.storage->values
+    );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool mt::material::layered::SaveTable(
+  mt::material::layered::TotalInternalReflectionTable const & self
+, std::string const & filename
+) {
+  if (!self.storage) {
+    spdlog::error("can not save an empty table to '{}'", filename);
+    return false;
+  }
+
+  return
+    ::SaveTableFile(
+      filename, 3u, &self.size[0], &self.min[0], &self.max[0]
+    , self.storage->values
+    );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool mt::material::layered::LoadTable(
+  mt::material::layered::FresnelMicrofacetTable & self
+, std::string const & filename
+) {
+  auto storage =
+    ::LoadTableFile(filename, 4u, &self.size[0], &self.min[0], &self.max[0]);
+  if (!storage) { return false; }
+  self.storage = std::move(storage);
+  return true;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+bool mt::material::layered::LoadTable(
+  mt::material::layered::TotalInternalReflectionTable & self
+, std::string const & filename
+) {
+  auto storage =
+    ::LoadTableFile(filename, 3u, &self.size[0], &self.min[0], &self.max[0]);
+  if (!storage) { return false; }
+  self.storage = std::move(storage);
+  return true;
+}
+
 float mt::material::layered::FresnelMicrofacetTable::Get(
   glm::vec4 const & idx
 ) const {
@@ -955,7 +1166,7 @@ float mt::material::layered::FresnelMicrofacetTable::Get(
   // TODO linear interpolation
 
   // non-linear interpolation
-  return this->buffer[bufferIdx ];
+  return this->storage->values[bufferIdx];
 }
 
 glm::vec3 mt::material::layered::FresnelMicrofacetTable::Get(
@@ -964,8 +1175,7 @@ glm::vec3 mt::material::layered::FresnelMicrofacetTable::Get(
 , glm::vec3 const & n
 , glm::vec3 const & k
 ) const {
-  if (this->buffer.size() == 0) { return this->fresnelConstant; }
-  return glm::vec3(1.0f);
+  if (!this->storage) { return this->fresnelConstant; }
   return
     glm::vec3(
       this->Get(glm::vec4(t, a, n.x, k.x))
@@ -977,7 +1187,7 @@ glm::vec3 mt::material::layered::FresnelMicrofacetTable::Get(
 float mt::material::layered::TotalInternalReflectionTable::Get(
   glm::vec3 const & idx
 ) const {
-  if (this->buffer.size() == 0) { return this->tirConstant; }
+  if (!this->storage) { return this->tirConstant; }
 
   // grab floating point idx
   const glm::vec3 flIdx = glm::vec3(size) * (idx - min)/(max - min);
@@ -993,7 +1203,7 @@ float mt::material::layered::TotalInternalReflectionTable::Get(
   /* glm::uvec3 middleIndices = intIdx; */
 
   // non-linear interpolation
-  return this->buffer[bufferIdx];
+  return this->storage->values[bufferIdx];
 }
 
 float mt::material::layered::BsdfPdf(
@@ -79,10 +79,29 @@ void LoadPluginFunctions(mt::PluginInfo & plugin , Plugin & ctx) {
     case mt::PluginType::Integrator: {
       auto & unit = plugin.integrators[ctx.idx];
       ctx.LoadFunction(unit.Dispatch, "Dispatch", Plugin::Optional::Yes);
+      ctx.LoadFunction(
+        unit.DispatchPrimaryHit, "DispatchPrimaryHit", Plugin::Optional::Yes
+      );
       ctx.LoadFunction(
         unit.DispatchRealtime, "DispatchRealtime", Plugin::Optional::Yes
       );
+      ctx.LoadFunction(
+        unit.DispatchRealtimeChannels, "DispatchRealtimeChannels"
+      , Plugin::Optional::Yes
+      );
+      ctx.LoadFunction(
+        unit.ChannelCount, "ChannelCount", Plugin::Optional::Yes
+      );
+      ctx.LoadFunction(
+        unit.ChannelLabel, "ChannelLabel", Plugin::Optional::Yes
+      );
       ctx.LoadFunction(unit.UiUpdate, "UiUpdate", Plugin::Optional::Yes);
+      ctx.LoadFunction(
+        unit.DispatchCycle, "DispatchCycle", Plugin::Optional::Yes
+      );
+      ctx.LoadFunction(
+        unit.RegisterAovs, "RegisterAovs", Plugin::Optional::Yes
+      );
       ctx.LoadFunction(unit.RealTime, "RealTime");
       ctx.LoadFunction(unit.PluginType, "PluginType");
       ctx.LoadFunction(unit.PluginLabel, "PluginLabel");
@@ -110,6 +129,13 @@ void LoadPluginFunctions(mt::PluginInfo & plugin , Plugin & ctx) {
       ctx.LoadFunction(unit.BsdfFs, "BsdfFs");
       ctx.LoadFunction(unit.BsdfPdf, "BsdfPdf");
       ctx.LoadFunction(unit.AlbedoApproximation, "AlbedoApproximation");
+      ctx.LoadFunction(
+        unit.BsdfSampleBatch, "BsdfSampleBatch", Plugin::Optional::Yes
+      );
+      ctx.LoadFunction(unit.BsdfFsBatch, "BsdfFsBatch", Plugin::Optional::Yes);
+      ctx.LoadFunction(
+        unit.BsdfPdfBatch, "BsdfPdfBatch", Plugin::Optional::Yes
+      );
       ctx.LoadFunction(unit.IsEmitter, "IsEmitter");
       ctx.LoadFunction(unit.BsdfType, "BsdfType");
       ctx.LoadFunction(unit.UiUpdate, "UiUpdate", Plugin::Optional::Yes);
@@ -121,11 +147,13 @@ void LoadPluginFunctions(mt::PluginInfo & plugin , Plugin & ctx) {
       ctx.LoadFunction(unit.Allocate, "Allocate");
       ctx.LoadFunction(unit.IsEmitter, "IsEmitter");
       ctx.LoadFunction(unit.Sample, "Sample");
+      ctx.LoadFunction(unit.SampleBatch, "SampleBatch", Plugin::Optional::Yes);
       ctx.LoadFunction(unit.Pdf, "Pdf");
       ctx.LoadFunction(unit.IndirectPdf, "IndirectPdf");
       ctx.LoadFunction(unit.EmitterFs, "EmitterFs");
       ctx.LoadFunction(unit.BsdfFs, "BsdfFs");
       ctx.LoadFunction(unit.AlbedoApproximation, "AlbedoApproximation");
+      ctx.LoadFunction(unit.Compile, "Compile", Plugin::Optional::Yes);
       ctx.LoadFunction(unit.UiUpdate, "UiUpdate");
       ctx.LoadFunction(unit.PluginType, "PluginType");
       ctx.LoadFunction(unit.PluginLabel, "PluginLabel");
@@ -173,6 +201,9 @@ void LoadPluginFunctions(mt::PluginInfo & plugin , Plugin & ctx) {
     case mt::PluginType::Dispatcher: {
       auto & unit = plugin.dispatchers[ctx.idx];
       ctx.LoadFunction(unit.DispatchRender, "DispatchRender");
+      ctx.LoadFunction(
+        unit.DispatchRegion, "DispatchRegion", Plugin::Optional::Yes
+      );
       ctx.LoadFunction(unit.UiUpdate, "UiUpdate");
       ctx.LoadFunction(unit.PluginType, "PluginType");
       ctx.LoadFunction(unit.PluginLabel, "PluginLabel");
@@ -252,6 +283,11 @@ bool mt::Valid(
        && (
             plugin.integrators[idx].Dispatch != nullptr
          || plugin.integrators[idx].DispatchRealtime != nullptr
+         || (
+              plugin.integrators[idx].DispatchRealtimeChannels != nullptr
+           && plugin.integrators[idx].ChannelCount != nullptr
+           && plugin.integrators[idx].ChannelLabel != nullptr
+            )
           )
        && plugin.integrators[idx].PluginType != nullptr
        && plugin.integrators[idx].PluginType() == pluginType
@@ -358,8 +394,14 @@ void mt::Clean(
   switch (pluginType) {
     case mt::PluginType::Integrator:
       plugin.integrators[idx].Dispatch = nullptr;
+      plugin.integrators[idx].DispatchPrimaryHit = nullptr;
       plugin.integrators[idx].DispatchRealtime = nullptr;
+      plugin.integrators[idx].DispatchRealtimeChannels = nullptr;
+      plugin.integrators[idx].ChannelCount = nullptr;
+      plugin.integrators[idx].ChannelLabel = nullptr;
       plugin.integrators[idx].UiUpdate = nullptr;
+      plugin.integrators[idx].DispatchCycle = nullptr;
+      plugin.integrators[idx].RegisterAovs = nullptr;
       plugin.integrators[idx].RealTime = nullptr;
       plugin.integrators[idx].PluginType = nullptr;
       plugin.integrators[idx].PluginLabel = nullptr;
@@ -383,6 +425,9 @@ void mt::Clean(
       plugin.bsdfs[idx].BsdfPdf             = nullptr;
       plugin.bsdfs[idx].AlbedoApproximation = nullptr;
       plugin.bsdfs[idx].BsdfSample          = nullptr;
+      plugin.bsdfs[idx].BsdfSampleBatch     = nullptr;
+      plugin.bsdfs[idx].BsdfFsBatch         = nullptr;
+      plugin.bsdfs[idx].BsdfPdfBatch        = nullptr;
       plugin.bsdfs[idx].IsEmitter           = nullptr;
       plugin.bsdfs[idx].BsdfType            = nullptr;
       plugin.bsdfs[idx].Allocate            = nullptr;
@@ -394,11 +439,13 @@ void mt::Clean(
       plugin.material.Allocate            = nullptr;
       plugin.material.IsEmitter           = nullptr;
       plugin.material.Sample              = nullptr;
+      plugin.material.SampleBatch         = nullptr;
       plugin.material.Pdf                 = nullptr;
       plugin.material.IndirectPdf         = nullptr;
       plugin.material.EmitterFs           = nullptr;
       plugin.material.BsdfFs              = nullptr;
       plugin.material.AlbedoApproximation = nullptr;
+      plugin.material.Compile             = nullptr;
       plugin.material.PluginType          = nullptr;
       plugin.material.PluginLabel         = nullptr;
     break;
@@ -437,6 +484,7 @@ void mt::Clean(
     break;
     case mt::PluginType::Dispatcher:
       plugin.dispatchers[idx].DispatchRender = nullptr;
+      plugin.dispatchers[idx].DispatchRegion = nullptr;
       plugin.dispatchers[idx].UiUpdate = nullptr;
       plugin.dispatchers[idx].PluginType = nullptr;
       plugin.dispatchers[idx].PluginLabel = nullptr;
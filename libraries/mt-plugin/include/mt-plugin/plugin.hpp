@@ -18,12 +18,15 @@
 // TODO implement functional instead of ptrs
 
 namespace mt::core { struct Any; }
+namespace mt::core { struct AovSample; }
+namespace mt::core { struct BsdfBatch; }
 namespace mt::core { struct BsdfSampleInfo; }
 namespace mt::core { struct BvhIntersection; }
 namespace mt::core { struct CameraInfo; }
 namespace mt::core { struct IntegratorData; }
 namespace mt::core { struct RenderInfo; }
 namespace mt::core { struct Scene; }
+namespace mt::core { struct SurfaceBatch; }
 namespace mt::core { struct SurfaceInfo; }
 namespace mt::core { struct Triangle; }
 namespace mt::core { struct TriangleMesh; }
@@ -40,15 +43,31 @@ namespace mt {
   };
 
   struct PluginInfoIntegrator {
+    // aovs receives the values the sample writes to the output channels of
+    // the integrator, which are accumulated if the sample is valid
     PixelInfo (*Dispatch)(
       glm::vec2 const & uv
     , mt::core::Scene const & scene
     , mt::core::CameraInfo const & camera
     , mt::PluginInfo const & plugin
     , mt::core::IntegratorData const & integratorData
+    , mt::core::AovSample & aovs
     , void (*debugPathRecorder)(mt::debugutil::IntegratorPathUnit)
     ) = nullptr;
 
+    // optional, Dispatch continued from the primary hit, which the dispatcher
+    // traced & propagated the ray cone of, so it can sample the bsdfs of the
+    // hits sharing a material in a single call. bsdf is the sample of the
+    // primary hit if it's valid & not an emitter, otherwise nullptr
+    PixelInfo (*DispatchPrimaryHit)(
+      mt::core::SurfaceInfo const & surface
+    , mt::core::BsdfSampleInfo const * bsdf
+    , mt::core::Scene const & scene
+    , mt::PluginInfo const & plugin
+    , mt::core::IntegratorData const & integratorData
+    , mt::core::AovSample & aovs
+    ) = nullptr;
+
     PixelInfo (*DispatchRealtime)(
       glm::vec2 const & uv
     , mt::core::SurfaceInfo const & surface
@@ -57,6 +76,24 @@ namespace mt {
     , mt::core::IntegratorData const & integratorData
     ) = nullptr;
 
+    // optional, realtime integrators that write every channel of a pixel in
+    // a single call (such as a g-buffer) instead of DispatchRealtime; channels
+    // holds ChannelCount() values & the returned color is displayed. The
+    // previous camera is the camera of the previous realtime dispatch
+    PixelInfo (*DispatchRealtimeChannels)(
+      glm::vec2 const & uv
+    , mt::core::SurfaceInfo const & surface
+    , mt::core::Scene const & scene
+    , mt::core::CameraInfo const & camera
+    , mt::core::CameraInfo const & previousCamera
+    , mt::PluginInfo const & plugin
+    , mt::core::IntegratorData const & integratorData
+    , glm::vec3 * channels
+    ) = nullptr;
+
+    size_t (*ChannelCount)() = nullptr;
+    char const * (*ChannelLabel)(size_t channel) = nullptr;
+
     void (*UiUpdate)(
       mt::core::Scene & scene
     , mt::core::RenderInfo & render
@@ -64,6 +101,20 @@ namespace mt {
     , mt::core::IntegratorData & integratorData
     ) = nullptr;
 
+    // optional, called by the dispatcher before each progressive pass of an
+    // offline integrator, so state learnt from previous passes can be updated
+    // while no Dispatch is in flight. dispatchedCycles is 1 on the first pass
+    // after the buffers have been cleared
+    void (*DispatchCycle)(
+      mt::core::Scene const & scene
+    , mt::PluginInfo const & plugin
+    , mt::core::IntegratorData const & integratorData
+    ) = nullptr;
+
+    // optional, registers the output channels the integrator writes to, see
+    // mt::core::RegisterAov
+    void (*RegisterAovs)(mt::core::IntegratorData & integratorData) = nullptr;
+
     bool (*RealTime)();
     mt::PluginType (*PluginType)();
     char const * (*PluginLabel)();
@@ -165,6 +216,30 @@ namespace mt {
     , glm::vec3 const & wo
     ) = nullptr;
 
+    // optional, batched variants of the above evaluating every surface of the
+    // batch with the same userdata, see monte-toad/core/bsdfbatch.hpp; the
+    // index of refraction is given per surface
+    void (*BsdfSampleBatch)(
+      mt::core::Any const & data
+    , mt::PluginInfoRandom const & random
+    , mt::core::SurfaceBatch const & surfaces
+    , mt::core::BsdfBatch & samples
+    ) = nullptr;
+
+    // writes the pdf of the directions of the batch
+    void (*BsdfPdfBatch)(
+      mt::core::Any const & data
+    , mt::core::SurfaceBatch const & surfaces
+    , mt::core::BsdfBatch & samples
+    ) = nullptr;
+
+    // writes the fs of the directions of the batch
+    void (*BsdfFsBatch)(
+      mt::core::Any const & data
+    , mt::core::SurfaceBatch const & surfaces
+    , mt::core::BsdfBatch & samples
+    ) = nullptr;
+
     // TODO consider changing triangle to mesh index since either the entire
     //      mesh is an emitter or it's not
     bool (*IsEmitter)(
@@ -195,6 +270,15 @@ namespace mt {
     , mt::PluginInfo const & plugin
     );
 
+    // optional, Sample for each of the surfaces, which all share a material,
+    // so that the bsdfs can sample their surfaces in batches
+    void (*SampleBatch)(
+      span<mt::core::SurfaceInfo const> surfaces
+    , mt::core::Scene const & scene
+    , mt::PluginInfo const & plugin
+    , span<mt::core::BsdfSampleInfo> samples
+    ) = nullptr;
+
     float (*Pdf)(
       mt::core::SurfaceInfo const & surface
     , mt::core::Scene const & scene
@@ -230,6 +314,14 @@ namespace mt {
     , mt::PluginInfo const & plugin
     );
 
+    // optional, flattens the materials of the scene into
+    // Scene::compiledMaterials which the functions above evaluate; called once
+    // the scene is constructed, the plugin compiles again after its own edits
+    void (*Compile)(
+      mt::core::Scene & scene
+    , mt::PluginInfo const & plugin
+    ) = nullptr;
+
     void (*UiUpdate)(
       mt::core::Scene & scene
     , mt::core::RenderInfo & render
@@ -283,6 +375,9 @@ namespace mt {
   };
 
   struct PluginInfoEmitter {
+    // samples a direction towards the emitter & tests its visibility; pdf is
+    // with respect to solid angle, a pdf of 0 marks a delta-dirac emitter (ei
+    // directional) that can't be hit by bsdf sampling
     mt::PixelInfo (*SampleLi)(
       mt::core::Scene const & scene
     , mt::PluginInfo const & plugin
@@ -291,6 +386,7 @@ namespace mt {
     , float & pdf
     ) = nullptr;
 
+    // emission arriving from direction wo, pdf is that of SampleLi choosing wo
     mt::PixelInfo (*SampleWo)(
       mt::core::Scene const & scene
     , mt::PluginInfo const & plugin
@@ -324,6 +420,17 @@ namespace mt {
     , mt::PluginInfo const & plugin
     ) = nullptr;
 
+    // optional, renders N samples per pixel of the region [min, max) for the
+    // integrator, without image copies or kernels (ei for headless workers)
+    void (*DispatchRegion)(
+      mt::core::RenderInfo & render
+    , mt::core::Scene const & scene
+    , mt::PluginInfo const & plugin
+    , size_t const integratorIdx
+    , glm::u16vec2 const minRange, glm::u16vec2 const maxRange
+    , size_t const samples
+    ) = nullptr;
+
     void (*UiUpdate)(
       mt::core::Scene & scene
     , mt::core::RenderInfo & render
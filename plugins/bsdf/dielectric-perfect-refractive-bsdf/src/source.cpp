@@ -1,6 +1,7 @@
 // perfect dielectric refractive material
 
 #include <monte-toad/core/any.hpp>
+#include <monte-toad/core/bsdfbatch.hpp>
 #include <monte-toad/core/geometry.hpp>
 #include <monte-toad/core/integratordata.hpp>
 #include <monte-toad/core/log.hpp>
@@ -15,6 +16,8 @@
 
 #include <imgui/imgui.hpp>
 
+#include <algorithm>
+
 namespace {
 
 struct MaterialInfo {
@@ -27,6 +30,69 @@ void Deallocate(void * data) {
   delete reinterpret_cast<::MaterialInfo*>(data);
 }
 
+glm::vec3 Refract(
+  glm::vec3 const & wi, glm::vec3 const & surfaceNormal
+, float const indexOfRefraction
+) {
+  glm::vec3 normal = surfaceNormal;
+  float eta = indexOfRefraction;
+  // flip normal if surface is incorrect for refraction
+  if (glm::dot(wi, surfaceNormal) < 0.0f) {
+    normal = -surfaceNormal;
+    eta = 1.0f/eta;
+  }
+
+  return glm::normalize(glm::refract(wi, -normal, eta));
+}
+
+// absorption of the medium the path travelled through to the surface
+glm::vec3 Absorb(
+  ::MaterialInfo const & material, glm::vec3 const & absorption
+, float const distance
+) {
+  return
+    glm::exp(-absorption * glm::pow(distance / material.distanceScale, 2.2f));
+}
+
+void FsBatch(
+  ::MaterialInfo const & material
+, mt::core::SurfaceBatch const & surfaces
+, mt::core::BsdfBatch & samples
+) {
+  size_t const size = surfaces.Size();
+
+  if (!material.albedo.userTexture && !material.absorption.userTexture) {
+    glm::vec3 const
+      albedo = material.albedo.userValue
+    , absorption = material.absorption.userValue
+    ;
+
+    for (size_t idx = 0ul; idx < size; ++ idx) {
+      glm::vec3 const absorb =
+        surfaces.sameMedium[idx]
+      ? ::Absorb(material, absorption, surfaces.distance[idx])
+      : glm::vec3(1.0f);
+
+      samples.fs[idx] = absorb * albedo;
+    }
+    return;
+  }
+
+  for (size_t idx = 0ul; idx < size; ++ idx) {
+    auto const & uv = surfaces.uvcoord[idx];
+    float const footprint = surfaces.uvFootprint[idx];
+    glm::vec3 const absorb =
+      surfaces.sameMedium[idx]
+    ? ::Absorb(
+        material, material.absorption.Get(uv, footprint)
+      , surfaces.distance[idx]
+      )
+    : glm::vec3(1.0f);
+
+    samples.fs[idx] = absorb * material.albedo.Get(uv, footprint);
+  }
+}
+
 } // -- namespace
 
 extern "C" {
@@ -52,12 +118,11 @@ glm::vec3 BsdfFs(
    && surface.material == surface.previousSurface->material
    ) {
     absorb =
-      glm::exp(
-        -material.absorption.Get(surface.uvcoord)
-      * glm::pow(surface.distance / material.distanceScale, 2.2f)
+      ::Absorb(
+        material, material.absorption.Get(surface), surface.distance
       );
   }
-  return absorb * material.albedo.Get(surface.uvcoord);
+  return absorb * material.albedo.Get(surface);
 }
 
 glm::vec3 AlbedoApproximation(
@@ -80,23 +145,53 @@ mt::core::BsdfSampleInfo BsdfSample(
 , mt::PluginInfoRandom const & /*random*/
 , mt::core::SurfaceInfo const & surface
 ) {
-
-  glm::vec3 wi = surface.incomingAngle;
-  glm::vec3 normal = surface.normal;
-  float eta = indexOfRefraction;
-  // flip normal if surface is incorrect for refraction
-  if (glm::dot(wi, surface.normal) < 0.0f) {
-    normal = -surface.normal;
-    eta = 1.0f/eta;
-  }
-
-  glm::vec3 const wo = glm::normalize(glm::refract(wi, -normal, eta));
+  glm::vec3 const wo =
+    ::Refract(surface.incomingAngle, surface.normal, indexOfRefraction);
 
   float pdf = 0.0f; // dirac delta
   glm::vec3 fs = BsdfFs(userdata, indexOfRefraction, surface, wo);
   return { wo, fs, pdf };
 }
 
+void BsdfSampleBatch(
+  mt::core::Any const & userdata
+, mt::PluginInfoRandom const & /*random*/
+, mt::core::SurfaceBatch const & surfaces
+, mt::core::BsdfBatch & samples
+) {
+  size_t const size = surfaces.Size();
+  for (size_t idx = 0ul; idx < size; ++ idx) {
+    samples.wo[idx] =
+      ::Refract(
+        surfaces.incomingAngle[idx], surfaces.normal[idx]
+      , surfaces.indexOfRefraction[idx]
+      );
+    samples.pdf[idx] = 0.0f; // dirac delta
+  }
+
+  ::FsBatch(
+    *reinterpret_cast<MaterialInfo const *>(userdata.data), surfaces, samples
+  );
+}
+
+void BsdfPdfBatch(
+  mt::core::Any const & /*userdata*/
+, mt::core::SurfaceBatch const & surfaces
+, mt::core::BsdfBatch & samples
+) {
+  std::fill_n(samples.pdf.begin(), surfaces.Size(), 0.0f); // dirac delta
+}
+
+void BsdfFsBatch(
+  mt::core::Any const & userdata
+, mt::core::SurfaceBatch const & surfaces
+, mt::core::BsdfBatch & samples
+) {
+  ::FsBatch(
+    *reinterpret_cast<MaterialInfo const *>(userdata.data), surfaces, samples
+  );
+}
+
 mt::BsdfTypeHint BsdfType() { return mt::BsdfTypeHint::Transmittive; }
 
 bool IsEmitter(
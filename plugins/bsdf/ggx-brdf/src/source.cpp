@@ -0,0 +1,184 @@
+// ggx microfacet reflective material
+
+#include <monte-toad/core/any.hpp>
+#include <monte-toad/core/geometry.hpp>
+#include <monte-toad/core/integratordata.hpp>
+#include <monte-toad/core/log.hpp>
+#include <monte-toad/core/math.hpp>
+#include <monte-toad/core/microfacet.hpp>
+#include <monte-toad/core/renderinfo.hpp>
+#include <monte-toad/core/scene.hpp>
+#include <monte-toad/core/spectrum.hpp>
+#include <monte-toad/core/surfaceinfo.hpp>
+#include <monte-toad/core/texture.hpp>
+#include <monte-toad/core/triangle.hpp>
+#include <mt-plugin/plugin.hpp>
+
+#include <imgui/imgui.hpp>
+
+namespace {
+
+struct MaterialInfo {
+  // reflectance at normal incidence, which is the colour of a metal
+  mt::core::TextureOption<glm::vec3> albedo {"albedo"};
+  mt::core::TextureOption<float> roughness {"roughness", 0.0f, 1.0f, 0.5f};
+
+  // compensates the energy lost by light scattering between microfacets,
+  // which otherwise darkens rough surfaces
+  bool multipleScattering = true;
+};
+
+void Deallocate(void * data) {
+  delete reinterpret_cast<::MaterialInfo*>(data);
+}
+
+float Alpha(
+  ::MaterialInfo const & material
+, mt::core::SurfaceInfo const & surface
+) {
+  float const roughness = material.roughness.Get(surface);
+  return glm::max(mt::core::ggxMinAlpha, roughness*roughness);
+}
+
+glm::vec3 FresnelSchlick(glm::vec3 const & f0, float const cosTheta) {
+  float const x = 1.0f - glm::saturate(cosTheta);
+  return f0 + (1.0f - f0)*(x*x*x*x*x);
+}
+
+// fs (including the cosine of wo) of the local directions
+glm::vec3 Fs(
+  ::MaterialInfo const & material, mt::core::SurfaceInfo const & surface
+, glm::vec3 const & wi, glm::vec3 const & wo
+) {
+  if (wi.z <= 0.0f || wo.z <= 0.0f) { return glm::vec3(0.0f); }
+
+  glm::vec3 const h = glm::normalize(wi + wo);
+  float const alpha = ::Alpha(material, surface);
+  glm::vec3 const f0 = material.albedo.Get(surface);
+
+  glm::vec3 fs =
+    ::FresnelSchlick(f0, glm::dot(wi, h))
+  * mt::core::GgxD(h, alpha) * mt::core::GgxG2(wi, wo, alpha)
+  / (4.0f * wi.z);
+
+  if (material.multipleScattering) {
+    float const albedo = mt::core::GgxReflectionAlbedo(wi.z, alpha);
+    if (albedo > 0.0f) { fs *= 1.0f + f0*(1.0f - albedo)/albedo; }
+  }
+
+  return fs;
+}
+
+// pdf of sampling the visible normal that reflects wi into wo
+float Pdf(float const alpha, glm::vec3 const & wi, glm::vec3 const & wo) {
+  if (wi.z <= 0.0f || wo.z <= 0.0f) { return 0.0f; }
+
+  glm::vec3 const h = glm::normalize(wi + wo);
+  return
+    mt::core::GgxVisibleNormalPdf(wi, h, alpha) / (4.0f * glm::dot(wi, h));
+}
+
+} // -- namespace
+
+extern "C" {
+
+char const * PluginLabel() { return "ggx brdf"; }
+mt::PluginType PluginType() { return mt::PluginType::Bsdf; }
+
+void Allocate(mt::core::Any & userdata) {
+  userdata.Clear();
+  userdata.data = new ::MaterialInfo{};
+  userdata.dealloc = ::Deallocate;
+}
+
+glm::vec3 BsdfFs(
+  mt::core::Any const & userdata, float const /*indexOfRefraction*/
+, mt::core::SurfaceInfo const & surface
+, glm::vec3 const & wo
+) {
+  auto & material = *reinterpret_cast<MaterialInfo const *>(userdata.data);
+  auto const frame = mt::core::MicrofacetFrame::Construct(surface.normal);
+  return
+    ::Fs(
+      material, surface
+    , frame.ToLocal(-surface.incomingAngle), frame.ToLocal(wo)
+    );
+}
+
+glm::vec3 AlbedoApproximation(
+  mt::core::Any const & userdata, float const /*indexOfRefraction*/
+, mt::core::SurfaceInfo const & surface
+) {
+  auto & material = *reinterpret_cast<MaterialInfo const *>(userdata.data);
+  return material.albedo.Get(surface);
+}
+
+float BsdfPdf(
+  mt::core::Any const & userdata, float const /*indexOfRefraction*/
+, mt::core::SurfaceInfo const & surface
+, glm::vec3 const & wo
+) {
+  auto & material = *reinterpret_cast<MaterialInfo const *>(userdata.data);
+  auto const frame = mt::core::MicrofacetFrame::Construct(surface.normal);
+  return
+    ::Pdf(
+      ::Alpha(material, surface)
+    , frame.ToLocal(-surface.incomingAngle), frame.ToLocal(wo)
+    );
+}
+
+mt::core::BsdfSampleInfo BsdfSample(
+  mt::core::Any const & userdata, float const /*indexOfRefraction*/
+, mt::PluginInfoRandom const & random
+, mt::core::SurfaceInfo const & surface
+) {
+  auto & material = *reinterpret_cast<MaterialInfo const *>(userdata.data);
+  auto const frame = mt::core::MicrofacetFrame::Construct(surface.normal);
+
+  float const alpha = ::Alpha(material, surface);
+  glm::vec3 const wi = frame.ToLocal(-surface.incomingAngle);
+  if (wi.z <= 0.0f) { return mt::core::BsdfSampleInfo{}; }
+
+  glm::vec3 const h =
+    mt::core::GgxSampleVisibleNormal(wi, alpha, random.SampleUniform2());
+  glm::vec3 const wo = glm::reflect(-wi, h);
+
+  // reflected below the surface, which is absorbed
+  if (wo.z <= 0.0f) { return mt::core::BsdfSampleInfo{}; }
+
+  return {
+    frame.ToWorld(wo)
+  , ::Fs(material, surface, wi, wo)
+  , ::Pdf(alpha, wi, wo)
+  };
+}
+
+mt::BsdfTypeHint BsdfType() { return mt::BsdfTypeHint::Specular; }
+
+bool IsEmitter(
+  mt::core::Any const & /*self*/
+, mt::core::Triangle const /*triangle*/
+) {
+  return false;
+}
+
+void UiUpdate(
+  mt::core::Any & userdata
+, mt::core::RenderInfo & render
+, mt::core::Scene & scene
+) {
+  auto & material = *reinterpret_cast<::MaterialInfo*>(userdata.data);
+
+  ImGui::Separator();
+
+  if (material.albedo.GuiApply(scene))
+    { render.ClearImageBuffers(); }
+
+  if (material.roughness.GuiApply(scene))
+    { render.ClearImageBuffers(); }
+
+  if (ImGui::Checkbox("multiple scattering", &material.multipleScattering))
+    { render.ClearImageBuffers(); }
+}
+
+} // -- end extern "C"
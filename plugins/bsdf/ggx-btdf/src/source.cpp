@@ -0,0 +1,225 @@
+// ggx microfacet refractive material
+
+#include <monte-toad/core/any.hpp>
+#include <monte-toad/core/geometry.hpp>
+#include <monte-toad/core/integratordata.hpp>
+#include <monte-toad/core/log.hpp>
+#include <monte-toad/core/math.hpp>
+#include <monte-toad/core/microfacet.hpp>
+#include <monte-toad/core/renderinfo.hpp>
+#include <monte-toad/core/scene.hpp>
+#include <monte-toad/core/spectrum.hpp>
+#include <monte-toad/core/surfaceinfo.hpp>
+#include <monte-toad/core/texture.hpp>
+#include <monte-toad/core/triangle.hpp>
+#include <mt-plugin/plugin.hpp>
+
+#include <imgui/imgui.hpp>
+
+// only the transmission through the microfacets is modelled, the reflection &
+// the fresnel split between them are left to the material, which chooses
+// between its specular & refractive components
+
+namespace {
+
+struct MaterialInfo {
+  mt::core::TextureOption<glm::vec3> albedo {"albedo"};
+  mt::core::TextureOption<float> roughness {"roughness", 0.0f, 1.0f, 0.5f};
+
+  // compensates the energy lost by light scattering between microfacets,
+  // which otherwise darkens rough surfaces
+  bool multipleScattering = true;
+};
+
+void Deallocate(void * data) {
+  delete reinterpret_cast<::MaterialInfo*>(data);
+}
+
+float Alpha(
+  ::MaterialInfo const & material
+, mt::core::SurfaceInfo const & surface
+) {
+  float const roughness = material.roughness.Get(surface);
+  return glm::max(mt::core::ggxMinAlpha, roughness*roughness);
+}
+
+// index of refraction of the side of wi over the other side
+float Eta(
+  mt::core::SurfaceInfo const & surface
+, float const indexOfRefraction
+) {
+  return surface.exitting ? indexOfRefraction : 1.0f/indexOfRefraction;
+}
+
+// microfacet normal refracting the local wi into wo, 0 if there's none
+glm::vec3 TransmissionNormal(
+  float const eta
+, glm::vec3 const & wi, glm::vec3 const & wo
+) {
+  if (wi.z <= 0.0f || wo.z >= 0.0f) { return glm::vec3(0.0f); }
+
+  glm::vec3 h = -(eta*wi + wo);
+  if (glm::dot(h, h) <= 0.0f) { return glm::vec3(0.0f); }
+
+  h = glm::normalize(h);
+  if (h.z < 0.0f) { h = -h; }
+
+  if (glm::dot(wi, h) <= 0.0f || glm::dot(wo, h) >= 0.0f)
+    { return glm::vec3(0.0f); }
+
+  return h;
+}
+
+// fs (including the cosine of wo) of the local directions
+glm::vec3 Fs(
+  ::MaterialInfo const & material, mt::core::SurfaceInfo const & surface
+, float const eta
+, glm::vec3 const & wi, glm::vec3 const & wo
+) {
+  glm::vec3 const h = ::TransmissionNormal(eta, wi, wo);
+  if (h.z <= 0.0f) { return glm::vec3(0.0f); }
+
+  float const
+    alpha = ::Alpha(material, surface)
+  , wiH = glm::dot(wi, h), woH = glm::dot(wo, h)
+  , denom = eta*wiH + woH
+  ;
+
+  float fs =
+    wiH * -woH
+  * mt::core::GgxD(h, alpha) * mt::core::GgxG2(wi, wo, alpha)
+  / (wi.z * denom*denom);
+
+  // dielectrics don't absorb, so the transmission is normalized
+  if (material.multipleScattering) {
+    float const albedo = mt::core::GgxTransmissionAlbedo(wi.z, alpha, eta);
+    if (albedo > 0.0f) { fs /= albedo; }
+  }
+
+  return fs * material.albedo.Get(surface);
+}
+
+// pdf of sampling the visible normal that refracts wi into wo
+float Pdf(
+  float const alpha, float const eta
+, glm::vec3 const & wi, glm::vec3 const & wo
+) {
+  glm::vec3 const h = ::TransmissionNormal(eta, wi, wo);
+  if (h.z <= 0.0f) { return 0.0f; }
+
+  float const
+    woH = glm::dot(wo, h)
+  , denom = eta*glm::dot(wi, h) + woH
+  ;
+
+  return mt::core::GgxVisibleNormalPdf(wi, h, alpha) * -woH / (denom*denom);
+}
+
+} // -- namespace
+
+extern "C" {
+
+char const * PluginLabel() { return "ggx btdf"; }
+mt::PluginType PluginType() { return mt::PluginType::Bsdf; }
+
+void Allocate(mt::core::Any & userdata) {
+  userdata.Clear();
+  userdata.data = new ::MaterialInfo{};
+  userdata.dealloc = ::Deallocate;
+}
+
+glm::vec3 BsdfFs(
+  mt::core::Any const & userdata, float const indexOfRefraction
+, mt::core::SurfaceInfo const & surface
+, glm::vec3 const & wo
+) {
+  auto & material = *reinterpret_cast<MaterialInfo const *>(userdata.data);
+  auto const frame = mt::core::MicrofacetFrame::Construct(surface.normal);
+  return
+    ::Fs(
+      material, surface, ::Eta(surface, indexOfRefraction)
+    , frame.ToLocal(-surface.incomingAngle), frame.ToLocal(wo)
+    );
+}
+
+glm::vec3 AlbedoApproximation(
+  mt::core::Any const & userdata, float const /*indexOfRefraction*/
+, mt::core::SurfaceInfo const & surface
+) {
+  auto & material = *reinterpret_cast<MaterialInfo const *>(userdata.data);
+  return material.albedo.Get(surface);
+}
+
+float BsdfPdf(
+  mt::core::Any const & userdata, float const indexOfRefraction
+, mt::core::SurfaceInfo const & surface
+, glm::vec3 const & wo
+) {
+  auto & material = *reinterpret_cast<MaterialInfo const *>(userdata.data);
+  auto const frame = mt::core::MicrofacetFrame::Construct(surface.normal);
+  return
+    ::Pdf(
+      ::Alpha(material, surface), ::Eta(surface, indexOfRefraction)
+    , frame.ToLocal(-surface.incomingAngle), frame.ToLocal(wo)
+    );
+}
+
+mt::core::BsdfSampleInfo BsdfSample(
+  mt::core::Any const & userdata, float const indexOfRefraction
+, mt::PluginInfoRandom const & random
+, mt::core::SurfaceInfo const & surface
+) {
+  auto & material = *reinterpret_cast<MaterialInfo const *>(userdata.data);
+  auto const frame = mt::core::MicrofacetFrame::Construct(surface.normal);
+
+  float const
+    alpha = ::Alpha(material, surface)
+  , eta = ::Eta(surface, indexOfRefraction)
+  ;
+  glm::vec3 const wi = frame.ToLocal(-surface.incomingAngle);
+  if (wi.z <= 0.0f) { return mt::core::BsdfSampleInfo{}; }
+
+  glm::vec3 const h =
+    mt::core::GgxSampleVisibleNormal(wi, alpha, random.SampleUniform2());
+  glm::vec3 const wo = glm::refract(-wi, h, eta);
+
+  // total internal reflection of the microfacet (wo is 0), or refracted above
+  // the surface
+  if (wo.z >= 0.0f) { return mt::core::BsdfSampleInfo{}; }
+
+  return {
+    frame.ToWorld(wo)
+  , ::Fs(material, surface, eta, wi, wo)
+  , ::Pdf(alpha, eta, wi, wo)
+  };
+}
+
+mt::BsdfTypeHint BsdfType() { return mt::BsdfTypeHint::Transmittive; }
+
+bool IsEmitter(
+  mt::core::Any const & /*self*/
+, mt::core::Triangle const /*triangle*/
+) {
+  return false;
+}
+
+void UiUpdate(
+  mt::core::Any & userdata
+, mt::core::RenderInfo & render
+, mt::core::Scene & scene
+) {
+  auto & material = *reinterpret_cast<::MaterialInfo*>(userdata.data);
+
+  ImGui::Separator();
+
+  if (material.albedo.GuiApply(scene))
+    { render.ClearImageBuffers(); }
+
+  if (material.roughness.GuiApply(scene))
+    { render.ClearImageBuffers(); }
+
+  if (ImGui::Checkbox("multiple scattering", &material.multipleScattering))
+    { render.ClearImageBuffers(); }
+}
+
+} // -- end extern "C"
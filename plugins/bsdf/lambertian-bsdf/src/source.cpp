@@ -1,6 +1,7 @@
 // lambertian material
 
 #include <monte-toad/core/any.hpp>
+#include <monte-toad/core/bsdfbatch.hpp>
 #include <monte-toad/core/geometry.hpp>
 #include <monte-toad/core/integratordata.hpp>
 #include <monte-toad/core/log.hpp>
@@ -26,6 +27,69 @@ void Deallocate(void * data) {
   delete reinterpret_cast<::MaterialInfo*>(data);
 }
 
+glm::vec3 Albedo(
+  ::MaterialInfo const & material
+, glm::vec2 const & uv, float const footprint
+) {
+  return
+    glm::pow(
+      material.albedo.Get(uv, footprint),
+      glm::vec3(material.albedoTextureLinearSpace ? 1.0f : 2.2f)
+    );
+}
+
+// the albedo is corrected before being scattered
+glm::vec3 ScatteredAlbedo(
+  ::MaterialInfo const & material
+, glm::vec2 const & uv, float const footprint
+) {
+  return -glm::log2(1.0f - ::Albedo(material, uv, footprint));
+}
+
+glm::vec3 Fs(
+  glm::vec3 const & albedo, float const emission
+, glm::vec3 const & normal, glm::vec3 const & wo
+) {
+  if (emission > 0.0f) { return emission * albedo; }
+  return glm::dot(wo, normal) * glm::InvPi * albedo;
+}
+
+float Pdf(glm::vec3 const & normal, glm::vec3 const & wo) {
+  return glm::max(0.0f, glm::InvPi * glm::dot(wo, normal));
+}
+
+// writes the fs of the batch directions; the albedo & emission are only read
+// once if they aren't textured
+void FsBatch(
+  ::MaterialInfo const & material
+, mt::core::SurfaceBatch const & surfaces
+, mt::core::BsdfBatch & samples
+) {
+  size_t const size = surfaces.Size();
+
+  if (!material.albedo.userTexture && !material.emission.userTexture) {
+    glm::vec3 const albedo = ::ScatteredAlbedo(material, glm::vec2(0.0f), 0.0f);
+    float const emission = material.emission.userValue;
+
+    for (size_t idx = 0ul; idx < size; ++ idx) {
+      samples.fs[idx] =
+        ::Fs(albedo, emission, surfaces.normal[idx], samples.wo[idx]);
+    }
+    return;
+  }
+
+  for (size_t idx = 0ul; idx < size; ++ idx) {
+    auto const & uv = surfaces.uvcoord[idx];
+    float const footprint = surfaces.uvFootprint[idx];
+    samples.fs[idx] =
+      ::Fs(
+        ::ScatteredAlbedo(material, uv, footprint)
+      , material.emission.Get(uv, footprint)
+      , surfaces.normal[idx], samples.wo[idx]
+      );
+  }
+}
+
 } // -- namespace
 
 extern "C" {
@@ -40,25 +104,18 @@ void Allocate(mt::core::Any & userdata) {
 }
 
 glm::vec3 BsdfFs(
-  mt::core::Any & userdata
+  mt::core::Any const & userdata, float const /*indexOfRefraction*/
 , mt::core::SurfaceInfo const & surface
 , glm::vec3 const & wo
 ) {
   auto & material = *reinterpret_cast<MaterialInfo const *>(userdata.data);
 
-  auto albedo = material.albedo.Get(surface.uvcoord);
-  albedo =
-    glm::pow(
-      albedo,
-      glm::vec3(material.albedoTextureLinearSpace ? 1.0f : 2.2f)
+  return
+    ::Fs(
+      ::ScatteredAlbedo(material, surface.uvcoord, surface.uvFootprint)
+    , material.emission.Get(surface)
+    , surface.normal, wo
     );
-
-  albedo = -glm::log2(1.0f - albedo);
-
-  float emission = material.emission.Get(surface.uvcoord);
-  if (emission > 0.0f) { return emission * albedo; }
-
-  return glm::dot(wo, surface.normal) * glm::InvPi * albedo;
 }
 
 glm::vec3 AlbedoApproximation(
@@ -67,29 +124,25 @@ glm::vec3 AlbedoApproximation(
 ) {
   auto & material = *reinterpret_cast<MaterialInfo const *>(userdata.data);
 
-  auto albedo = material.albedo.Get(surface.uvcoord);
-  albedo =
-    glm::pow(
-      albedo,
-      glm::vec3(material.albedoTextureLinearSpace ? 1.0f : 2.2f)
-    );
+  auto const albedo =
+    ::Albedo(material, surface.uvcoord, surface.uvFootprint);
 
-  float emission = material.emission.Get(surface.uvcoord);
+  float emission = material.emission.Get(surface);
   if (emission > 0.0f) { return emission * albedo; }
 
   return albedo;
 }
 
 float BsdfPdf(
-  mt::core::Any & /*userdata*/
+  mt::core::Any const & /*userdata*/, float const /*indexOfRefraction*/
 , mt::core::SurfaceInfo const & surface
 , glm::vec3 const & wo
 ) {
-  return glm::max(0.0f, glm::InvPi * glm::dot(wo, surface.normal));
+  return ::Pdf(surface.normal, wo);
 }
 
 mt::core::BsdfSampleInfo BsdfSample(
-  mt::core::Any & userdata
+  mt::core::Any const & userdata, float const indexOfRefraction
 , mt::PluginInfoRandom const & random
 , mt::core::SurfaceInfo const & surface
 ) {
@@ -101,11 +154,61 @@ mt::core::BsdfSampleInfo BsdfSample(
     , surface.normal
     );
 
-  float pdf = BsdfPdf(userdata, surface, wo);
-  glm::vec3 fs = BsdfFs(userdata, surface, wo);
+  float pdf = BsdfPdf(userdata, indexOfRefraction, surface, wo);
+  glm::vec3 fs = BsdfFs(userdata, indexOfRefraction, surface, wo);
   return { wo, fs, pdf };
 }
 
+void BsdfSampleBatch(
+  mt::core::Any const & userdata
+, mt::PluginInfoRandom const & random
+, mt::core::SurfaceBatch const & surfaces
+, mt::core::BsdfBatch & samples
+) {
+  // the uniforms are drawn first, so the directions are generated without
+  // calling into the random plugin
+  size_t const size = surfaces.Size();
+  for (size_t idx = 0ul; idx < size; ++ idx) {
+    glm::vec2 const u = random.SampleUniform2();
+    samples.wo[idx] = glm::vec3(u, 0.0f);
+  }
+
+  for (size_t idx = 0ul; idx < size; ++ idx) {
+    glm::vec2 const u = glm::vec2(samples.wo[idx]);
+    samples.wo[idx] =
+      ReorientHemisphere(
+        glm::normalize(Cartesian(glm::sqrt(u.y), glm::Tau*u.x))
+      , surfaces.normal[idx]
+      );
+    samples.pdf[idx] = ::Pdf(surfaces.normal[idx], samples.wo[idx]);
+  }
+
+  ::FsBatch(
+    *reinterpret_cast<MaterialInfo const *>(userdata.data), surfaces, samples
+  );
+}
+
+void BsdfPdfBatch(
+  mt::core::Any const & /*userdata*/
+, mt::core::SurfaceBatch const & surfaces
+, mt::core::BsdfBatch & samples
+) {
+  size_t const size = surfaces.Size();
+  for (size_t idx = 0ul; idx < size; ++ idx) {
+    samples.pdf[idx] = ::Pdf(surfaces.normal[idx], samples.wo[idx]);
+  }
+}
+
+void BsdfFsBatch(
+  mt::core::Any const & userdata
+, mt::core::SurfaceBatch const & surfaces
+, mt::core::BsdfBatch & samples
+) {
+  ::FsBatch(
+    *reinterpret_cast<MaterialInfo const *>(userdata.data), surfaces, samples
+  );
+}
+
 mt::BsdfTypeHint BsdfType() { return mt::BsdfTypeHint::Diffuse; }
 
 bool IsEmitter(
@@ -1,6 +1,7 @@
 // perfect refractive material
 
 #include <monte-toad/core/any.hpp>
+#include <monte-toad/core/bsdfbatch.hpp>
 #include <monte-toad/core/geometry.hpp>
 #include <monte-toad/core/integratordata.hpp>
 #include <monte-toad/core/log.hpp>
@@ -15,6 +16,8 @@
 
 #include <imgui/imgui.hpp>
 
+#include <algorithm>
+
 namespace {
 
 struct MaterialInfo {
@@ -25,6 +28,41 @@ void Deallocate(void * data) {
   delete reinterpret_cast<::MaterialInfo*>(data);
 }
 
+glm::vec3 Refract(
+  glm::vec3 const & wi, glm::vec3 const & surfaceNormal
+, float const indexOfRefraction
+) {
+  glm::vec3 normal = surfaceNormal;
+  float eta = indexOfRefraction;
+  // flip normal if surface is incorrect for refraction
+  if (glm::dot(wi, surfaceNormal) < 0.0f) {
+    normal = -surfaceNormal;
+    eta = 1.0f/eta;
+  }
+
+  return glm::normalize(glm::refract(wi, -normal, eta));
+}
+
+void FsBatch(
+  ::MaterialInfo const & material
+, mt::core::SurfaceBatch const & surfaces
+, mt::core::BsdfBatch & samples
+) {
+  size_t const size = surfaces.Size();
+
+  if (!material.albedo.userTexture) {
+    glm::vec3 const albedo = material.albedo.userValue;
+    for (size_t idx = 0ul; idx < size; ++ idx)
+      { samples.fs[idx] = albedo; }
+    return;
+  }
+
+  for (size_t idx = 0ul; idx < size; ++ idx) {
+    samples.fs[idx] =
+      material.albedo.Get(surfaces.uvcoord[idx], surfaces.uvFootprint[idx]);
+  }
+}
+
 } // -- namespace
 
 extern "C" {
@@ -44,7 +82,7 @@ glm::vec3 BsdfFs(
 , glm::vec3 const &
 ) {
   auto & material = *reinterpret_cast<MaterialInfo const *>(userdata.data);
-  return material.albedo.Get(surface.uvcoord);
+  return material.albedo.Get(surface);
 }
 
 glm::vec3 AlbedoApproximation(
@@ -67,23 +105,53 @@ mt::core::BsdfSampleInfo BsdfSample(
 , mt::PluginInfoRandom const & /*random*/
 , mt::core::SurfaceInfo const & surface
 ) {
-
-  glm::vec3 wi = surface.incomingAngle;
-  glm::vec3 normal = surface.normal;
-  float eta = indexOfRefraction;
-  // flip normal if surface is incorrect for refraction
-  if (glm::dot(wi, surface.normal) < 0.0f) {
-    normal = -surface.normal;
-    eta = 1.0f/eta;
-  }
-
-  glm::vec3 const wo = glm::normalize(glm::refract(wi, -normal, eta));
+  glm::vec3 const wo =
+    ::Refract(surface.incomingAngle, surface.normal, indexOfRefraction);
 
   float pdf = 0.0f; // dirac delta
   glm::vec3 fs = BsdfFs(userdata, indexOfRefraction, surface, wo);
   return { wo, fs, pdf };
 }
 
+void BsdfSampleBatch(
+  mt::core::Any const & userdata
+, mt::PluginInfoRandom const & /*random*/
+, mt::core::SurfaceBatch const & surfaces
+, mt::core::BsdfBatch & samples
+) {
+  size_t const size = surfaces.Size();
+  for (size_t idx = 0ul; idx < size; ++ idx) {
+    samples.wo[idx] =
+      ::Refract(
+        surfaces.incomingAngle[idx], surfaces.normal[idx]
+      , surfaces.indexOfRefraction[idx]
+      );
+    samples.pdf[idx] = 0.0f; // dirac delta
+  }
+
+  ::FsBatch(
+    *reinterpret_cast<MaterialInfo const *>(userdata.data), surfaces, samples
+  );
+}
+
+void BsdfPdfBatch(
+  mt::core::Any const & /*userdata*/
+, mt::core::SurfaceBatch const & surfaces
+, mt::core::BsdfBatch & samples
+) {
+  std::fill_n(samples.pdf.begin(), surfaces.Size(), 0.0f); // dirac delta
+}
+
+void BsdfFsBatch(
+  mt::core::Any const & userdata
+, mt::core::SurfaceBatch const & surfaces
+, mt::core::BsdfBatch & samples
+) {
+  ::FsBatch(
+    *reinterpret_cast<MaterialInfo const *>(userdata.data), surfaces, samples
+  );
+}
+
 mt::BsdfTypeHint BsdfType() { return mt::BsdfTypeHint::Transmittive; }
 
 bool IsEmitter(
@@ -1,6 +1,7 @@
 // perfect specular material
 
 #include <monte-toad/core/any.hpp>
+#include <monte-toad/core/bsdfbatch.hpp>
 #include <monte-toad/core/geometry.hpp>
 #include <monte-toad/core/integratordata.hpp>
 #include <monte-toad/core/log.hpp>
@@ -15,6 +16,8 @@
 
 #include <imgui/imgui.hpp>
 
+#include <algorithm>
+
 namespace {
 
 struct MaterialInfo {
@@ -25,6 +28,26 @@ void Deallocate(void * data) {
   delete reinterpret_cast<::MaterialInfo*>(data);
 }
 
+void FsBatch(
+  ::MaterialInfo const & material
+, mt::core::SurfaceBatch const & surfaces
+, mt::core::BsdfBatch & samples
+) {
+  size_t const size = surfaces.Size();
+
+  if (!material.albedo.userTexture) {
+    glm::vec3 const albedo = material.albedo.userValue;
+    for (size_t idx = 0ul; idx < size; ++ idx)
+      { samples.fs[idx] = albedo; }
+    return;
+  }
+
+  for (size_t idx = 0ul; idx < size; ++ idx) {
+    samples.fs[idx] =
+      material.albedo.Get(surfaces.uvcoord[idx], surfaces.uvFootprint[idx]);
+  }
+}
+
 } // -- namespace
 
 extern "C" {
@@ -44,7 +67,7 @@ glm::vec3 BsdfFs(
 , glm::vec3 const &
 ) {
   auto & material = *reinterpret_cast<MaterialInfo const *>(userdata.data);
-  return material.albedo.Get(surface.uvcoord);
+  return material.albedo.Get(surface);
 }
 
 glm::vec3 AlbedoApproximation(
@@ -75,6 +98,44 @@ mt::core::BsdfSampleInfo BsdfSample(
   return { wo, fs, pdf };
 }
 
+void BsdfSampleBatch(
+  mt::core::Any const & userdata
+, mt::PluginInfoRandom const & /*random*/
+, mt::core::SurfaceBatch const & surfaces
+, mt::core::BsdfBatch & samples
+) {
+  size_t const size = surfaces.Size();
+  for (size_t idx = 0ul; idx < size; ++ idx) {
+    samples.wo[idx] =
+      glm::normalize(
+        glm::reflect(surfaces.incomingAngle[idx], surfaces.normal[idx])
+      );
+    samples.pdf[idx] = 0.0f; // dirac delta
+  }
+
+  ::FsBatch(
+    *reinterpret_cast<MaterialInfo const *>(userdata.data), surfaces, samples
+  );
+}
+
+void BsdfPdfBatch(
+  mt::core::Any const & /*userdata*/
+, mt::core::SurfaceBatch const & surfaces
+, mt::core::BsdfBatch & samples
+) {
+  std::fill_n(samples.pdf.begin(), surfaces.Size(), 0.0f); // dirac delta
+}
+
+void BsdfFsBatch(
+  mt::core::Any const & userdata
+, mt::core::SurfaceBatch const & surfaces
+, mt::core::BsdfBatch & samples
+) {
+  ::FsBatch(
+    *reinterpret_cast<MaterialInfo const *>(userdata.data), surfaces, samples
+  );
+}
+
 mt::BsdfTypeHint BsdfType() { return mt::BsdfTypeHint::Specular; }
 
 bool IsEmitter(
@@ -6,12 +6,20 @@
 #include <monte-toad/core/log.hpp>
 #include <monte-toad/core/renderinfo.hpp>
 #include <monte-toad/core/scene.hpp>
+#include <monte-toad/core/span.hpp>
+#include <monte-toad/core/spectrum.hpp>
+#include <monte-toad/core/surfaceinfo.hpp>
 #include <monte-toad/debugutil/integratorpathunit.hpp>
 #include <mt-plugin/plugin.hpp>
 
 #include <imgui/imgui.hpp>
 #include <omp.h>
 
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <vector>
+
 namespace mt::core { struct Scene; }
 namespace mt { struct PluginInfo; }
 namespace mt { struct RenderInfo; }
@@ -108,6 +116,230 @@ void DrawPath(mt::PluginInfo const & plugin, mt::core::RenderInfo & render) {
   );
 }
 
+// image coordinates of the pixel, which the camera generates rays from
+glm::vec2 PixelUv(
+  size_t const x, size_t const y
+, glm::u16vec2 const resolution
+) {
+  glm::vec2 uv = glm::vec2(x, y) / glm::vec2(resolution.x, resolution.y);
+  uv.x = 1.0f - uv.x; // flip X axis for image
+  uv = (uv - glm::vec2(0.5f)) * 2.0f;
+  uv.y *= resolution.y / static_cast<float>(resolution.x);
+  return uv;
+}
+
+// pixels of the region sorted by the material of their primary hit (invalid
+// hits last) so that the threads, which are scheduled over contiguous ranges
+// of the pixels, shade the same material consecutively. The order is built
+// once per region & reused until the integrator is cleared; nullptr if the
+// region is shaded in image order
+mt::core::ShadingOrder const * RegionShadingOrder(
+  mt::core::Scene const & scene
+, mt::core::RenderInfo const & render
+, mt::PluginInfo const & plugin
+, mt::core::IntegratorData & integratorData
+, size_t const minX, size_t const minY
+, size_t const maxX, size_t const maxY
+, size_t const strideX, size_t const strideY
+) {
+  if (!integratorData.materialSortedDispatch) { return nullptr; }
+
+  auto const & resolution = integratorData.imageResolution;
+
+  auto & order = integratorData.shadingOrders[minY*resolution.x + minX];
+  if (
+      order.minX == minX && order.minY == minY
+   && order.maxX == maxX && order.maxY == maxY
+   && order.strideX == strideX && order.strideY == strideY
+  ) {
+    return &order;
+  }
+
+  order = { minX, minY, maxX, maxY, strideX, strideY, {} };
+  for (size_t x = minX; x < maxX; x += strideX)
+  for (size_t y = minY; y < maxY; y += strideY)
+    { order.pixels.emplace_back(y*resolution.x + x); }
+
+  // one primary ray per pixel is cheap next to the samples it orders
+  std::vector<std::pair<size_t, size_t>> keys(order.pixels.size());
+
+  #pragma omp parallel for
+  for (size_t it = 0ul; it < order.pixels.size(); ++ it) {
+    size_t const idx = order.pixels[it];
+
+    auto const eye =
+      plugin.camera.Dispatch(
+        plugin.random, render.camera, resolution
+      , ::PixelUv(idx % resolution.x, idx / resolution.x, resolution)
+      );
+
+    auto const surface =
+      mt::core::Raycast(scene, plugin, eye.origin, eye.direction, -1ul);
+
+    keys[it] = { surface.Valid() ? surface.material : -1lu, idx };
+  }
+
+  std::sort(keys.begin(), keys.end());
+
+  for (size_t it = 0ul; it < order.pixels.size(); ++ it)
+    { order.pixels[it] = keys[it].second; }
+
+  return &order;
+}
+
+// compensated summation of a sample into the accumulated color of a pixel
+void KahanAccumulate(
+  glm::vec3 & sum
+, glm::vec3 & compensation
+, glm::vec3 const & color
+) {
+  glm::vec3 const value = color - compensation;
+  glm::vec3 const total = sum + value;
+  compensation = (total - sum) - value;
+  sum = total;
+}
+
+// sorted pixels a thread shades at a time; the primary hits of a sample are
+// traced together so the material samples the bsdfs of each run of hits with
+// the same material in a single call
+constexpr size_t sortedChunkLength = 256ul;
+
+// shades a chunk of the sorted pixels of a region, which the thread owns
+// exclusively, a sample at a time
+void DispatchSortedChunk(
+  mt::core::Scene const & scene
+, mt::core::RenderInfo & render
+, mt::PluginInfo const & plugin
+, size_t const integratorIdx
+, span<size_t const> const pixels
+, size_t const internalIterator
+, bool const checkSamplesPerPixel
+) {
+  auto & integratorData = render.integratorData[integratorIdx];
+  auto const & resolution = integratorData.imageResolution;
+  auto const & integrator = plugin.integrators[integratorIdx];
+
+  float const spreadAngle =
+    mt::core::PixelSpreadAngle(render.camera, resolution);
+
+  // the primary hits & their pixels; the hits that sample their bsdf are
+  // copied contiguously by material, & point to their bsdf sample
+  thread_local std::vector<mt::core::SurfaceInfo> hits;
+  thread_local std::vector<size_t> hitPixels;
+  thread_local std::vector<size_t> shadedHits;
+  thread_local std::vector<mt::core::SurfaceInfo> shadedSurfaces;
+  thread_local std::vector<mt::core::BsdfSampleInfo> shadedBsdfs;
+  thread_local std::vector<mt::core::BsdfSampleInfo const *> hitBsdfs;
+  thread_local mt::core::AovSample aovs;
+
+  for (size_t it = 0; it < internalIterator; ++ it) {
+    hits.clear();
+    hitPixels.clear();
+
+    for (size_t const idx : pixels) {
+      if (
+          checkSamplesPerPixel
+       && integratorData.pixelCountBuffer[idx] >= integratorData.samplesPerPixel
+      ) {
+        continue;
+      }
+
+      auto const eye =
+        plugin.camera.Dispatch(
+          plugin.random, render.camera, resolution
+        , ::PixelUv(idx % resolution.x, idx / resolution.x, resolution)
+        );
+
+      auto & surface =
+        hits.emplace_back(
+          mt::core::Raycast(scene, plugin, eye.origin, eye.direction, -1ul)
+        );
+      mt::core::PropagateRayCone(surface, 0.0f, spreadAngle);
+      hitPixels.emplace_back(idx);
+    }
+
+    if (hits.empty()) { break; }
+
+    // -- sample the bsdfs of the hits, a run of the same material at a time;
+    //    the region is sorted by the material of its first sample, so the runs
+    //    only change where later samples hit a different material
+    shadedHits.clear();
+    for (size_t hit = 0ul; hit < hits.size(); ++ hit) {
+      if (
+          hits[hit].Valid()
+       && !plugin.material.IsEmitter(hits[hit], scene, plugin)
+      ) {
+        shadedHits.emplace_back(hit);
+      }
+    }
+
+    std::stable_sort(
+      shadedHits.begin(), shadedHits.end()
+    , [&](size_t const l, size_t const r) {
+        return hits[l].material < hits[r].material;
+      }
+    );
+
+    shadedSurfaces.clear();
+    for (size_t const hit : shadedHits)
+      { shadedSurfaces.emplace_back(hits[hit]); }
+    shadedBsdfs.resize(shadedHits.size());
+
+    for (size_t begin = 0ul; begin < shadedSurfaces.size();) {
+      size_t end = begin + 1ul;
+      while (
+          end < shadedSurfaces.size()
+       && shadedSurfaces[end].material == shadedSurfaces[begin].material
+      ) {
+        ++ end;
+      }
+
+      plugin.material.SampleBatch(
+        span<mt::core::SurfaceInfo const>(
+          shadedSurfaces.data() + begin, end - begin
+        )
+      , scene, plugin
+      , span<mt::core::BsdfSampleInfo>(shadedBsdfs.data() + begin, end - begin)
+      );
+
+      begin = end;
+    }
+
+    hitBsdfs.assign(hits.size(), nullptr);
+    for (size_t shaded = 0ul; shaded < shadedHits.size(); ++ shaded)
+      { hitBsdfs[shadedHits[shaded]] = &shadedBsdfs[shaded]; }
+
+    // -- shade the hits & accumulate their samples
+    for (size_t hit = 0ul; hit < hits.size(); ++ hit) {
+      size_t const idx = hitPixels[hit];
+
+      mt::core::ResetAovSample(integratorData, aovs);
+
+      auto const pixelResults =
+        integrator.DispatchPrimaryHit(
+          hits[hit], hitBsdfs[hit], scene, plugin, integratorData, aovs
+        );
+
+      if (!pixelResults.valid) { continue; }
+
+      aovs.Write(mt::core::aovSampleCount, 1.0f);
+      aovs.Write(mt::core::aovVariance, pixelResults.color);
+      mt::core::AccumulateAovSample(integratorData, idx, aovs);
+
+      auto & sum = integratorData.accumulatedColorBuffer[idx];
+      if (integratorData.kahanAccumulation) {
+        ::KahanAccumulate(
+          sum, integratorData.accumulatedColorCompensationBuffer[idx]
+        , pixelResults.color
+        );
+      } else {
+        sum += pixelResults.color;
+      }
+      ++ integratorData.pixelCountBuffer[idx];
+    }
+  }
+}
+
 void DispatchBlockRegion(
   mt::core::Scene const & scene
 , mt::core::RenderInfo & render
@@ -123,8 +355,6 @@ void DispatchBlockRegion(
   auto & integratorData = render.integratorData[integratorIdx];
 
   auto const & resolution = integratorData.imageResolution;
-  auto const resolutionAspectRatio =
-    resolution.y / static_cast<float>(resolution.x);
 
   if (minX > resolution.x || maxX > resolution.x) {
     spdlog::critical(
@@ -142,40 +372,155 @@ void DispatchBlockRegion(
     return;
   }
 
-  #pragma omp parallel for collapse(2)
-  for (size_t x = minX; x < maxX; x += strideX)
-  for (size_t y = minY; y < maxY; y += strideY)
-  for (size_t it = 0; it < internalIterator; ++ it) {
-    auto & pixelCount = integratorData.pixelCountBuffer[y*resolution.x + x];
-    auto & pixel =
-      integratorData.mappedImageTransitionBuffer[y*resolution.x + x];
-
-    if (checkSamplesPerPixel && pixelCount >= integratorData.samplesPerPixel)
-      { continue; }
+  // samples the pixel & accumulates the output channels it wrote, if valid
+  auto const SamplePixel = [&](size_t const x, size_t const y) {
+    glm::vec2 const uv = ::PixelUv(x, y, resolution);
 
-    glm::vec2 uv = glm::vec2(x, y) / glm::vec2(resolution.x, resolution.y);
-    uv.x = 1.0f - uv.x; // flip X axis for image
-    uv = (uv - glm::vec2(0.5f)) * 2.0f;
-    uv.y *= resolutionAspectRatio;
+    thread_local mt::core::AovSample aovs;
+    mt::core::ResetAovSample(integratorData, aovs);
 
-    auto pixelResults =
+    auto const pixelResults =
       plugin
         .integrators[integratorIdx]
-        .Dispatch(uv, scene, render.camera, plugin, integratorData, nullptr);
+        .Dispatch(
+          uv, scene, render.camera, plugin, integratorData, aovs, nullptr
+        );
 
     if (pixelResults.valid) {
-      pixel =
-        glm::vec4(
-          glm::mix(
-            pixelResults.color,
-            glm::vec3(pixel),
-            pixelCount / static_cast<float>(pixelCount + 1)
-          ),
-          1.0f
-        );
-      ++ pixelCount;
+      aovs.Write(mt::core::aovSampleCount, 1.0f);
+      aovs.Write(mt::core::aovVariance, pixelResults.color);
+      mt::core::AccumulateAovSample(
+        integratorData, y*resolution.x + x, aovs
+      );
+    }
+
+    return pixelResults;
+  };
+
+  mt::core::ShadingOrder const * const order =
+    ::RegionShadingOrder(
+      scene, render, plugin, integratorData
+    , minX, minY, maxX, maxY, strideX, strideY
+    );
+
+  // pixels are otherwise shaded in image order, column by column
+  size_t const
+    columns = maxX > minX ? (maxX - minX + strideX - 1ul) / strideX : 0ul
+  , rows    = maxY > minY ? (maxY - minY + strideY - 1ul) / strideY : 0ul
+  , pixelLength = columns*rows
+  ;
+
+  auto const PixelIdx = [&](size_t const pixelIt) {
+    if (order) { return order->pixels[pixelIt]; }
+    return
+      (minY + (pixelIt % rows)*strideY)*resolution.x
+    + minX + (pixelIt / rows)*strideX;
+  };
+
+  // sorted regions sample the bsdfs of their primary hits in batches, unless
+  // the paths are spectral, as the wavelengths are sampled by the integrator
+  bool const batched =
+      order
+   && !integratorData.spectral
+   && plugin.integrators[integratorIdx].DispatchPrimaryHit != nullptr
+   && plugin.material.SampleBatch != nullptr;
+
+  if (batched) {
+    size_t const chunks =
+      (pixelLength + ::sortedChunkLength - 1ul) / ::sortedChunkLength;
+
+    #pragma omp parallel for schedule(dynamic)
+    for (size_t chunk = 0ul; chunk < chunks; ++ chunk) {
+      size_t const begin = chunk*::sortedChunkLength;
+      size_t const length =
+        glm::min(::sortedChunkLength, pixelLength - begin);
+
+      ::DispatchSortedChunk(
+        scene, render, plugin, integratorIdx
+      , span<size_t const>(order->pixels.data() + begin, length)
+      , internalIterator, checkSamplesPerPixel
+      );
+    }
+  } else if (integratorData.kahanAccumulation) {
+    // each pixel is owned by a single thread so its sum can be compensated
+    #pragma omp parallel for schedule(static)
+    for (size_t pixelIt = 0ul; pixelIt < pixelLength; ++ pixelIt) {
+      size_t const
+        idx = PixelIdx(pixelIt), x = idx % resolution.x, y = idx / resolution.x;
+      auto & pixelCount = integratorData.pixelCountBuffer[idx];
+      auto & sum = integratorData.accumulatedColorBuffer[idx];
+      auto & compensation =
+        integratorData.accumulatedColorCompensationBuffer[idx];
+
+      for (size_t it = 0; it < internalIterator; ++ it) {
+        if (
+            checkSamplesPerPixel
+         && pixelCount >= integratorData.samplesPerPixel
+        ) {
+          break;
+        }
+
+        auto const pixelResults = SamplePixel(x, y);
+        if (!pixelResults.valid) { continue; }
+
+        ::KahanAccumulate(sum, compensation, pixelResults.color);
+        ++ pixelCount;
+      }
+    }
+  } else {
+    // samples of the same pixel can be processed concurrently, as their
+    // contributions are added atomically
+    #pragma omp parallel for collapse(2) schedule(static)
+    for (size_t pixelIt = 0ul; pixelIt < pixelLength; ++ pixelIt)
+    for (size_t it = 0; it < internalIterator; ++ it) {
+      size_t const
+        idx = PixelIdx(pixelIt), x = idx % resolution.x, y = idx / resolution.x;
+      auto pixelCount =
+        std::atomic_ref<uint32_t>(integratorData.pixelCountBuffer[idx]);
+
+      // the sample is reserved by testing & incrementing the count in a
+      // single atomic exchange, so concurrent samples of the pixel can't
+      // overshoot the samples per pixel; it's released if it's invalid
+      bool reserved = false;
+      uint32_t count = pixelCount.load(std::memory_order_relaxed);
+      while (
+          !checkSamplesPerPixel || count < integratorData.samplesPerPixel
+      ) {
+        if (
+          pixelCount.compare_exchange_weak(
+            count, count + 1u, std::memory_order_relaxed
+          )
+        ) {
+          reserved = true;
+          break;
+        }
+      }
+      if (!reserved) { continue; }
+
+      auto const pixelResults = SamplePixel(x, y);
+      if (!pixelResults.valid) {
+        pixelCount.fetch_sub(1u, std::memory_order_relaxed);
+        continue;
+      }
+
+      auto & sum = integratorData.accumulatedColorBuffer[idx];
+      for (glm::length_t component = 0; component < 3; ++ component) {
+        std::atomic_ref<float>(sum[component])
+          .fetch_add(pixelResults.color[component], std::memory_order_relaxed);
+      }
     }
   }
+
+  // -- resolve the accumulated samples of the region
+  #pragma omp parallel for collapse(2)
+  for (size_t x = minX; x < maxX; x += strideX)
+  for (size_t y = minY; y < maxY; y += strideY) {
+    size_t const idx = y*resolution.x + x;
+    if (integratorData.pixelCountBuffer[idx] == 0u) { continue; }
+
+    integratorData.mappedImageTransitionBuffer[idx] =
+      mt::core::ResolvePixel(integratorData, idx);
+  }
 }
 
 void BlockCalculateRange(
@@ -371,111 +716,213 @@ void BlockIterate(
   }
 }
 
-void PrepareKernels(
-  mt::core::RenderInfo & render
-, mt::core::IntegratorData & data
+// primary-hit information of every pixel, traced once per render dispatch &
+// shared by realtime integrators and kernel auxiliary images
+struct GBuffer {
+  glm::u16vec2 resolution = glm::u16vec2(0);
+  bool traced = false;
+
+  std::vector<glm::vec2> uvs;
+  std::vector<mt::core::SurfaceInfo> surfaces;
+  std::vector<glm::vec3> albedo;
+  std::vector<glm::vec3> normal;
+  std::vector<float> depth;
+};
+
+// one g-buffer per image resolution
+std::vector<::GBuffer> gbuffers;
+
+glm::vec3 SurfaceAlbedo(
+  mt::core::SurfaceInfo const & surface
 , mt::core::Scene const & scene
 , mt::PluginInfo const & plugin
 ) {
-  // check if theere is a preview available to prepare
-  if (!data.HasPreview() || !data.generatePreviewOutput) { return; }
+  if (surface.Valid())
+    { return plugin.material.AlbedoApproximation(surface, scene, plugin); }
+
+  if (scene.emissionSource.skyboxEmitterPluginIdx == -1lu)
+    { return glm::vec3(0.0f); }
+
+  float pdf;
+  return
+    plugin
+      .emitters[scene.emissionSource.skyboxEmitterPluginIdx]
+      .SampleWo(scene, plugin, surface, surface.incomingAngle, pdf)
+      .color;
+}
 
-  // collect integrators that need to be calculated
-  std::vector<size_t> secondaryHintIdx;
-  std::vector<size_t> secondaryIntegratorIdx;
+::GBuffer const & TracePrimaryHits(
+  mt::core::RenderInfo const & render
+, mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+, glm::u16vec2 const resolution
+) {
+  ::GBuffer * gbuffer = nullptr;
+  for (auto & it : ::gbuffers) {
+    if (it.resolution == resolution) { gbuffer = &it; break; }
+  }
 
-  // go through integrators (excluding primary) and fill out secondary images
-  // if they have not been set yet
-  for (auto hintI = 0ul; hintI < Idx(mt::IntegratorTypeHint::Size); ++ hintI) {
-    auto const integratorIdx = render.integratorIndices[hintI];
+  if (!gbuffer) {
+    gbuffer = &::gbuffers.emplace_back();
+    gbuffer->resolution = resolution;
+  }
 
-    // if this integrator is valid
-    if (integratorIdx >= plugin.integrators.size()) { continue; }
+  if (gbuffer->traced) { return *gbuffer; }
 
-    // if the secondary integrator has already been calculated
-    if (data.secondaryIntegratorImagePtrs[integratorIdx].data()) { continue; }
+  size_t const pixelLength = resolution.x * resolution.y;
+  gbuffer->uvs.resize(pixelLength);
+  gbuffer->surfaces.resize(pixelLength);
+  gbuffer->albedo.resize(pixelLength);
+  gbuffer->normal.resize(pixelLength);
+  gbuffer->depth.resize(pixelLength);
 
-    // TODO at some point it would be nice to link integrators to secondary
-    //       integrators; this could be done automatically but then there would
-    //       be a hidden cost/optimization that is non-obvious. To explicitly
-    //       apply this optimization would be preferrable, not to mention I
-    //       don't think it would be used very often anyways
-    //  So for now calculations are done even redundantly, mostly because it
-    //  would be awkward to pair an integrator index up to a specific
-    //  integrator that shares camera information at this point when no actual
-    //  integrator synchronization exists
+  #pragma omp parallel for collapse(2)
+  for (size_t x = 0; x < resolution.x; ++ x)
+  for (size_t y = 0; y < resolution.y; ++ y) {
+    size_t const idx = y*resolution.x + x;
 
-    // store information if it needs to be calculated
-    secondaryHintIdx.emplace_back(hintI);
-    secondaryIntegratorIdx.emplace_back(integratorIdx);
+    glm::vec2 const uv = ::PixelUv(x, y, resolution);
 
-    // allocate memory for secondary integrator
-    data
-      .secondaryIntegratorImages[hintI]
-      .resize(data.mappedImageTransitionBuffer.size());
+    // TODO realtime probably should have hardcoded UV offsets to be
+    //      consistent
+    auto const eye =
+      plugin.camera.Dispatch(plugin.random, render.camera, resolution, uv);
 
-    data.secondaryIntegratorImagePtrs[hintI] =
-      make_span(data.secondaryIntegratorImages[hintI]);
+    auto & surface = gbuffer->surfaces[idx];
+    surface = mt::core::Raycast(scene, plugin, eye.origin, eye.direction, -1ul);
+
+    gbuffer->uvs[idx]    = uv;
+    gbuffer->albedo[idx] = ::SurfaceAlbedo(surface, scene, plugin);
+    gbuffer->normal[idx] = surface.Valid() ? surface.normal : glm::vec3(0.0f);
+    gbuffer->depth[idx]  = surface.Valid() ? surface.distance : 0.0f;
   }
 
-  // check if any secondary integrator work needs to be computed
-  if (secondaryHintIdx.size() == 0ul) { return; }
-  assert(secondaryHintIdx.size() == secondaryIntegratorIdx.size());
+  gbuffer->traced = true;
+  return *gbuffer;
+}
 
-  // basically do the same dispatch as elsewhere TODO this is copy/paste so
-  // probably should be a function
-  #pragma omp parallel for collapse(2)
-  for (size_t x = 0; x < data.imageResolution.x; ++ x)
-  for (size_t y = 0; y < data.imageResolution.y; ++ y) {
+// copies the channels of a g-buffer integrator that has rendered the current
+// frame at the resolution into the auxiliary images, false if there's none
+bool CopyGBufferChannels(
+  mt::core::RenderInfo const & render
+, mt::PluginInfo const & plugin
+, glm::u16vec2 const resolution
+, std::vector<glm::vec3> & albedoImage
+, std::vector<glm::vec3> & normalImage
+, std::vector<glm::vec3> & depthImage
+) {
+  for (size_t idx = 0ul; idx < plugin.integrators.size(); ++ idx) {
+    auto const & integrator = plugin.integrators[idx];
+    auto const & source = render.integratorData[idx];
+
+    if (
+        !integrator.DispatchRealtimeChannels || !integrator.ChannelLabel
+     || source.channelCount == 0ul
+     || source.renderingState == mt::RenderingState::Off
+     || !source.renderingFinished
+     || source.imageResolution != resolution
+    ) {
+      continue;
+    }
+
+    auto const channel = [&](char const * label) {
+      for (size_t c = 0ul; c < source.channelCount; ++ c) {
+        if (std::strcmp(integrator.ChannelLabel(c), label) == 0)
+          { return c; }
+      }
+      return -1lu;
+    };
 
-    glm::vec2 uv =
-      glm::vec2(x, y)
-    / glm::vec2(data.imageResolution.x, data.imageResolution.y)
+    size_t const
+      albedoChannel = channel("albedo")
+    , normalChannel = channel("normal")
+    , depthChannel  = channel("depth")
     ;
 
-    auto const resolutionAspectRatio =
-      data.imageResolution.y / static_cast<float>(data.imageResolution.x);
+    if (
+        albedoChannel == -1lu || normalChannel == -1lu || depthChannel == -1lu
+    ) {
+      continue;
+    }
 
-    uv.x = 1.0f - uv.x; // flip X axis for image
-    uv = (uv - glm::vec2(0.5f)) * 2.0f;
-    uv.y *= resolutionAspectRatio;
+    size_t const pixelLength = resolution.x * resolution.y;
+    albedoImage.resize(pixelLength);
+    normalImage.resize(pixelLength);
+    depthImage.resize(pixelLength);
+
+    for (size_t pixel = 0ul; pixel < pixelLength; ++ pixel) {
+      glm::vec3 const * channels =
+        source.channelBuffer.data() + pixel*source.channelCount;
+      albedoImage[pixel] = channels[albedoChannel];
+      normalImage[pixel] = channels[normalChannel];
+      depthImage[pixel]  = channels[depthChannel];
+    }
 
-    // TODO realtime probably should have hardcoded UV offsets to be
-    //      consistent
-    auto const eye =
-      plugin.camera.Dispatch(
-        plugin.random, render.camera
-      , data.imageResolution
-      , uv
-      );
+    return true;
+  }
 
-    // apply raycast to surface for secondary integrators, as they should all
-    // share the same surface information
-    auto const surface =
-      mt::core::Raycast(scene, plugin, eye.origin, eye.direction, -1ul);
+  return false;
+}
 
-    for (size_t idx = 0ul; idx < secondaryHintIdx.size(); ++ idx) {
-      auto const integratorIdx = secondaryIntegratorIdx[idx];
-      auto const hintIdx       = secondaryHintIdx[idx];
+void PrepareKernels(
+  mt::core::RenderInfo & render
+, mt::core::IntegratorData & data
+, mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+) {
+  // check if theere is a preview available to prepare
+  if (!data.HasPreview() || !data.generatePreviewOutput) { return; }
 
-      auto & pixel =
-        data.secondaryIntegratorImages[hintIdx][y*data.imageResolution.x + x];
+  // auxiliary images are only filled out once per clear of the integrator
+  bool needsAuxiliaryImages = false;
+  for (auto hintI = 0ul; hintI < Idx(mt::IntegratorTypeHint::Size); ++ hintI) {
+    if (hintI == Idx(mt::IntegratorTypeHint::Primary)) { continue; }
+    needsAuxiliaryImages |= !data.secondaryIntegratorImagePtrs[hintI].data();
+  }
 
-      auto pixelResults =
-        plugin
-          .integrators[integratorIdx]
-          .DispatchRealtime(
-            uv, surface, scene, plugin, render.integratorData[integratorIdx]
-          );
+  if (!needsAuxiliaryImages) { return; }
+
+  auto & albedoImage =
+    data.secondaryIntegratorImages[Idx(mt::IntegratorTypeHint::Albedo)];
+  auto & normalImage =
+    data.secondaryIntegratorImages[Idx(mt::IntegratorTypeHint::Normal)];
+  auto & depthImage =
+    data.secondaryIntegratorImages[Idx(mt::IntegratorTypeHint::Depth)];
+
+  // auxiliary images are the channels of a g-buffer integrator if one has
+  // rendered the frame, otherwise they're taken directly from the primary
+  // hits; either way they do not depend on the configuration of (or existence
+  // of) the albedo & normal integrators
+  if (
+    !::CopyGBufferChannels(
+      render, plugin, data.imageResolution
+    , albedoImage, normalImage, depthImage
+    )
+  ) {
+    auto const & gbuffer =
+      ::TracePrimaryHits(render, scene, plugin, data.imageResolution);
+
+    albedoImage = gbuffer.albedo;
+    normalImage = gbuffer.normal;
+    depthImage.resize(gbuffer.depth.size());
+    for (size_t idx = 0ul; idx < depthImage.size(); ++ idx)
+      { depthImage[idx] = glm::vec3(gbuffer.depth[idx]); }
+  }
 
-      pixel = pixelResults.color;
-    }
+  for (auto hintI = 0ul; hintI < Idx(mt::IntegratorTypeHint::Size); ++ hintI) {
+    if (hintI == Idx(mt::IntegratorTypeHint::Primary)) { continue; }
+    data.secondaryIntegratorImagePtrs[hintI] =
+      make_span(data.secondaryIntegratorImages[hintI]);
   }
 }
 
 // used to collect synced integrators that can share raycast results
 std::vector<std::vector<size_t>> syncedIntegrators;
 
+// camera of the previous realtime dispatch, for motion between dispatches
+mt::core::CameraInfo previousCamera;
+bool previousCameraValid = false;
+
 }
 
 extern "C" {
@@ -489,6 +936,9 @@ void DispatchRender(
 , mt::PluginInfo const & plugin
 ) {
 
+  // -- primary hits are traced at most once per render dispatch
+  for (auto & gbuffer : ::gbuffers) { gbuffer.traced = false; }
+
   // -- collect synced integrators that can share raycast results
   ::syncedIntegrators.clear();
   ::syncedIntegrators.reserve(plugin.integrators.size());
@@ -526,13 +976,12 @@ void DispatchRender(
 
   // iterate through all integrators and run either their low or high quality
   // dispatches
+  bool realtimeDispatched = false;
   for (auto const & syncIt : ::syncedIntegrators) {
 
     // if sync is realtime then it can be accelerated by sharing surface info
     if (plugin.integrators[syncIt[0]].RealTime()) {
       auto const resolution = render.integratorData[syncIt[0]].imageResolution;
-      auto const resolutionAspectRatio =
-        resolution.y / static_cast<float>(resolution.x);
 
       // -- apply update to integrator data metadata
       for (auto const integratorIdx : syncIt) {
@@ -552,47 +1001,46 @@ void DispatchRender(
         }
       }
 
-      // -- render synced integrators
+      // -- render synced integrators from the shared primary hits
+      auto const & gbuffer =
+        ::TracePrimaryHits(render, scene, plugin, resolution);
+
+      if (!::previousCameraValid) {
+        ::previousCamera = render.camera;
+        ::previousCameraValid = true;
+      }
+
       #pragma omp parallel for collapse(2)
       for (size_t x = 0; x < resolution.x; ++ x)
       for (size_t y = 0; y < resolution.y; ++ y) {
-
-        glm::vec2 uv = glm::vec2(x, y) / glm::vec2(resolution.x, resolution.y);
-        uv.x = 1.0f - uv.x; // flip X axis for image
-        uv = (uv - glm::vec2(0.5f)) * 2.0f;
-        uv.y *= resolutionAspectRatio;
-
-        // TODO realtime probably should have hardcoded UV offsets to be
-        //      consistent
-        auto const eye =
-          plugin.camera.Dispatch(
-            plugin.random, render.camera
-          , render.integratorData[syncIt[0]].imageResolution
-          , uv
-          );
-
-        // apply raycast to surface for all synced integrators
-        auto const surface =
-          mt::core::Raycast(scene, plugin, eye.origin, eye.direction, -1ul);
+        size_t const idx = y*resolution.x + x;
 
         for (auto const integratorIdx : syncIt) {
           auto & self = render.integratorData[integratorIdx];
+          auto const & integrator = plugin.integrators[integratorIdx];
 
-          auto & pixel = self.mappedImageTransitionBuffer[y*resolution.x + x];
-
+          // multi-channel integrators write all of their channels at once
           auto pixelResults =
-            plugin
-              .integrators[integratorIdx]
-              .DispatchRealtime(uv, surface, scene, plugin, self);
-
-          pixel = pixelResults.color;
+              integrator.DispatchRealtimeChannels
+            ? integrator.DispatchRealtimeChannels(
+                gbuffer.uvs[idx], gbuffer.surfaces[idx], scene
+              , render.camera, ::previousCamera, plugin, self
+              , self.channelBuffer.data() + idx*self.channelCount
+              )
+            : integrator.DispatchRealtime(
+                gbuffer.uvs[idx], gbuffer.surfaces[idx], scene, plugin, self
+              );
+
+          self.mappedImageTransitionBuffer[idx] = pixelResults.color;
         }
       }
 
+      realtimeDispatched = true;
+
       // -- apply image copy & set rendering finished
       for (auto const integratorIdx : syncIt) {
         auto & self = render.integratorData[integratorIdx];
-        mt::core::DispatchImageCopy(self, 0ul, 0ul, resolution.x, resolution.y);
+        mt::core::DispatchImageCopy(self, 0ul, resolution.x, 0ul, resolution.y);
         self.endTime = std::chrono::system_clock::now();
         self.renderingFinished = true;
       }
@@ -626,6 +1074,11 @@ void DispatchRender(
         self.startTime = std::chrono::system_clock::now();
       }
 
+      // let the integrator update anything it learns between passes
+      if (plugin.integrators[integratorIdx].DispatchCycle) {
+        plugin.integrators[integratorIdx].DispatchCycle(scene, plugin, self);
+      }
+
       if (
           self.imageResolution.x * self.imageResolution.y
        != self.mappedImageTransitionBuffer.size()
@@ -687,6 +1140,9 @@ void DispatchRender(
           break;
           case mt::KernelDispatchTiming::Last:
             if (self.renderingFinished) {
+              // kernel applies to entire image, so it must all be uploaded
+              minRange = glm::u16vec2(0);
+              maxRange = self.imageResolution;
               plugin
                 .kernels[kernelDispatch.dispatchPluginIdx]
                 .ApplyKernel(
@@ -711,6 +1167,26 @@ void DispatchRender(
       ::BlockCollectFinishedPixels(self, plugin.integrators[integratorIdx]);
     }
   }
+
+  if (realtimeDispatched) { ::previousCamera = render.camera; }
+}
+
+void DispatchRegion(
+  mt::core::RenderInfo & render
+, mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+, size_t const integratorIdx
+, glm::u16vec2 const minRange, glm::u16vec2 const maxRange
+, size_t const samples
+) {
+  // renders the region without touching block iteration, kernels or any
+  // OpenGL resources, so it's safe to use from headless processes
+  ::DispatchBlockRegion(
+    scene, render, plugin, integratorIdx
+  , minRange.x, minRange.y, maxRange.x, maxRange.y
+  , 1, 1
+  , samples
+  );
 }
 
 void UiUpdate(
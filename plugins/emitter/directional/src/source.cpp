@@ -29,7 +29,8 @@ mt::PixelInfo SampleLi(
 , float & pdf
 ) {
   wo = emissionDirection;
-  pdf = 1.0f;
+  // delta-dirac light, can't be hit by bsdf sampling
+  pdf = 0.0f;
   auto testSurface =
     mt::core::Raycast(scene, plugin, surface.origin, wo, surface.triangle.idx);
   if (testSurface.Valid()) { return { glm::vec3(0.0f), false }; }
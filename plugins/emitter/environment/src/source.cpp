@@ -2,6 +2,7 @@
 
 #include <monte-toad/core/geometry.hpp>
 #include <monte-toad/core/log.hpp>
+#include <monte-toad/core/math.hpp>
 #include <monte-toad/core/renderinfo.hpp>
 #include <monte-toad/core/scene.hpp>
 #include <monte-toad/core/surfaceinfo.hpp>
@@ -10,10 +11,143 @@
 
 #include <imgui/imgui.hpp>
 
+#include <algorithm>
+#include <vector>
+
 namespace {
 
 static float emissionPower = 1.0f;
 
+// piecewise-constant distribution over [0, 1)
+struct Distribution1D {
+  std::vector<float> function, cdf;
+  float integral = 0.0f;
+};
+
+// piecewise-constant distribution over [0, 1)², rows are chosen through the
+// marginal, then the texel of the row through its conditional
+struct Distribution2D {
+  std::vector<Distribution1D> conditional;
+  Distribution1D marginal;
+};
+
+// importance of the environment map, luminance * sin(theta) per texel
+static Distribution2D distribution;
+
+Distribution1D ConstructDistribution1D(float const * values, size_t count) {
+  Distribution1D self;
+  self.function.assign(values, values + count);
+  self.cdf.resize(count + 1ul);
+
+  self.cdf[0] = 0.0f;
+  for (size_t idx = 0ul; idx < count; ++ idx) {
+    self.cdf[idx+1] =
+      self.cdf[idx] + self.function[idx] / static_cast<float>(count);
+  }
+
+  self.integral = self.cdf[count];
+
+  // a black function falls back to a uniform distribution
+  for (size_t idx = 1ul; idx <= count; ++ idx) {
+    self.cdf[idx] =
+        self.integral > 0.0f
+      ? self.cdf[idx] / self.integral
+      : static_cast<float>(idx) / static_cast<float>(count)
+    ;
+  }
+
+  return self;
+}
+
+float SampleContinuous(
+  Distribution1D const & self
+, float const uniform
+, float & pdf
+, size_t & offset
+) {
+  size_t const count = self.function.size();
+
+  // last cdf entry not greater than the uniform
+  offset =
+    static_cast<size_t>(
+      std::upper_bound(self.cdf.begin(), self.cdf.end(), uniform)
+    - self.cdf.begin()
+    );
+  offset = glm::clamp(offset, 1ul, count) - 1ul;
+
+  float du = uniform - self.cdf[offset];
+  float const range = self.cdf[offset+1] - self.cdf[offset];
+  if (range > 0.0f) { du /= range; }
+
+  pdf =
+      self.integral > 0.0f
+    ? self.function[offset] / self.integral
+    : 1.0f
+  ;
+
+  return (static_cast<float>(offset) + du) / static_cast<float>(count);
+}
+
+glm::vec2 SampleContinuous(
+  Distribution2D const & self
+, glm::vec2 const & uniform
+, float & pdf
+) {
+  float pdfMarginal, pdfConditional;
+  size_t row, column;
+  float const v =
+    ::SampleContinuous(self.marginal, uniform.y, pdfMarginal, row);
+  float const u =
+    ::SampleContinuous(
+      self.conditional[row], uniform.x, pdfConditional, column
+    );
+  pdf = pdfMarginal * pdfConditional;
+  return glm::vec2(u, v);
+}
+
+float Pdf(Distribution2D const & self, glm::vec2 const & uv) {
+  if (self.marginal.integral <= 0.0f) { return 1.0f; }
+
+  size_t const
+    rows    = self.conditional.size()
+  , columns = self.conditional[0].function.size()
+  , column  =
+      glm::clamp(static_cast<size_t>(uv.x*columns), 0ul, columns-1ul)
+  , row     =
+      glm::clamp(static_cast<size_t>(uv.y*rows), 0ul, rows-1ul)
+  ;
+
+  return self.conditional[row].function[column] / self.marginal.integral;
+}
+
+// the equirectangular mapping of mt::core::Sample, u is the azimuth & v the
+// polar angle from +y, which starts at the top row of the texture
+glm::vec3 EquirectToDirection(glm::vec2 const & uv) {
+  float const
+    theta = glm::Pi * uv.y
+  , phi = glm::Tau * (uv.x - 0.5f)
+  , sinTheta = glm::sin(theta)
+  ;
+
+  return
+    glm::vec3(sinTheta*glm::sin(phi), glm::cos(theta), sinTheta*glm::cos(phi));
+}
+
+glm::vec2 DirectionToEquirect(glm::vec3 const & wo) {
+  return
+    glm::vec2(
+      0.5f + glm::atan(wo.x, wo.z)*glm::InvTau
+    , glm::acos(glm::clamp(wo.y, -1.0f, 1.0f))*glm::InvPi
+    );
+}
+
+// converts the pdf of the texture's uv to solid angle
+float SolidAnglePdf(float const uvPdf, float const v) {
+  float const sinTheta = glm::sin(glm::Pi * v);
+  if (sinTheta <= 0.0f) { return 0.0f; }
+  return uvPdf / (2.0f * glm::Pi2 * sinTheta);
+}
+
 glm::vec3 SampleEmission(
   mt::core::Scene const & /*scene*/
 , mt::core::Texture const & texture
@@ -22,6 +156,14 @@ glm::vec3 SampleEmission(
   return mt::core::Sample(texture, wo);
 }
 
+// the environment map is linear radiance, converted when it's loaded
+glm::vec3 Emission(mt::core::Scene const & scene, glm::vec3 const & wo) {
+  return
+    ::SampleEmission(scene, scene.emissionSource.environmentMap, wo)
+  * ::emissionPower
+  ;
+}
+
 } // -- namespace
 
 extern "C" {
@@ -30,27 +172,29 @@ char const * PluginLabel() { return "environment emitter"; }
 mt::PluginType PluginType() { return mt::PluginType::Emitter; }
 
 mt::PixelInfo SampleLi(
-  mt::core::Scene const & /*scene*/
-, mt::PluginInfo const & /*plugin*/
-, mt::core::SurfaceInfo const & /*surface*/
-, glm::vec3 & /*wo*/
-, float & /*pdf*/
+  mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+, mt::core::SurfaceInfo const & surface
+, glm::vec3 & wo
+, float & pdf
 ) {
-  return {};
-  /* if (!scene.emissionSource.environmentMap.Valid()) */
-  /*   { pdf = 0.0f; return { glm::vec3(0.0f), false }; } */
-
-  /* { */
-  /*   auto bsdf = */
-  /*     plugin.material.BsdfSample(plugin.material, plugin.random, surface); */
-  /*   wo = bsdf.wo; */
-  /*   pdf = bsdf.pdf; */
-  /* } */
-  /* auto testSurface = */
-  /*   mt::core::Raycast(scene, surface.origin, wo, surface.triangle); */
-  /* if (testSurface.Valid()) { return { glm::vec3(0.0f), false }; } */
-  /* auto color = ::SampleEmission(scene, scene.emissionSource.environmentMap, wo); */
-  /* return { color * emissionPower, true }; */
+  if (
+      !scene.emissionSource.environmentMap.Valid()
+   || ::distribution.conditional.size() == 0ul
+  ) { pdf = 0.0f; return { glm::vec3(0.0f), false }; }
+
+  float uvPdf;
+  glm::vec2 const uv =
+    ::SampleContinuous(::distribution, plugin.random.SampleUniform2(), uvPdf);
+  wo = ::EquirectToDirection(uv);
+  pdf = ::SolidAnglePdf(uvPdf, uv.y);
+  if (pdf <= 0.0f) { return { glm::vec3(0.0f), false }; }
+
+  auto testSurface =
+    mt::core::Raycast(scene, plugin, surface.origin, wo, surface.triangle.idx);
+  if (testSurface.Valid()) { return { glm::vec3(0.0f), false }; }
+
+  return { ::Emission(scene, wo), true };
 }
 
 mt::PixelInfo SampleWo(
@@ -63,24 +207,53 @@ mt::PixelInfo SampleWo(
   if (!scene.emissionSource.environmentMap.Valid())
     { pdf = 0.0f; return { glm::vec3(0.0f), false }; }
 
-  // TODO
-  pdf = 1.0f;
+  // pdf of SampleLi choosing wo
+  glm::vec2 const uv = ::DirectionToEquirect(wo);
+  pdf = ::SolidAnglePdf(::Pdf(::distribution, uv), uv.y);
 
-  return {
-    glm::pow(
-      ::SampleEmission(scene, scene.emissionSource.environmentMap, wo),
-      glm::vec3(1.0f/2.2f)
-    )
-  * ::emissionPower
-  , true
-  };
+  return { ::Emission(scene, wo), true };
 }
 
 void Precompute(
-  mt::core::Scene const & /*scene*/
+  mt::core::Scene const & scene
 , mt::core::RenderInfo const & /*render*/
 , mt::PluginInfo const & /*plugin*/
 ) {
+  auto const & texture = scene.emissionSource.environmentMap;
+  ::distribution = {};
+
+  // a single uniform texel keeps the distribution valid without a texture
+  size_t const
+    width  = texture.Valid() ? texture.width  : 1ul
+  , height = texture.Valid() ? texture.height : 1ul
+  ;
+
+  // rows near the poles cover less solid angle, so they are scaled by
+  // sin(theta) of the row's center
+  std::vector<float> importance(width*height, 1.0f);
+  if (texture.Valid()) {
+    for (size_t y = 0ul; y < height; ++ y) {
+      float const sinTheta =
+        glm::sin(glm::Pi * (static_cast<float>(y) + 0.5f) / height);
+      for (size_t x = 0ul; x < width; ++ x) {
+        glm::vec3 const emission = glm::vec3(texture.Texel(0ul, x, y));
+        importance[y*width + x] =
+          glm::dot(emission, glm::vec3(0.2126f, 0.7152f, 0.0722f)) * sinTheta;
+      }
+    }
+  }
+
+  std::vector<float> rowIntegral(height);
+  ::distribution.conditional.reserve(height);
+  for (size_t y = 0ul; y < height; ++ y) {
+    ::distribution.conditional.emplace_back(
+      ::ConstructDistribution1D(importance.data() + y*width, width)
+    );
+    rowIntegral[y] = ::distribution.conditional.back().integral;
+  }
+
+  ::distribution.marginal =
+    ::ConstructDistribution1D(rowIntegral.data(), height);
 }
 
 void UiUpdate(
@@ -1,6 +1,8 @@
 // furnace emitter
 
+#include <monte-toad/core/geometry.hpp>
 #include <monte-toad/core/log.hpp>
+#include <monte-toad/core/math.hpp>
 #include <monte-toad/core/renderinfo.hpp>
 #include <monte-toad/core/scene.hpp>
 #include <monte-toad/core/surfaceinfo.hpp>
@@ -21,24 +23,22 @@ char const * PluginLabel() { return "furnace emitter"; }
 mt::PluginType PluginType() { return mt::PluginType::Emitter; }
 
 mt::PixelInfo SampleLi(
-  mt::core::Scene const & /*scene*/
-, mt::PluginInfo const & /*plugin*/
-, mt::core::SurfaceInfo const & /*surface*/
-, glm::vec3 & /*wo*/
-, float & /*pdf*/
+  mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+, mt::core::SurfaceInfo const & surface
+, glm::vec3 & wo
+, float & pdf
 ) {
-  return {};
-  /* { */
-  /*   auto bsdf = */
-  /*     plugin.material.BsdfSample(plugin.material, plugin.random, surface); */
-  /*   wo = bsdf.wo; */
-  /*   pdf = bsdf.pdf; */
-  /* } */
-  /* auto testSurface = */
-  /*   mt::core::Raycast(scene, surface.origin, wo, surface.triangle); */
-  /* if (testSurface.Valid()) { return { glm::vec3(0.0f), false }; } */
-  /* auto color = emissionColor * emissionPower; */
-  /* return { color * emissionPower, true }; */
+  // uniform sphere
+  glm::vec2 const u = plugin.random.SampleUniform2();
+  wo = Cartesian(1.0f - 2.0f*u.x, glm::Tau*u.y);
+  pdf = 0.25f*glm::InvPi;
+
+  auto testSurface =
+    mt::core::Raycast(scene, plugin, surface.origin, wo, surface.triangle.idx);
+  if (testSurface.Valid()) { return { glm::vec3(0.0f), false }; }
+
+  return { emissionColor * emissionPower, true };
 }
 
 mt::PixelInfo SampleWo(
@@ -48,8 +48,8 @@ mt::PixelInfo SampleWo(
 , glm::vec3 const & /*wo*/
 , float & pdf
 ) {
-  // TODO
-  pdf = 1.0f;
+  // matches SampleLi
+  pdf = 0.25f*glm::InvPi;
 
   return {
     emissionColor * emissionPower,
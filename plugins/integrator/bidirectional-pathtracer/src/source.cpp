@@ -0,0 +1,635 @@
+// bidirectional path tracer
+
+/*
+  A camera subpath & a light subpath are traced, then every prefix of the
+    camera subpath (t vertices) is connected to every prefix of the light
+    subpath (s vertices), each connection is a different strategy to sample the
+    same path;
+
+      s = 0, the camera subpath hits an emitter
+      s = 1, a point on an emitter is sampled from the camera subpath's end
+      s > 1, the ends of both subpaths are connected with a shadow ray
+
+  Strategies are combined with multiple importance sampling (power heuristic),
+    which needs the pdf, in area measure, of each vertex being generated from
+    either direction (pdfFwd from the subpath it's on, pdfRev from the other).
+
+  Strategies with a single camera vertex (t = 1, light subpaths connected to
+    the lens) would have to splat onto arbitrary pixels, which Dispatch can't
+    do, so they are excluded from both the estimate & the MIS weights.
+
+  Emissive surfaces end subpaths, they are not scattered from. Skybox emitters
+    can't start light subpaths, so they are only sampled from the camera
+    subpath (hit or next event estimation, weighted like the forward path
+    tracer).
+*/
+
+#include <monte-toad/core/camerainfo.hpp>
+#include <monte-toad/core/enum.hpp>
+#include <monte-toad/core/geometry.hpp>
+#include <monte-toad/core/integratordata.hpp>
+#include <monte-toad/core/intersection.hpp>
+#include <monte-toad/core/log.hpp>
+#include <monte-toad/core/math.hpp>
+#include <monte-toad/core/scene.hpp>
+#include <monte-toad/core/spectrum.hpp>
+#include <monte-toad/core/surfaceinfo.hpp>
+#include <monte-toad/core/triangle.hpp>
+#include <monte-toad/debugutil/integratorpathunit.hpp>
+
+#include <mt-plugin/plugin.hpp>
+
+#include <vector>
+
+namespace mt::core { struct CameraInfo; }
+
+namespace {
+
+enum class VertexType { Camera, Light, Surface };
+
+struct Vertex {
+  VertexType type = VertexType::Surface;
+  mt::core::SurfaceInfo surface;
+
+  // throughput of the subpath up to, & including, this vertex
+  glm::vec3 beta = glm::vec3(0.0f);
+
+  // area pdfs of this vertex being generated by its own subpath (fwd) & by
+  // the opposite subpath (rev)
+  float pdfFwd = 0.0f, pdfRev = 0.0f;
+
+  // the scattering sampled at this vertex was delta-dirac
+  bool delta = false;
+
+  // surface vertex on an emitter, which ends the camera subpath
+  bool emitter = false;
+};
+
+// the subpaths are reused between dispatches of the same thread
+thread_local std::vector<Vertex> cameraVertices, lightVertices;
+
+float Remap0(float const pdf) { return pdf != 0.0f ? pdf : 1.0f; }
+
+// surface as if it had been arrived at from the incoming direction, which
+// reorients the normal
+mt::core::SurfaceInfo Reoriented(
+  mt::core::SurfaceInfo surface
+, glm::vec3 const & incomingAngle
+) {
+  if (surface.exitting) {
+    surface.normal *= -1.0f;
+    surface.exitting = false;
+  }
+
+  surface.incomingAngle = incomingAngle;
+  if (glm::dot(-surface.incomingAngle, surface.normal) < 0.0f) {
+    surface.normal *= -1.0f;
+    surface.exitting = true;
+  }
+
+  surface.previousSurface.reset();
+  return surface;
+}
+
+// converts a solid angle pdf at 'from' into an area pdf at 'to'
+float ConvertDensity(float pdf, Vertex const & from, Vertex const & to) {
+  glm::vec3 wo = to.surface.origin - from.surface.origin;
+  float const distanceSqr = glm::dot(wo, wo);
+  if (distanceSqr <= 0.0f) { return 0.0f; }
+
+  wo /= glm::sqrt(distanceSqr);
+  if (to.type != VertexType::Camera)
+    { pdf *= glm::abs(glm::dot(to.surface.normal, wo)); }
+
+  return pdf / distanceSqr;
+}
+
+// emissive triangles emit from both faces with a cosine distribution
+float EmissionDirectionPdf(Vertex const & light, glm::vec3 const & wo) {
+  return glm::abs(glm::dot(light.surface.normal, wo)) * 0.5f * glm::InvPi;
+}
+
+// area pdf of a light subpath starting at the vertex
+float PdfLightOrigin(mt::core::Scene const & scene, Vertex const & light) {
+  return mt::core::EmissionSourceTrianglePdf(scene, light.surface.triangle);
+}
+
+// area pdf of the emitter at vertex 'light' emitting towards 'next'
+float PdfLight(Vertex const & light, Vertex const & next) {
+  glm::vec3 const wo =
+    glm::normalize(next.surface.origin - light.surface.origin);
+  return ::ConvertDensity(::EmissionDirectionPdf(light, wo), light, next);
+}
+
+// area pdf of 'vertex' scattering from 'previous' towards 'next'
+float Pdf(
+  mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+, Vertex const * previous
+, Vertex const & vertex
+, Vertex const & next
+) {
+  if (vertex.type == VertexType::Light) { return ::PdfLight(vertex, next); }
+
+  auto const surface =
+    ::Reoriented(
+      vertex.surface
+    , glm::normalize(vertex.surface.origin - previous->surface.origin)
+    );
+
+  glm::vec3 const wo =
+    glm::normalize(next.surface.origin - vertex.surface.origin);
+
+  return
+    ::ConvertDensity(
+      plugin.material.IndirectPdf(surface, scene, plugin, wo), vertex, next
+    );
+}
+
+// creates the vertex of a point on an emissive triangle
+Vertex ConstructLightVertex(
+  mt::core::Scene const & scene
+, mt::core::Triangle const & triangle
+, glm::vec2 const & barycentricUv
+) {
+  auto const & origins = triangle.mesh->origins;
+  auto const & normals = triangle.mesh->normals;
+  size_t const idx = triangle.idx;
+
+  mt::core::BvhIntersection intersection;
+  intersection.triangleIdx = idx;
+  intersection.length = 0.0f;
+  intersection.barycentricUv = barycentricUv;
+
+  glm::vec3 const normal =
+    BarycentricInterpolation(
+      normals[idx*3 + 0], normals[idx*3 + 1], normals[idx*3 + 2]
+    , barycentricUv
+    );
+
+  Vertex vertex;
+  vertex.type = VertexType::Light;
+  vertex.surface =
+    mt::core::SurfaceInfo::Construct(
+      scene, triangle, intersection
+    , BarycentricInterpolation(
+        origins[idx*3 + 0], origins[idx*3 + 1], origins[idx*3 + 2]
+      , barycentricUv
+      )
+    , -normal
+    );
+  vertex.pdfFwd = mt::core::EmissionSourceTrianglePdf(scene, triangle);
+  return vertex;
+}
+
+// extends the subpath from its last vertex until it escapes, hits an emitter
+// or the vertex limit is reached; returns the direction & pdf of the escaping
+// ray, if any, so the camera subpath can apply the skybox
+struct Escape {
+  bool valid = false;
+  glm::vec3 wo = glm::vec3(0.0f), beta = glm::vec3(0.0f);
+  float pdf = 0.0f;
+  bool delta = false;
+};
+
+Escape RandomWalk(
+  mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+, std::vector<Vertex> & vertices
+, glm::vec3 wo
+, glm::vec3 beta
+, float pdfDir
+, size_t const maxVertices
+, mt::TransportMode const transportMode
+, void (*debugPathRecorder)(mt::debugutil::IntegratorPathUnit)
+) {
+  Escape escape;
+  bool delta = false;
+
+  while (vertices.size() < maxVertices) {
+    auto & previous = vertices.back();
+
+    auto surface =
+      mt::core::Raycast(
+        scene, plugin, previous.surface.origin, wo
+      , previous.surface.triangle.idx
+      );
+    mt::core::PropagateRayCone(
+      surface, previous.surface.coneWidth, previous.surface.coneSpread
+    );
+
+    if (!surface.Valid()) {
+      escape.valid = true;
+      escape.wo = wo;
+      escape.beta = beta;
+      escape.pdf = pdfDir;
+      escape.delta = delta;
+      break;
+    }
+
+    Vertex vertex;
+    vertex.surface = surface;
+    vertex.beta = beta;
+    vertex.pdfFwd = ::ConvertDensity(pdfDir, previous, vertex);
+    vertex.emitter = plugin.material.IsEmitter(surface, scene, plugin);
+
+    if (debugPathRecorder) {
+      debugPathRecorder({
+        beta, glm::vec3(0.0f), transportMode, vertices.size(), surface
+      });
+    }
+
+    // emitters absorb light subpaths & end camera subpaths
+    if (vertex.emitter) {
+      if (transportMode == mt::TransportMode::Radiance)
+        { vertices.emplace_back(std::move(vertex)); }
+      break;
+    }
+
+    vertices.emplace_back(std::move(vertex));
+    auto & current = vertices.back();
+
+    auto const bsdf = plugin.material.Sample(current.surface, scene, plugin);
+    delta = bsdf.pdf == 0.0f;
+    if (bsdf.wo == glm::vec3(0.0f) || glm::length(bsdf.fs) <= 0.0f) { break; }
+
+    current.delta = delta;
+
+    // mixture pdfs of the material, in both directions, as the other subpath
+    // would evaluate them
+    float pdfRev = 0.0f;
+    pdfDir = 0.0f;
+    if (!delta) {
+      pdfDir =
+        plugin.material.IndirectPdf(current.surface, scene, plugin, bsdf.wo);
+      pdfRev =
+        plugin.material.IndirectPdf(
+          ::Reoriented(current.surface, -bsdf.wo), scene, plugin
+        , -current.surface.incomingAngle
+        );
+    }
+
+    beta *= bsdf.fs / (delta ? 1.0f : bsdf.pdf);
+    wo = bsdf.wo;
+
+    // vertices may be reallocated, so index the previous vertex again
+    auto & previousVertex = vertices[vertices.size()-2];
+    previousVertex.pdfRev = ::ConvertDensity(pdfRev, current, previousVertex);
+  }
+
+  return escape;
+}
+
+// power heuristic weight of the strategy with s light & t camera vertices,
+// against every other strategy that could have sampled the same path
+float MisWeight(
+  mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+, Vertex * light
+, Vertex * camera
+, size_t const s, size_t const t
+) {
+  if (s + t == 2ul) { return 1.0f; }
+
+  Vertex
+    * pt      = &camera[t-1]
+  , * ptMinus = &camera[t-2]
+  , * qs      = s > 0ul ? &light[s-1] : nullptr
+  , * qsMinus = s > 1ul ? &light[s-2] : nullptr
+  ;
+
+  // temporarily update the vertices for this strategy
+  float const
+    ptPdfRev      = pt->pdfRev
+  , ptMinusPdfRev = ptMinus->pdfRev
+  , qsPdfRev      = qs ? qs->pdfRev : 0.0f
+  , qsMinusPdfRev = qsMinus ? qsMinus->pdfRev : 0.0f
+  ;
+  bool const
+    ptDelta = pt->delta
+  , qsDelta = qs ? qs->delta : false
+  ;
+
+  // connection vertices are never delta-dirac
+  pt->delta = false;
+  if (qs) { qs->delta = false; }
+
+  pt->pdfRev =
+      s > 0ul
+    ? ::Pdf(scene, plugin, qsMinus, *qs, *pt)
+    : ::PdfLightOrigin(scene, *pt)
+  ;
+
+  ptMinus->pdfRev =
+      s > 0ul
+    ? ::Pdf(scene, plugin, qs, *pt, *ptMinus)
+    : ::PdfLight(*pt, *ptMinus)
+  ;
+
+  if (qs)      { qs->pdfRev = ::Pdf(scene, plugin, ptMinus, *pt, *qs); }
+  if (qsMinus) { qsMinus->pdfRev = ::Pdf(scene, plugin, pt, *qs, *qsMinus); }
+
+  float sumRi = 0.0f;
+
+  // strategies with fewer camera vertices, down to t = 2
+  float ri = 1.0f;
+  for (size_t i = t-1; i > 1ul; -- i) {
+    ri *= ::Remap0(camera[i].pdfRev) / ::Remap0(camera[i].pdfFwd);
+    if (!camera[i].delta && !camera[i-1].delta) { sumRi += ri; }
+  }
+
+  // strategies with fewer light vertices, down to s = 0
+  ri = 1.0f;
+  for (size_t i = s; i > 0ul; -- i) {
+    ri *= ::Remap0(light[i-1].pdfRev) / ::Remap0(light[i-1].pdfFwd);
+    bool const deltaPrevious = i > 1ul ? light[i-2].delta : false;
+    if (!light[i-1].delta && !deltaPrevious) { sumRi += ri; }
+  }
+
+  pt->pdfRev = ptPdfRev;
+  pt->delta = ptDelta;
+  ptMinus->pdfRev = ptMinusPdfRev;
+  if (qs)      { qs->pdfRev = qsPdfRev; qs->delta = qsDelta; }
+  if (qsMinus) { qsMinus->pdfRev = qsMinusPdfRev; }
+
+  return 1.0f / (1.0f + sumRi);
+}
+
+bool Visible(
+  mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+, Vertex const & from
+, Vertex const & to
+) {
+  glm::vec3 const wo = glm::normalize(to.surface.origin - from.surface.origin);
+  auto const surface =
+    mt::core::Raycast(
+      scene, plugin, from.surface.origin, wo, from.surface.triangle.idx
+    );
+  return surface.triangle.idx == to.surface.triangle.idx;
+}
+
+// contribution of the strategy with s light & t camera vertices
+glm::vec3 Connect(
+  mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+, size_t const s, size_t const t
+) {
+  auto & pt = ::cameraVertices[t-1];
+
+  // the camera subpath hit an emitter
+  if (s == 0ul) {
+    if (!pt.emitter) { return glm::vec3(0.0f); }
+
+    glm::vec3 const radiance =
+      pt.beta * plugin.material.EmitterFs(pt.surface, scene, plugin);
+    if (radiance == glm::vec3(0.0f)) { return radiance; }
+
+    return
+      radiance
+    * ::MisWeight(
+        scene, plugin, ::lightVertices.data(), ::cameraVertices.data(), s, t
+      );
+  }
+
+  // connections only evaluate the non delta-dirac components of materials,
+  // regardless of which component was sampled at the vertex
+  if (pt.emitter) { return glm::vec3(0.0f); }
+
+  // sample a new point on an emitter, as a light subpath of a single vertex
+  if (s == 1ul) {
+    auto const [triangle, barycentricUv] =
+      mt::core::EmissionSourceTriangle(scene, plugin);
+    if (!triangle.Valid()) { return glm::vec3(0.0f); }
+
+    Vertex sampled = ::ConstructLightVertex(scene, triangle, barycentricUv);
+    if (sampled.pdfFwd <= 0.0f) { return glm::vec3(0.0f); }
+
+    glm::vec3 wo = sampled.surface.origin - pt.surface.origin;
+    float const distanceSqr = glm::dot(wo, wo);
+    wo /= glm::sqrt(distanceSqr);
+
+    sampled.beta =
+      plugin.material.EmitterFs(sampled.surface, scene, plugin)
+    / sampled.pdfFwd;
+
+    glm::vec3 const radiance =
+      pt.beta
+    * plugin.material.BsdfFs(pt.surface, scene, plugin, wo)
+    * sampled.beta
+    * glm::abs(glm::dot(sampled.surface.normal, wo))
+    / distanceSqr
+    ;
+
+    if (radiance == glm::vec3(0.0f)) { return radiance; }
+    if (!::Visible(scene, plugin, pt, sampled)) { return glm::vec3(0.0f); }
+
+    return
+      radiance
+    * ::MisWeight(scene, plugin, &sampled, ::cameraVertices.data(), s, t);
+  }
+
+  // connect the ends of both subpaths
+  auto & qs = ::lightVertices[s-1];
+
+  glm::vec3 wo = qs.surface.origin - pt.surface.origin;
+  float const distanceSqr = glm::dot(wo, wo);
+  if (distanceSqr <= 0.0f) { return glm::vec3(0.0f); }
+  wo /= glm::sqrt(distanceSqr);
+
+  // bsdf values include the cosine of their outgoing direction, which are
+  // those of the geometry term
+  glm::vec3 const radiance =
+    pt.beta
+  * plugin.material.BsdfFs(pt.surface, scene, plugin, wo)
+  * plugin.material.BsdfFs(qs.surface, scene, plugin, -wo)
+  * qs.beta
+  / distanceSqr
+  ;
+
+  if (radiance == glm::vec3(0.0f)) { return radiance; }
+  if (!::Visible(scene, plugin, pt, qs)) { return glm::vec3(0.0f); }
+
+  return
+    radiance
+  * ::MisWeight(
+      scene, plugin, ::lightVertices.data(), ::cameraVertices.data(), s, t
+    );
+}
+
+// next event estimation towards the skybox, weighted against the camera
+// subpath escaping
+glm::vec3 SkyboxEmission(
+  mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+, Vertex const & vertex
+) {
+  if (scene.emissionSource.skyboxEmitterPluginIdx == -1lu)
+    { return glm::vec3(0.0f); }
+
+  glm::vec3 emissionWo;
+  float emissionPdf;
+  auto const info =
+    plugin
+      .emitters[scene.emissionSource.skyboxEmitterPluginIdx]
+      .SampleLi(scene, plugin, vertex.surface, emissionWo, emissionPdf);
+
+  if (!info.valid) { return glm::vec3(0.0f); }
+
+  float const bsdfPdf =
+    plugin.material.IndirectPdf(vertex.surface, scene, plugin, emissionWo);
+  if (bsdfPdf <= 0.0f) { return glm::vec3(0.0f); }
+
+  glm::vec3 const radiance =
+    info.color
+  * vertex.beta
+  * plugin.material.BsdfFs(vertex.surface, scene, plugin, emissionWo)
+  ;
+
+  // delta dirac emitters can't be hit by the camera subpath
+  return
+      emissionPdf == 0.0f
+    ? radiance
+    : radiance * glm::PowerHeuristic(emissionPdf, bsdfPdf) / emissionPdf
+  ;
+}
+
+} // -- end anon namespace
+
+extern "C" {
+
+char const * PluginLabel() { return "bidirectional integrator"; }
+mt::PluginType PluginType() { return mt::PluginType::Integrator; }
+
+mt::PixelInfo Dispatch(
+  glm::vec2 const & uv
+, mt::core::Scene const & scene
+, mt::core::CameraInfo const & camera
+, mt::PluginInfo const & plugin
+, mt::core::IntegratorData const & integratorData
+, mt::core::AovSample & /*aovs*/
+, void (*debugPathRecorder)(mt::debugutil::IntegratorPathUnit)
+) {
+  // paths have at most pathsPerSample bounces
+  size_t const maxDepth = integratorData.pathsPerSample;
+
+  ::cameraVertices.clear();
+  ::lightVertices.clear();
+
+  glm::vec3 radiance = glm::vec3(0.0f);
+
+  { // -- generate camera subpath
+    auto const eye =
+      plugin.camera.Dispatch(
+        plugin.random, camera, integratorData.imageResolution, uv
+      );
+
+    Vertex vertex;
+    vertex.type = VertexType::Camera;
+    vertex.surface.origin = eye.origin;
+    vertex.surface.normal = eye.direction;
+    vertex.surface.coneSpread =
+      mt::core::PixelSpreadAngle(camera, integratorData.imageResolution);
+    vertex.beta = glm::vec3(1.0f);
+    ::cameraVertices.emplace_back(std::move(vertex));
+
+    if (debugPathRecorder) {
+      debugPathRecorder({
+        glm::vec3(1), glm::vec3(0)
+      , mt::TransportMode::Radiance, 0, ::cameraVertices.back().surface
+      });
+    }
+
+    auto const escape =
+      ::RandomWalk(
+        scene, plugin, ::cameraVertices, eye.direction, glm::vec3(1.0f), 1.0f
+      , maxDepth + 2ul, mt::TransportMode::Radiance, debugPathRecorder
+      );
+
+    // apply skybox to the escaping camera subpath
+    if (
+        escape.valid
+     && scene.emissionSource.skyboxEmitterPluginIdx != -1lu
+    ) {
+      float pdf;
+      auto const color =
+        plugin
+          .emitters[scene.emissionSource.skyboxEmitterPluginIdx]
+          .SampleWo(
+            scene, plugin, ::cameraVertices.back().surface, escape.wo, pdf
+          );
+
+      // the primary ray is not sampled by any other strategy
+      bool const unweighted =
+        ::cameraVertices.size() == 1ul || escape.delta || pdf == 0.0f;
+
+      if (color.valid) {
+        radiance +=
+          color.color
+        * escape.beta
+        * (unweighted ? 1.0f : glm::PowerHeuristic(escape.pdf, pdf));
+      }
+    }
+  }
+
+  // -- generate light subpath
+  if (::cameraVertices.size() > 1ul) {
+    auto const [triangle, barycentricUv] =
+      mt::core::EmissionSourceTriangle(scene, plugin);
+
+    if (triangle.Valid()) {
+      Vertex vertex = ::ConstructLightVertex(scene, triangle, barycentricUv);
+
+      if (vertex.pdfFwd > 0.0f) {
+        vertex.beta =
+          plugin.material.EmitterFs(vertex.surface, scene, plugin)
+        / vertex.pdfFwd;
+
+        // emit from either face with a cosine distribution
+        glm::vec2 const u = plugin.random.SampleUniform2();
+        float const side = plugin.random.SampleUniform1() < 0.5f ? 1.0f : -1.0f;
+        glm::vec3 const wo =
+          ReorientHemisphere(
+            Cartesian(glm::sqrt(u.y), glm::Tau*u.x)
+          , side*vertex.surface.normal
+          );
+
+        float const pdfDir = ::EmissionDirectionPdf(vertex, wo);
+        glm::vec3 const beta =
+          vertex.beta * glm::abs(glm::dot(vertex.surface.normal, wo)) / pdfDir;
+
+        ::lightVertices.emplace_back(std::move(vertex));
+
+        if (pdfDir > 0.0f) {
+          ::RandomWalk(
+            scene, plugin, ::lightVertices, wo, beta, pdfDir
+          , maxDepth + 1ul, mt::TransportMode::Importance, nullptr
+          );
+        }
+      }
+    }
+  }
+
+  // -- connect subpaths
+  for (size_t t = 2ul; t <= ::cameraVertices.size(); ++ t) {
+    auto const & pt = ::cameraVertices[t-1];
+
+    if (!pt.emitter && t-2ul < maxDepth)
+      { radiance += ::SkyboxEmission(scene, plugin, pt); }
+
+    for (size_t s = 0ul; s <= ::lightVertices.size(); ++ s) {
+      if (s + t - 2ul > maxDepth) { break; }
+      radiance += ::Connect(scene, plugin, s, t);
+    }
+
+    // sampling a new emitter point doesn't need a light subpath
+    if (::lightVertices.size() == 0ul && t - 1ul <= maxDepth)
+      { radiance += ::Connect(scene, plugin, 1ul, t); }
+  }
+
+  return mt::PixelInfo { radiance, true };
+}
+
+bool RealTime() { return false; }
+
+} // -- extern C
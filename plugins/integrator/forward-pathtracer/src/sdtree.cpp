@@ -0,0 +1,293 @@
+#include "sdtree.hpp"
+
+#include <atomic>
+
+namespace {
+
+// a spatial leaf is split once it recorded this many samples, scaled by the
+// square root of the amount of passes in the training iteration
+constexpr float spatialSplitThreshold = 12000.0f;
+
+// a quadrant is refined while it holds more than this fraction of the energy
+constexpr float directionalSplitThreshold = 0.01f;
+constexpr size_t directionalMaxDepth = 20ul;
+
+constexpr uint32_t noNode = static_cast<uint32_t>(-1);
+
+// largest float below 1, keeps points of the unit square in half-open bounds
+constexpr float oneMinusEpsilon = 0.99999994f;
+
+// maps a direction onto the unit square by its cylindrical coordinates
+glm::vec2 DirectionToSquare(glm::vec3 const & direction) {
+  float const cosTheta = glm::clamp(direction.z, -1.0f, 1.0f);
+  float phi = glm::atan(direction.y, direction.x);
+  if (phi < 0.0f) { phi += glm::Tau; }
+
+  return
+    glm::clamp(
+      glm::vec2((cosTheta + 1.0f) * 0.5f, phi * glm::InvTau)
+    , glm::vec2(0.0f), glm::vec2(::oneMinusEpsilon)
+    );
+}
+
+glm::vec3 SquareToDirection(glm::vec2 const & square) {
+  float const
+    cosTheta = 2.0f*square.x - 1.0f
+  , sinTheta = glm::sqrt(glm::max(0.0f, 1.0f - cosTheta*cosTheta))
+  , phi = glm::Tau * square.y
+  ;
+
+  return glm::vec3(sinTheta*glm::cos(phi), sinTheta*glm::sin(phi), cosTheta);
+}
+
+// quadrant of the node containing the point, which is then remapped to the
+// quadrant
+size_t Quadrant(glm::vec2 & point) {
+  glm::uvec2 const quadrant =
+    glm::uvec2(glm::greaterThanEqual(point, glm::vec2(0.5f)));
+  point = point*2.0f - glm::vec2(quadrant);
+  return quadrant.x + 2ul*quadrant.y;
+}
+
+size_t LeafIdx(sdtree::SdTree const & self, glm::vec3 const & position) {
+  glm::vec3 point =
+    glm::clamp(
+      (position - self.boundsMin) / self.boundsSize
+    , glm::vec3(0.0f), glm::vec3(1.0f)
+    );
+
+  size_t idx = 0ul;
+  while (self.nodes[idx].child[0] != 0u) {
+    auto const axis = self.nodes[idx].axis;
+    size_t const side = point[axis] >= 0.5f ? 1ul : 0ul;
+    point[axis] = glm::min(1.0f, point[axis]*2.0f - static_cast<float>(side));
+    idx = self.nodes[idx].child[side];
+  }
+
+  return idx;
+}
+
+// subdivides the quadrants of the output node that hold enough energy of the
+// previous quadtree, the energy of quadrants that the previous quadtree didn't
+// refine is assumed to be spread uniformly
+void Subdivide(
+  sdtree::DTree const & previous
+, uint32_t const previousIdx
+, std::array<float, 4> const & energy
+, float const totalEnergy
+, size_t const depth
+, sdtree::DTree & output
+, uint32_t const outputIdx
+) {
+  if (depth >= ::directionalMaxDepth) { return; }
+
+  for (size_t quadrant = 0ul; quadrant < 4ul; ++ quadrant) {
+    if (energy[quadrant] <= totalEnergy*::directionalSplitThreshold)
+      { continue; }
+
+    uint32_t childPreviousIdx = ::noNode;
+    std::array<float, 4> childEnergy;
+    childEnergy.fill(energy[quadrant] * 0.25f);
+
+    if (
+        previousIdx != ::noNode
+     && previous.nodes[previousIdx].child[quadrant] != 0u
+    ) {
+      childPreviousIdx = previous.nodes[previousIdx].child[quadrant];
+      childEnergy = previous.nodes[childPreviousIdx].sum;
+    }
+
+    auto const childIdx = static_cast<uint32_t>(output.nodes.size());
+    output.nodes.emplace_back();
+    output.nodes[outputIdx].child[quadrant] = childIdx;
+
+    ::Subdivide(
+      previous, childPreviousIdx, childEnergy, totalEnergy, depth+1ul
+    , output, childIdx
+    );
+  }
+}
+
+} // -- namespace
+
+////////////////////////////////////////////////////////////////////////////////
+float sdtree::DTree::Energy() const {
+  auto const & sum = this->nodes[0].sum;
+  return sum[0] + sum[1] + sum[2] + sum[3];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+sdtree::SpatialNode const & sdtree::Leaf(
+  sdtree::SdTree const & self
+, glm::vec3 const & position
+) {
+  return self.nodes[::LeafIdx(self, position)];
+}
+
+////////////////////////////////////////////////////////////////////////////////
+glm::vec3 sdtree::Sample(sdtree::DTree const & self, glm::vec2 u) {
+  if (self.Energy() <= 0.0f) { return ::SquareToDirection(u); }
+
+  u = glm::min(u, glm::vec2(::oneMinusEpsilon));
+
+  glm::vec2 origin = glm::vec2(0.0f);
+  float size = 1.0f;
+
+  for (uint32_t idx = 0u;;) {
+    auto const & sum = self.nodes[idx].sum;
+
+    // choose the column by its energy, then the quadrant within the column,
+    // reusing the remapped uniform samples
+    float const
+      left = sum[0] + sum[2]
+    , total = left + sum[1] + sum[3]
+    , leftChance = left / total
+    ;
+
+    // nothing recorded in this region, so sample it uniformly
+    if (total <= 0.0f) { break; }
+
+    glm::uvec2 quadrant;
+    if (u.x < leftChance) {
+      quadrant.x = 0u;
+      u.x /= leftChance;
+    } else {
+      quadrant.x = 1u;
+      u.x = (u.x - leftChance) / (1.0f - leftChance);
+    }
+
+    float const
+      bottom = sum[quadrant.x]
+    , bottomChance = bottom / (bottom + sum[quadrant.x + 2u])
+    ;
+
+    if (u.y < bottomChance) {
+      quadrant.y = 0u;
+      u.y /= bottomChance;
+    } else {
+      quadrant.y = 1u;
+      u.y = (u.y - bottomChance) / (1.0f - bottomChance);
+    }
+
+    size *= 0.5f;
+    origin += glm::vec2(quadrant) * size;
+
+    idx = self.nodes[idx].child[quadrant.x + 2u*quadrant.y];
+    if (idx == 0u) { break; }
+  }
+
+  return
+    ::SquareToDirection(
+      glm::min(origin + u*size, glm::vec2(::oneMinusEpsilon))
+    );
+}
+
+////////////////////////////////////////////////////////////////////////////////
+float sdtree::Pdf(sdtree::DTree const & self, glm::vec3 const & direction) {
+  if (self.Energy() <= 0.0f) { return 0.25f*glm::InvPi; }
+
+  glm::vec2 point = ::DirectionToSquare(direction);
+  float pdf = 0.25f*glm::InvPi;
+
+  for (uint32_t idx = 0u;;) {
+    auto const & sum = self.nodes[idx].sum;
+    float const total = sum[0] + sum[1] + sum[2] + sum[3];
+
+    // Sample chooses the region uniformly if nothing was recorded in it
+    if (total <= 0.0f) { break; }
+
+    size_t const quadrant = ::Quadrant(point);
+    pdf *= 4.0f * sum[quadrant] / total;
+
+    idx = self.nodes[idx].child[quadrant];
+    if (idx == 0u) { break; }
+  }
+
+  return pdf;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void sdtree::Record(
+  sdtree::SdTree & self
+, glm::vec3 const & position, glm::vec3 const & direction
+, float const radiance
+) {
+  auto & tree = self.nodes[::LeafIdx(self, position)].building;
+
+  std::atomic_ref<uint32_t>(tree.sampleCount)
+    .fetch_add(1u, std::memory_order_relaxed);
+
+  if (!(radiance > 0.0f) || glm::isinf(radiance)) { return; }
+
+  glm::vec2 point = ::DirectionToSquare(direction);
+  for (uint32_t idx = 0u;;) {
+    size_t const quadrant = ::Quadrant(point);
+    std::atomic_ref<float>(tree.nodes[idx].sum[quadrant])
+      .fetch_add(radiance, std::memory_order_relaxed);
+
+    idx = tree.nodes[idx].child[quadrant];
+    if (idx == 0u) { break; }
+  }
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void sdtree::Reset(
+  sdtree::SdTree & self
+, glm::vec3 const & boundsMin, glm::vec3 const & boundsMax
+) {
+  self.boundsMin = boundsMin;
+  self.boundsSize = glm::max(boundsMax - boundsMin, glm::vec3(0.0001f));
+  self.nodes.assign(1ul, sdtree::SpatialNode{});
+  self.iteration = 0ul;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+void sdtree::Refine(sdtree::SdTree & self) {
+  uint32_t const sampleThreshold =
+    static_cast<uint32_t>(
+      ::spatialSplitThreshold
+    * glm::sqrt(static_cast<float>(1ul << self.iteration))
+    );
+
+  // -- split spatial leaves, the children inherit the quadtree of their parent
+  //    & are visited again in case they need to be split further
+  for (size_t idx = 0ul; idx < self.nodes.size(); ++ idx) {
+    if (self.nodes[idx].child[0] != 0u) { continue; }
+    if (self.nodes[idx].building.sampleCount <= sampleThreshold) { continue; }
+
+    sdtree::SpatialNode child;
+    child.axis = static_cast<uint8_t>((self.nodes[idx].axis + 1u) % 3u);
+    child.building = std::move(self.nodes[idx].building);
+    child.building.sampleCount /= 2u;
+    child.sampling = std::move(self.nodes[idx].sampling);
+
+    auto const childIdx = static_cast<uint32_t>(self.nodes.size());
+    self.nodes[idx].child = {{ childIdx, childIdx + 1u }};
+    self.nodes[idx].building = {};
+    self.nodes[idx].sampling = {};
+
+    self.nodes.emplace_back(child);
+    self.nodes.emplace_back(std::move(child));
+  }
+
+  // -- the building quadtrees become the sampling quadtrees, unless nothing was
+  //    recorded in them, and are then refined for the next iteration
+  for (auto & node : self.nodes) {
+    if (node.child[0] != 0u) { continue; }
+
+    float const energy = node.building.Energy();
+    if (energy > 0.0f) { node.sampling = std::move(node.building); }
+
+    sdtree::DTree building;
+    if (node.sampling.Energy() > 0.0f) {
+      ::Subdivide(
+        node.sampling, 0u, node.sampling.nodes[0].sum
+      , node.sampling.Energy(), 1ul
+      , building, 0u
+      );
+    }
+    node.building = std::move(building);
+  }
+
+  ++ self.iteration;
+}
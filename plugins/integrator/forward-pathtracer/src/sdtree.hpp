@@ -0,0 +1,78 @@
+#pragma once
+
+#include <monte-toad/core/math.hpp>
+
+#include <array>
+#include <cstdint>
+#include <vector>
+
+// spatial-directional tree of incident radiance used to guide paths ("Practical
+// Path Guiding", Müller et al. 2017); a binary tree partitions the scene
+// bounds, and each of its leaves stores directional quadtrees over the
+// cylindrical coordinates (cosθ, φ) of a direction, which map the sphere onto
+// the unit square with equal area
+//
+// the sampling quadtrees are only read while rendering, whereas radiance is
+// atomically recorded into the building quadtrees; so Dispatch can run
+// concurrently, but Reset & Refine must be called while no path is traced
+
+namespace sdtree {
+  struct QuadNode {
+    // radiance recorded in each quadrant, and the node refining it (0 if the
+    // quadrant is a leaf, as the root can't be a child)
+    std::array<float, 4> sum = {{ 0.0f, 0.0f, 0.0f, 0.0f }};
+    std::array<uint32_t, 4> child = {{ 0u, 0u, 0u, 0u }};
+  };
+
+  struct DTree {
+    std::vector<QuadNode> nodes = std::vector<QuadNode>(1ul);
+    uint32_t sampleCount = 0u;
+
+    float Energy() const;
+  };
+
+  struct SpatialNode {
+    // children are split halfway along the axis, 0 if this is a leaf
+    std::array<uint32_t, 2> child = {{ 0u, 0u }};
+    uint8_t axis = 0u;
+
+    DTree sampling, building;
+  };
+
+  struct SdTree {
+    glm::vec3 boundsMin = glm::vec3(0.0f), boundsSize = glm::vec3(1.0f);
+    std::vector<SpatialNode> nodes;
+
+    // training iterations that have been refined so far
+    size_t iteration = 0ul;
+
+    bool Valid() const { return nodes.size() > 0ul; }
+  };
+
+  // leaf of the spatial tree containing the position
+  SpatialNode const & Leaf(SdTree const & self, glm::vec3 const & position);
+
+  // samples a world-space direction proportional to the quadtree, the pdf is
+  // in solid angle
+  glm::vec3 Sample(DTree const & self, glm::vec2 u);
+  float Pdf(DTree const & self, glm::vec3 const & direction);
+
+  // records radiance arriving from the direction, weighted by the inverse pdf
+  // of having sampled the direction
+  void Record(
+    SdTree & self
+  , glm::vec3 const & position, glm::vec3 const & direction
+  , float const radiance
+  );
+
+  // clears the tree to a single spatial leaf of uniform quadtrees
+  void Reset(
+    SdTree & self
+  , glm::vec3 const & boundsMin, glm::vec3 const & boundsMax
+  );
+
+  // ends a training iteration; spatial leaves that recorded many samples are
+  // split, the building quadtrees become the sampling quadtrees, and new
+  // building quadtrees are subdivided where most energy was recorded
+  void Refine(SdTree & self);
+}
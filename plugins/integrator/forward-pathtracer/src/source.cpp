@@ -1,10 +1,15 @@
 // forward path tracer
 
+#include "sdtree.hpp"
+
+#include <monte-toad/core/aov.hpp>
+#include <monte-toad/core/camerainfo.hpp>
 #include <monte-toad/core/enum.hpp>
 #include <monte-toad/core/geometry.hpp>
 #include <monte-toad/core/integratordata.hpp>
 #include <monte-toad/core/log.hpp>
 #include <monte-toad/core/math.hpp>
+#include <monte-toad/core/renderinfo.hpp>
 #include <monte-toad/core/scene.hpp>
 #include <monte-toad/core/spectrum.hpp>
 #include <monte-toad/core/surfaceinfo.hpp>
@@ -13,10 +18,142 @@
 
 #include <mt-plugin/plugin.hpp>
 
+#include <imgui/imgui.hpp>
+
+#include <vector>
+
 namespace mt::core { struct CameraInfo; }
 
 namespace {
 
+// output channels splitting the irradiance into light arriving directly from
+// the primary hit (including emitters seen directly) & the remaining bounces
+size_t aovDirect = -1lu, aovIndirect = -1lu;
+
+// values along a path are glm::vec4s; RGB paths store the colour in the first
+// 3 lanes & leave the last empty, while spectral paths (which have a hero
+// wavelength) store a value per wavelength, so both are traced at the same cost
+glm::vec4 Lift(
+  mt::core::SampledWavelengths const & wavelengths
+, glm::vec3 const & rgb
+) {
+  if (wavelengths.lambda.x <= 0.0f) { return glm::vec4(rgb, 0.0f); }
+  return mt::core::RgbToSpectrum(rgb, wavelengths);
+}
+
+glm::vec3 Resolve(
+  mt::core::SampledWavelengths const & wavelengths
+, glm::vec4 const & value
+) {
+  if (wavelengths.lambda.x <= 0.0f) { return glm::vec3(value); }
+  return mt::core::SpectrumToRgb(value, wavelengths);
+}
+
+// path guiding learns the incident radiance of the scene over the progressive
+// passes of the dispatcher, which is then sampled alongside the bsdf
+struct Guiding {
+  bool enabled = false;
+
+  // probability of sampling the bsdf instead of the guiding distribution
+  float bsdfSamplingFraction = 0.5f;
+
+  // each training iteration lasts twice as many passes over the image as the
+  // previous iteration
+  size_t trainingIterations = 6ul;
+  size_t iterationEndCycle = 0ul;
+
+  sdtree::SdTree tree;
+};
+
+::Guiding guiding;
+
+// a path vertex that records the radiance arriving along its sampled direction
+// into the guiding distribution once the path has finished
+struct GuidingVertex {
+  glm::vec3 origin, wo;
+
+  // path throughput after scattering along wo, and the irradiance accumulated
+  // before the vertex & by its next event estimation
+  glm::vec4 radiance, irradiance, neeIrradiance;
+
+  // pdf of having sampled wo, 0 for delta-dirac components which are not
+  // recorded
+  float pdf = 0.0f;
+};
+
+bool GuidingTraining() {
+  return
+    ::guiding.enabled
+ && ::guiding.tree.Valid()
+ && ::guiding.tree.iteration < ::guiding.trainingIterations
+  ;
+}
+
+// quadtree guiding the surface, none if it has not learnt anything yet
+sdtree::DTree const * GuidingDistribution(
+  mt::core::SurfaceInfo const & surface
+) {
+  if (!::guiding.enabled || ::guiding.tree.iteration == 0ul) {
+    return nullptr;
+  }
+
+  auto const & distribution =
+    sdtree::Leaf(::guiding.tree, surface.origin).sampling;
+
+  return distribution.Energy() > 0.0f ? &distribution : nullptr;
+}
+
+// pdf of Propagate sampling wo, which mixes bsdf sampling with the guiding
+// distribution when there is one
+float SamplingPdf(
+  mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+, mt::core::SurfaceInfo const & surface
+, sdtree::DTree const * distribution
+, glm::vec3 const & wo
+) {
+  float const bsdfPdf =
+    plugin.material.IndirectPdf(surface, scene, plugin, wo);
+
+  if (!distribution) { return bsdfPdf; }
+
+  return
+    glm::mix(
+      sdtree::Pdf(*distribution, wo), bsdfPdf, ::guiding.bsdfSamplingFraction
+    );
+}
+
+// records the radiance each vertex received along its sampled direction, which
+// is everything accumulated after the vertex besides its own next event
+// estimation, over the throughput up to the vertex
+void RecordGuidingVertices(
+  std::vector<::GuidingVertex> const & vertices
+, glm::vec4 const & accumulatedIrradiance
+) {
+  for (auto const & vertex : vertices) {
+    if (vertex.pdf <= 0.0f) { continue; }
+
+    glm::vec4 const incoming =
+      accumulatedIrradiance - vertex.irradiance - vertex.neeIrradiance;
+
+    // averaged over the lanes the path still carries
+    float radiance = 0.0f;
+    size_t components = 0ul;
+    for (glm::length_t component = 0; component < 4; ++ component) {
+      if (vertex.radiance[component] <= 0.0f) { continue; }
+      radiance += incoming[component] / vertex.radiance[component];
+      ++ components;
+    }
+
+    if (components == 0ul) { continue; }
+
+    sdtree::Record(
+      ::guiding.tree, vertex.origin, vertex.wo
+    , radiance / static_cast<float>(components) / vertex.pdf
+    );
+  }
+}
+
 enum class PropagationStatus {
   Continue = 0 // normal behaviour, continue propagation
 , IndirectAccumulation = 1 // emitter has been indirectly hit (such as for MIS)
@@ -40,130 +177,155 @@ void Join(PropagationStatus & l, PropagationStatus r) {
   l = Idx(l) > Idx(r) ? l : r;
 }
 
-// TODO move
-[[maybe_unused]] float EmitterPdf(
-  mt::core::SurfaceInfo const & surface
+// solid angle pdf of EmissionSourceTriangle generating the emission surface,
+// as seen from the surface it was hit from
+float EmitterPdf(
+  mt::core::Scene const & scene
+, mt::core::SurfaceInfo const & surface
 , mt::core::SurfaceInfo const & emissionSurface
 ) {
-  glm::vec3 const wo = emissionSurface.incomingAngle;
-  float inverseDistanceSqr = 1.0f/glm::sqr(glm::length(wo));
-
-  float pdf;
-  pdf = glm::InvPi * glm::dot(surface.normal, wo);
-  pdf *= inverseDistanceSqr;
-  /* float const surfaceArea = emissionTri->area(); */
-  return pdf;
+  float const cosTheta =
+    glm::abs(glm::dot(emissionSurface.normal, emissionSurface.incomingAngle));
+  if (cosTheta <= 0.0f) { return 0.0f; }
+
+  return
+    mt::core::EmissionSourceTrianglePdf(
+      scene, surface, emissionSurface.triangle
+    )
+  * glm::sqr(emissionSurface.distance) / cosTheta
+  ;
 }
 
+// next event estimation; samples the skybox & an emissive triangle directly,
+// weighted against bsdf sampling with the power heuristic
 PropagationStatus ApplyIndirectEmission(
-  mt::core::Scene const & /*scene*/
-, mt::PluginInfo const & /*plugin*/
-, mt::core::SurfaceInfo const & /*surface*/
-, glm::vec3 const & /*radiance*/
-, glm::vec3 & /*accumulatedIrradiance*/
-, size_t /*it*/
-, void (* /*debugPathRecorder*/)(mt::debugutil::IntegratorPathUnit)
+  mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+, mt::core::SurfaceInfo const & surface
+, sdtree::DTree const * distribution
+, mt::core::SampledWavelengths const & wavelengths
+, glm::vec4 const & radiance
+, glm::vec4 & accumulatedIrradiance
+, size_t it
+, void (*debugPathRecorder)(mt::debugutil::IntegratorPathUnit)
 ) {
-  return PropagationStatus::Continue;
-  /* auto propagationStatus = PropagationStatus::Continue; */
-
-  /* /1* if (scene.emissionSource.skyboxEmitterPluginIdx != -1lu) *1/ */
-  /* /1* { // apply indirect emission from skybox if available *1/ */
-  /* /1*   glm::vec3 emissionWo; *1/ */
-  /* /1*   float emissionPdf; *1/ */
-  /* /1*   auto info = *1/ */
-  /* /1*     plugin *1/ */
-  /* /1*       .emitters[scene.emissionSource.skyboxEmitterPluginIdx] *1/ */
-  /* /1*       .SampleLi(scene, plugin, surface, emissionWo, emissionPdf); *1/ */
-
-  /* /1*   if (info.valid) { *1/ */
-  /* /1*     float bsdfPdf = *1/ */
-  /* /1*       plugin.material.BsdfPdf(plugin.material, surface, emissionWo); *1/ */
-
-  /* /1*     // only valid if the bsdfPdf is not delta dirac *1/ */
-  /* /1*     if (bsdfPdf > 0.0f) { *1/ */
-  /* /1*       glm::vec3 irradiance = *1/ */
-  /* /1*         info.color *1/ */
-  /* /1*       * radiance *1/ */
-  /* /1*       * plugin.material.BsdfFs(plugin.material, surface, emissionWo) *1/ */
-  /* /1*       / (emissionPdf/(emissionPdf + bsdfPdf)); *1/ */
-
-  /* /1*       if (glm::length(irradiance) > 0.0001f) { *1/ */
-  /* /1*         propagationStatus = PropagationStatus::IndirectAccumulation; *1/ */
-  /* /1*         accumulatedIrradiance += irradiance; *1/ */
-  /* /1*       } *1/ */
-  /* /1*     } *1/ */
-  /* /1*   } *1/ */
-  /* /1* } *1/ */
-
-  /* { // apply indirect emission from random emitter in scene */
-  /*   auto [emissionTriangle, emissionBarycentricUvCoord] = */
-  /*     mt::core::EmissionSourceTriangle(scene, plugin); */
-
-  /*   if (!emissionTriangle) { return propagationStatus; } */
-
-  /*   auto emissionOrigin = */
-  /*     BarycentricInterpolation( */
-  /*       emissionTriangle->v0, emissionTriangle->v1, emissionTriangle->v2 */
-  /*     , emissionBarycentricUvCoord */
-  /*     ); */
-
-  /*   glm::vec3 emissionWo = glm::normalize(emissionOrigin - surface.origin); */
-
-  /*   float bsdfEmitPdf = */
-  /*     mt::core::MaterialIndirectPdf(surface, scene, plugin, emissionWo); */
-
-  /*   // if the surface is delta-dirac, than there is no indirect emission */
-  /*   // contribution */
-  /*   if (bsdfEmitPdf == 0.0f) { return propagationStatus; } */
-
-  /*   // check that emission source is within reflected hemisphere */
-  /*   if (glm::dot(emissionWo, surface.normal) <= 0.0f) */
-  /*     { return propagationStatus; } */
-
-  /*   mt::core::SurfaceInfo emissionSurface = */
-  /*     mt::core::Raycast(scene, surface.origin, emissionWo, surface.triangle); */
-
-  /*   if (emissionSurface.triangle != emissionTriangle) */
-  /*     { return propagationStatus; } */
-
-  /*   float emitPdf = EmitterPdf(surface, emissionSurface); */
-
-  /*   propagationStatus = PropagationStatus::IndirectAccumulation; */
-  /*   accumulatedIrradiance += */
-  /*     mt::core::MaterialFs( */
-  /*       emissionSurface, scene, plugin, glm::vec3(0), true, 0 */
-  /*     ) */
-  /*   * radiance */
-  /*   * mt::core::MaterialFs( */
-  /*       surface, scene, plugin, emissionWo, true, 0 */
-  /*   / (emitPdf/(emitPdf + bsdfEmitPdf)) */
-  /*   ; */
-
-
-  /*   if (debugPathRecorder) { */
-  /*     debugPathRecorder({ */
-  /*       radiance, accumulatedIrradiance */
-  /*     , mt::TransportMode::Importance, it+2, surface */
-  /*     }); */
-  /*   } */
-  /* } */
-
-  /* return propagationStatus; */
+  auto propagationStatus = PropagationStatus::Continue;
+
+  if (scene.emissionSource.skyboxEmitterPluginIdx != -1lu)
+  { // apply indirect emission from skybox if available
+    glm::vec3 emissionWo;
+    float emissionPdf;
+    auto const info =
+      plugin
+        .emitters[scene.emissionSource.skyboxEmitterPluginIdx]
+        .SampleLi(scene, plugin, surface, emissionWo, emissionPdf);
+
+    float const bsdfPdf =
+      ::SamplingPdf(scene, plugin, surface, distribution, emissionWo);
+
+    // only valid if the bsdf is not delta dirac
+    if (info.valid && bsdfPdf > 0.0f) {
+      glm::vec3 const fs =
+        plugin.material.BsdfFs(surface, scene, plugin, emissionWo);
+
+      // delta dirac emitters can't be hit by bsdf sampling, so no weighting
+      glm::vec4 const contribution =
+        ::Lift(wavelengths, info.color) * radiance * ::Lift(wavelengths, fs);
+      glm::vec4 const irradiance =
+          emissionPdf == 0.0f
+        ? contribution
+        : contribution
+        * glm::PowerHeuristic(emissionPdf, bsdfPdf) / emissionPdf
+      ;
+
+      if (glm::length(irradiance) > 0.0f) {
+        propagationStatus = PropagationStatus::IndirectAccumulation;
+        accumulatedIrradiance += irradiance;
+      }
+    }
+  }
+
+  { // apply indirect emission from random emitter in scene
+    auto const [emissionTriangle, emissionBarycentricUvCoord] =
+      mt::core::EmissionSourceTriangle(scene, plugin, surface);
+
+    if (!emissionTriangle.Valid()) { return propagationStatus; }
+
+    auto const & origins = emissionTriangle.mesh->origins;
+    glm::vec3 const emissionOrigin =
+      BarycentricInterpolation(
+        origins[emissionTriangle.idx*3 + 0]
+      , origins[emissionTriangle.idx*3 + 1]
+      , origins[emissionTriangle.idx*3 + 2]
+      , emissionBarycentricUvCoord
+      );
+
+    glm::vec3 const emissionWo = glm::normalize(emissionOrigin - surface.origin);
+
+    float const bsdfPdf =
+      ::SamplingPdf(scene, plugin, surface, distribution, emissionWo);
+
+    // if the surface is delta-dirac, than there is no indirect emission
+    // contribution
+    if (bsdfPdf == 0.0f) { return propagationStatus; }
+
+    mt::core::SurfaceInfo const emissionSurface =
+      mt::core::Raycast(
+        scene, plugin, surface.origin, emissionWo, surface.triangle.idx
+      );
+
+    // occluded
+    if (emissionSurface.triangle.idx != emissionTriangle.idx)
+      { return propagationStatus; }
+
+    float const emissionPdf = ::EmitterPdf(scene, surface, emissionSurface);
+    if (emissionPdf <= 0.0f) { return propagationStatus; }
+
+    glm::vec4 const irradiance =
+      ::Lift(
+        wavelengths, plugin.material.EmitterFs(emissionSurface, scene, plugin)
+      )
+    * radiance
+    * ::Lift(
+        wavelengths, plugin.material.BsdfFs(surface, scene, plugin, emissionWo)
+      )
+    * glm::PowerHeuristic(emissionPdf, bsdfPdf) / emissionPdf
+    ;
+
+    if (glm::length(irradiance) > 0.0f) {
+      propagationStatus = PropagationStatus::IndirectAccumulation;
+      accumulatedIrradiance += irradiance;
+    }
+
+    if (debugPathRecorder) {
+      debugPathRecorder({
+        ::Resolve(wavelengths, radiance)
+      , ::Resolve(wavelengths, accumulatedIrradiance)
+      , mt::TransportMode::Importance, it+1, emissionSurface
+      });
+    }
+  }
+
+  return propagationStatus;
 }
 
 PropagationStatus Propagate(
   mt::core::Scene const & scene
 , mt::core::SurfaceInfo & surface
-, glm::vec3 & radiance
-, glm::vec3 & accumulatedIrradiance
+, mt::core::SampledWavelengths & wavelengths
+, glm::vec4 & radiance
+, glm::vec4 & accumulatedIrradiance
 , size_t const it
 , mt::PluginInfo const & plugin
+, mt::core::BsdfSampleInfo const * sampledBsdf
+, ::GuidingVertex * guidingVertex
 , void (*debugPathRecorder)(mt::debugutil::IntegratorPathUnit)
 ) {
   if (debugPathRecorder) {
     debugPathRecorder({
-      radiance, accumulatedIrradiance, mt::TransportMode::Radiance, it, surface
+      ::Resolve(wavelengths, radiance)
+    , ::Resolve(wavelengths, accumulatedIrradiance)
+    , mt::TransportMode::Radiance, it, surface
     });
   }
 
@@ -175,18 +337,75 @@ PropagationStatus Propagate(
     return PropagationStatus::End;
   }
 
-  // generate bsdf sample (this will also be used for next propagation)
-  mt::core::BsdfSampleInfo bsdf =
-    plugin.material.Sample(surface, scene, plugin);
+  if (guidingVertex) {
+    guidingVertex->origin = surface.origin;
+    guidingVertex->irradiance = accumulatedIrradiance;
+  }
+
+  auto const * distribution = ::GuidingDistribution(surface);
+
+  // generate bsdf sample (this will also be used for next propagation), or
+  // sample the guiding distribution instead. The bsdf could have already been
+  // sampled in a batch by the dispatcher
+  bool const sampleBsdf =
+      !distribution
+   || plugin.random.SampleUniform1() < ::guiding.bsdfSamplingFraction;
+
+  mt::core::BsdfSampleInfo bsdf;
+  if (sampleBsdf && sampledBsdf) {
+    bsdf = *sampledBsdf;
+  } else if (sampleBsdf) {
+    bsdf = plugin.material.Sample(surface, scene, plugin);
+  } else {
+    bsdf.wo = sdtree::Sample(*distribution, plugin.random.SampleUniform2());
+  }
+
+  // rejected samples, such as microfacet normals reflecting wo under the
+  // surface, have no direction & mustn't be mistaken for delta-dirac ones
+  if (bsdf.wo == glm::vec3(0.0f)) { return PropagationStatus::End; }
+
+  // delta-dirac components can't be sampled by next event estimation, so
+  // emissions they hit are not weighted
+  bool const deltaDirac = sampleBsdf && bsdf.pdf == 0.0f;
+
+  // pdf of the material generating wo for MIS, which is the combined pdf of all
+  // its components rather than only the one sampled
+  float const bsdfPdf =
+    deltaDirac
+      ? 0.0f : ::SamplingPdf(scene, plugin, surface, distribution, bsdf.wo);
+
+  // delta-dirac correct pdfs, valid only for direct emissions. When guided,
+  // the mixture of the bsdf & guiding distribution is evaluated instead of the
+  // sampled component
+  if (deltaDirac) {
+    bsdf.pdf = distribution ? ::guiding.bsdfSamplingFraction : 1.0f;
+  } else if (distribution) {
+    bsdf.fs = plugin.material.BsdfFs(surface, scene, plugin, bsdf.wo);
+    bsdf.pdf = bsdfPdf;
+  }
+
+  if (bsdf.pdf <= 0.0f || bsdf.fs == glm::vec3(0.0f))
+    { return PropagationStatus::End; }
+
+  // wo was only sampled for the hero wavelength
+  if (bsdf.dispersive) {
+    mt::core::TerminateSecondaryWavelengths(wavelengths, radiance);
+  }
 
-  // delta-dirac correct pdfs, valid only for direct emissions
-  bsdf.pdf = bsdf.pdf == 0.0f ? 1.0f : bsdf.pdf;
+  if (guidingVertex) {
+    guidingVertex->wo = bsdf.wo;
+    guidingVertex->pdf = bsdfPdf;
+  }
 
   // grab information of next surface
   mt::core::SurfaceInfo nextSurface =
     mt::core::Raycast(
       scene, plugin, surface.origin, bsdf.wo, surface.triangle.idx
     );
+  nextSurface.wavelength = surface.wavelength;
+  mt::core::PropagateRayCone(
+    nextSurface, surface.coneWidth, surface.coneSpread
+  );
 
   // check if an emitter or skybox (which could be a blackbody) was hit
   if (!nextSurface.triangle.Valid()) {
@@ -199,8 +418,11 @@ PropagationStatus Propagate(
       auto color = emitter.SampleWo(scene, plugin, surface, bsdf.wo, pdf);
 
       if (color.valid) {
-        // TODO use pdf
-        accumulatedIrradiance += color.color * radiance * bsdf.fs / bsdf.pdf;
+        float const weight =
+          deltaDirac || pdf == 0.0f ? 1.0f : glm::PowerHeuristic(bsdfPdf, pdf);
+        accumulatedIrradiance +=
+          ::Lift(wavelengths, color.color) * radiance
+        * ::Lift(wavelengths, bsdf.fs) / bsdf.pdf * weight;
         Join(propagationStatus, PropagationStatus::DirectAccumulation);
       } else {
         Join(propagationStatus, PropagationStatus::End);
@@ -213,20 +435,25 @@ PropagationStatus Propagate(
     auto emissiveColor =
       plugin.material.EmitterFs(nextSurface, scene, plugin);
 
-    /* float emitPdf = EmitterPdf(surface, nextSurface); */
+    float const emitPdf = ::EmitterPdf(scene, surface, nextSurface);
+    float const weight =
+      deltaDirac || emitPdf == 0.0f
+        ? 1.0f : glm::PowerHeuristic(bsdfPdf, emitPdf);
 
     accumulatedIrradiance +=
-      emissiveColor * radiance * bsdf.fs / bsdf.pdf;
-      // TODO use below
-    /* emissiveColor * radiance * bsdfFs / (bsdfPdf/(emitPdf + bsdfPdf)); */
+      ::Lift(wavelengths, emissiveColor) * radiance
+    * ::Lift(wavelengths, bsdf.fs) / bsdf.pdf * weight;
 
     propagationStatus = PropagationStatus::DirectAccumulation;
   }
 
+  glm::vec4 const directIrradiance = accumulatedIrradiance;
+
   Join(
     propagationStatus,
     ApplyIndirectEmission(
-      scene, plugin, surface, radiance, accumulatedIrradiance
+      scene, plugin, surface, distribution, wavelengths
+    , radiance, accumulatedIrradiance
     , it+1, debugPathRecorder
     )
   );
@@ -234,7 +461,12 @@ PropagationStatus Propagate(
   // contribute to radiance only after emission values are calculated, as it is
   // invalid for indirect emission, and the direct emission might need to handle
   // the PDF in a specific manner anyways
-  radiance *= bsdf.fs / bsdf.pdf;
+  radiance *= ::Lift(wavelengths, bsdf.fs) / bsdf.pdf;
+
+  if (guidingVertex) {
+    guidingVertex->radiance = radiance;
+    guidingVertex->neeIrradiance = accumulatedIrradiance - directIrradiance;
+  }
 
   // -- save raycastinfo
   surface.previousSurface.reset();
@@ -245,6 +477,243 @@ PropagationStatus Propagate(
   return propagationStatus;
 }
 
+// a path that is being traced; paths that are split are traced one after
+// another
+struct PathState {
+  mt::core::SurfaceInfo surface;
+  glm::vec4 radiance;
+  size_t it;
+
+  // paths split off share the wavelengths, but terminate them on their own
+  mt::core::SampledWavelengths wavelengths;
+};
+
+// incident radiance at the surface learnt by path guiding, which is the mean
+// of the radiance recorded over the sampling pdfs, 0 if nothing is learnt
+float IncidentRadianceEstimate(mt::core::SurfaceInfo const & surface) {
+  if (!::guiding.enabled || ::guiding.tree.iteration == 0ul) { return 0.0f; }
+
+  auto const & distribution =
+    sdtree::Leaf(::guiding.tree, surface.origin).sampling;
+
+  if (distribution.sampleCount == 0u) { return 0.0f; }
+
+  return
+    distribution.Energy() / static_cast<float>(distribution.sampleCount);
+}
+
+// russian roulette & splitting after a bounce, returns the amount of paths to
+// continue with, 0 terminates the path. The radiance of the path is
+// compensated for the paths that were terminated or split off
+size_t RussianRoulette(
+  mt::core::IntegratorData const & integratorData
+, mt::PluginInfo const & plugin
+, ::PathState & path
+, float const pixelEstimate
+, bool const splitting
+) {
+  if (integratorData.russianRoulette == mt::RussianRoulette::Off) {
+    return 1ul;
+  }
+
+  // expected contribution of the path relative to the pixel; without an
+  // estimate of incident radiance this is only the path throughput
+  float ratio =
+    glm::max(
+      glm::max(path.radiance.x, path.radiance.y)
+    , glm::max(path.radiance.z, path.radiance.w)
+    );
+  float window = 1.0f;
+
+  if (integratorData.russianRoulette == mt::RussianRoulette::Adjoint) {
+    window = glm::max(1.0f, integratorData.russianRouletteWindow);
+
+    float const estimate = ::IncidentRadianceEstimate(path.surface);
+    if (estimate > 0.0f && pixelEstimate > 0.0f) {
+      ratio *= estimate / pixelEstimate;
+    }
+  }
+
+  // -- terminate dim paths, surviving paths are brought up to the pixel
+  if (ratio < 1.0f/window) {
+    if (path.it < integratorData.russianRouletteDepth) { return 1ul; }
+
+    float const chance =
+      glm::clamp(ratio, integratorData.russianRouletteMinChance, 1.0f);
+
+    if (plugin.random.SampleUniform1() >= chance) { return 0ul; }
+    path.radiance /= chance;
+    return 1ul;
+  }
+
+  // -- split bright paths, each brought down to the pixel
+  if (
+      splitting
+   && integratorData.russianRoulette == mt::RussianRoulette::Adjoint
+   && ratio > window
+  ) {
+    size_t const continuations =
+      glm::clamp(
+        static_cast<size_t>(glm::ceil(ratio))
+      , 1ul, integratorData.maxSplitting
+      );
+
+    path.radiance /= static_cast<float>(continuations);
+    return continuations;
+  }
+
+  return 1ul;
+}
+
+// shades the primary hit of a pixel; sampledBsdf is the bsdf sample of the hit
+// when it was already sampled by the dispatcher
+mt::PixelInfo DispatchSurface(
+  mt::core::SurfaceInfo surface
+, mt::core::BsdfSampleInfo const * sampledBsdf
+, mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+, mt::core::IntegratorData const & integratorData
+, mt::core::AovSample & aovs
+, void (*debugPathRecorder)(mt::debugutil::IntegratorPathUnit)
+) {
+  // the hero wavelength of spectral paths, which stays 0 for RGB paths
+  mt::core::SampledWavelengths wavelengths;
+  if (integratorData.spectral) {
+    wavelengths = mt::core::SampleWavelengths(plugin.random.SampleUniform1());
+    surface.wavelength = wavelengths.lambda.x;
+
+    // a bsdf sampled ahead of the wavelength isn't dispersed by it
+    sampledBsdf = nullptr;
+  }
+
+  // return skybox
+  if (!surface.Valid()) {
+    if (scene.emissionSource.skyboxEmitterPluginIdx != -1lu) {
+      auto & emitter =
+        plugin.emitters[scene.emissionSource.skyboxEmitterPluginIdx];
+      float pdf;
+      auto const emission =
+        emitter
+          .SampleWo(scene, plugin, surface, surface.incomingAngle, pdf)
+          .color;
+      aovs.Write(::aovDirect, emission);
+      aovs.Write(::aovIndirect, glm::vec3(0.0f));
+      return mt::PixelInfo{emission, true};
+    }
+    return mt::PixelInfo{glm::vec3(1.0f, 0.0f, 1.0f), true};
+  }
+
+  // check if emitter
+  if (plugin.material.IsEmitter(surface, scene, plugin)) {
+    auto const emission = plugin.material.EmitterFs(surface, scene, plugin);
+    aovs.Write(::aovDirect, emission);
+    aovs.Write(::aovIndirect, glm::vec3(0.0f));
+    return mt::PixelInfo{emission, true};
+  }
+
+  bool hit = false;
+  glm::vec4 accumulatedIrradiance = glm::vec4(0.0f);
+
+  // irradiance accumulated by the primary hit, the rest is indirect
+  glm::vec4 directIrradiance = glm::vec4(0.0f);
+
+  bool const guidingTraining = ::GuidingTraining();
+  thread_local std::vector<::GuidingVertex> guidingVertices;
+  guidingVertices.clear();
+
+  // the incident radiance at the primary hit stands in for the pixel estimate
+  // of adjoint russian roulette; paths aren't split while their vertices are
+  // recorded for guiding or debugging, as those follow a single path
+  float const pixelEstimate = ::IncidentRadianceEstimate(surface);
+  bool const splitting = !guidingTraining && !debugPathRecorder;
+
+  thread_local std::vector<::PathState> paths;
+  paths.clear();
+  paths.emplace_back(
+    ::PathState{
+      surface
+    , integratorData.spectral
+        ? glm::vec4(1.0f) : glm::vec4(1.0f, 1.0f, 1.0f, 0.0f)
+    , 0ul
+    , wavelengths
+    }
+  );
+
+  while (!paths.empty()) {
+    auto path = std::move(paths.back());
+    paths.pop_back();
+
+    for (; path.it < integratorData.pathsPerSample; ++ path.it) {
+      PropagationStatus status =
+        Propagate(
+          scene
+        , path.surface
+        , path.wavelengths
+        , path.radiance
+        , accumulatedIrradiance
+        , path.it
+        , plugin
+        , path.it == 0ul ? sampledBsdf : nullptr
+        , guidingTraining ? &guidingVertices.emplace_back() : nullptr
+        , debugPathRecorder
+        );
+
+      if (path.it == 0ul) { directIrradiance = accumulatedIrradiance; }
+
+      if (status == PropagationStatus::IndirectAccumulationEnd) {
+        hit = true;
+        break;
+      }
+      if (status == PropagationStatus::End) { break; }
+      if (status == PropagationStatus::IndirectAccumulation) {
+        hit = true;
+      }
+      if (status == PropagationStatus::DirectAccumulation) {
+        hit = true;
+        break;
+      }
+
+      size_t const continuations =
+        ::RussianRoulette(
+          integratorData, plugin, path, pixelEstimate, splitting
+        );
+
+      if (continuations == 0ul) { break; }
+
+      for (size_t split = 1ul; split < continuations; ++ split) {
+        paths.emplace_back(
+          ::PathState{
+            path.surface, path.radiance, path.it+1ul, path.wavelengths
+          }
+        );
+      }
+    }
+
+    // store final surface info
+    if (hit && debugPathRecorder) {
+      debugPathRecorder({
+        ::Resolve(path.wavelengths, path.radiance)
+      , ::Resolve(path.wavelengths, accumulatedIrradiance)
+      , mt::TransportMode::Radiance, path.it+1, path.surface
+      });
+    }
+  }
+
+  if (guidingTraining) {
+    ::RecordGuidingVertices(guidingVertices, accumulatedIrradiance);
+  }
+
+  glm::vec3 const irradiance = ::Resolve(wavelengths, accumulatedIrradiance);
+
+  if (hit) {
+    glm::vec3 const direct = ::Resolve(wavelengths, directIrradiance);
+    aovs.Write(::aovDirect, direct);
+    aovs.Write(::aovIndirect, irradiance - direct);
+  }
+
+  return mt::PixelInfo { irradiance, hit };
+}
+
 } // -- end anon namespace
 
 extern "C" {
@@ -252,12 +721,26 @@ extern "C" {
 char const * PluginLabel() { return "forward integrator"; }
 mt::PluginType PluginType() { return mt::PluginType::Integrator; }
 
+void RegisterAovs(mt::core::IntegratorData & integratorData) {
+  ::aovDirect =
+    mt::core::RegisterAov(
+      integratorData, "direct"
+    , mt::AovType::Vec3, mt::AovAccumulation::Average
+    );
+  ::aovIndirect =
+    mt::core::RegisterAov(
+      integratorData, "indirect"
+    , mt::AovType::Vec3, mt::AovAccumulation::Average
+    );
+}
+
 mt::PixelInfo Dispatch(
   glm::vec2 const & uv
 , mt::core::Scene const & scene
 , mt::core::CameraInfo const & camera
 , mt::PluginInfo const & plugin
 , mt::core::IntegratorData const & integratorData
+, mt::core::AovSample & aovs
 , void (*debugPathRecorder)(mt::debugutil::IntegratorPathUnit)
 ) {
   mt::core::SurfaceInfo surface;
@@ -282,75 +765,97 @@ mt::PixelInfo Dispatch(
     }
 
     surface = mt::core::Raycast(scene, plugin, eye.origin, eye.direction, -1ul);
+    mt::core::PropagateRayCone(
+      surface, 0.0f
+    , mt::core::PixelSpreadAngle(camera, integratorData.imageResolution)
+    );
   }
 
-  // return skybox
-  if (!surface.Valid()) {
-    if (scene.emissionSource.skyboxEmitterPluginIdx != -1lu) {
-      auto & emitter =
-        plugin.emitters[scene.emissionSource.skyboxEmitterPluginIdx];
-      float pdf;
-      return {
-        emitter
-          .SampleWo(scene, plugin, surface, surface.incomingAngle, pdf)
-          .color
-      , true
-      };
-    }
-    return mt::PixelInfo{glm::vec3(1.0f, 0.0f, 1.0f), true};
-  }
+  return
+    ::DispatchSurface(
+      surface, nullptr, scene, plugin, integratorData, aovs, debugPathRecorder
+    );
+}
 
-  // check if emitter
-  if (plugin.material.IsEmitter(surface, scene, plugin)) {
-    auto const emission = plugin.material.EmitterFs(surface, scene, plugin);
-    return mt::PixelInfo{emission, true};
+mt::PixelInfo DispatchPrimaryHit(
+  mt::core::SurfaceInfo const & surface
+, mt::core::BsdfSampleInfo const * bsdf
+, mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+, mt::core::IntegratorData const & integratorData
+, mt::core::AovSample & aovs
+) {
+  return
+    ::DispatchSurface(
+      surface, bsdf, scene, plugin, integratorData, aovs, nullptr
+    );
+}
+
+void DispatchCycle(
+  mt::core::Scene const & scene
+, mt::PluginInfo const & /*plugin*/
+, mt::core::IntegratorData const & integratorData
+) {
+  if (!::guiding.enabled) { return; }
+
+  // a pass over the image dispatches every block once
+  size_t const passCycles =
+    glm::max(1ul, integratorData.blockPixelsFinished.size());
+
+  // -- restart training whenever the render restarts
+  if (integratorData.dispatchedCycles <= 1ul || !::guiding.tree.Valid()) {
+    sdtree::Reset(::guiding.tree, scene.bboxMin, scene.bboxMax);
+    ::guiding.iterationEndCycle = integratorData.dispatchedCycles + passCycles;
+    return;
   }
 
-  bool hit = false;
-  glm::vec3 radiance = glm::vec3(1.0f), accumulatedIrradiance = glm::vec3(0.0f);
-
-  size_t it = 0;
-  for (; it < integratorData.pathsPerSample; ++ it) {
-    PropagationStatus status =
-      Propagate(
-        scene
-      , surface
-      , radiance
-      , accumulatedIrradiance
-      , it
-      , plugin
-      , debugPathRecorder
-      );
+  if (::guiding.tree.iteration >= ::guiding.trainingIterations) { return; }
+  if (integratorData.dispatchedCycles < ::guiding.iterationEndCycle) { return; }
 
-    if (status == PropagationStatus::IndirectAccumulationEnd) {
-      hit = true;
-      break;
-    }
-    if (status == PropagationStatus::End) { break; }
-    if (status == PropagationStatus::IndirectAccumulation) {
-      hit = true;
-    }
-    if (status == PropagationStatus::DirectAccumulation) {
-      hit = true;
-      break;
-    }
+  sdtree::Refine(::guiding.tree);
+  ::guiding.iterationEndCycle += passCycles << ::guiding.tree.iteration;
+
+  spdlog::debug(
+    "path guiding iteration {}; {} spatial nodes"
+  , ::guiding.tree.iteration, ::guiding.tree.nodes.size()
+  );
+}
+
+void UiUpdate(
+  mt::core::Scene & /*scene*/
+, mt::core::RenderInfo & render
+, mt::PluginInfo const & /*plugin*/
+, mt::core::IntegratorData & /*integratorData*/
+) {
+  ImGui::Begin("forward integrator (config)");
 
-    // apply russian roulette
-    float p =
-      glm::max(0.05f, glm::max(radiance.r, glm::max(radiance.g, radiance.b)));
-    if (it >= 4 && plugin.random.SampleUniform1() > p) { break; }
-    radiance /= p; // add energy lost from terminated paths
+  if (ImGui::Checkbox("path guiding", &::guiding.enabled)) {
+    render.ClearImageBuffers();
   }
 
-  // store final surface info
-  if (hit && debugPathRecorder) {
-    debugPathRecorder({
-      radiance, accumulatedIrradiance
-    , mt::TransportMode::Radiance, it+1, surface
-    });
+  if (::guiding.enabled) {
+    if (
+      ImGui::SliderFloat(
+        "bsdf sampling fraction", &::guiding.bsdfSamplingFraction, 0.05f, 1.0f
+      )
+    ) {
+      render.ClearImageBuffers();
+    }
+
+    int iterations = static_cast<int>(::guiding.trainingIterations);
+    if (ImGui::InputInt("training iterations", &iterations)) {
+      ::guiding.trainingIterations =
+        static_cast<size_t>(glm::max(0, iterations));
+      render.ClearImageBuffers();
+    }
+
+    ImGui::Text(
+      "iteration %lu; %lu spatial nodes"
+    , ::guiding.tree.iteration, ::guiding.tree.nodes.size()
+    );
   }
 
-  return mt::PixelInfo { accumulatedIrradiance, hit };
+  ImGui::End();
 }
 
 bool RealTime() { return false; }
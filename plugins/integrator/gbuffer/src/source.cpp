@@ -0,0 +1,178 @@
+// g-buffer integrator; writes every auxiliary channel of the primary hit in a
+// single pass, one of which is displayed
+
+#include <monte-toad/core/camerainfo.hpp>
+#include <monte-toad/core/integratordata.hpp>
+#include <monte-toad/core/log.hpp>
+#include <monte-toad/core/renderinfo.hpp>
+#include <monte-toad/core/scene.hpp>
+#include <monte-toad/core/surfaceinfo.hpp>
+#include <mt-plugin/plugin.hpp>
+
+#include <imgui/imgui.hpp>
+
+#include <array>
+
+namespace {
+
+enum class Channel : size_t {
+  Albedo // albedo approximation, or the skybox
+, Normal
+, Depth  // distance to the primary hit
+, Ids    // triangle index, material index, 1 if there is a hit
+, Motion // uv motion since the previous dispatch, in [0, 1] image space
+, Size
+};
+
+std::array<char const *, static_cast<size_t>(Channel::Size)> constexpr
+  channelLabels = {{ "albedo", "normal", "depth", "ids", "motion" }};
+
+glm::vec3 Albedo(
+  mt::core::SurfaceInfo const & surface
+, mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+) {
+  if (surface.Valid())
+    { return plugin.material.AlbedoApproximation(surface, scene, plugin); }
+
+  if (scene.emissionSource.skyboxEmitterPluginIdx == -1lu)
+    { return glm::vec3(0.0f); }
+
+  float pdf;
+  return
+    plugin
+      .emitters[scene.emissionSource.skyboxEmitterPluginIdx]
+      .SampleWo(scene, plugin, surface, surface.incomingAngle, pdf)
+      .color;
+}
+
+// maps the channel to a displayable color
+glm::vec3 Display(
+  Channel const channel
+, glm::vec3 const & value
+, mt::core::Scene const & scene
+, mt::core::IntegratorData const & integratorData
+) {
+  switch (channel) {
+    default: return value;
+    case Channel::Normal: return value*0.5f + glm::vec3(0.5f);
+    case Channel::Depth:
+      return
+        glm::vec3(
+          1.0f - glm::exp(-value.x / glm::length(scene.bboxMax - scene.bboxMin))
+        );
+    case Channel::Ids: {
+      auto const t = static_cast<size_t>(value.x);
+      return
+        glm::vec3(
+          (t % 255) / 255.0f, (t % 4096) / 4096.0f, (t % 6555) / 6555.0f
+        );
+    }
+    case Channel::Motion:
+      // in pixels, so slight movement is still visible
+      return
+        glm::vec3(
+          glm::abs(glm::vec2(value))
+        * glm::vec2(integratorData.imageResolution) * 0.1f
+        , 0.0f
+        );
+  }
+}
+
+} // -- namespace
+
+extern "C" {
+
+char const * PluginLabel() { return "g-buffer integrator"; }
+mt::PluginType PluginType() { return mt::PluginType::Integrator; }
+
+size_t ChannelCount() { return static_cast<size_t>(::Channel::Size); }
+
+char const * ChannelLabel(size_t channel) {
+  return channel < ::channelLabels.size() ? ::channelLabels[channel] : "";
+}
+
+mt::PixelInfo DispatchRealtimeChannels(
+  glm::vec2 const & /*uv*/
+, mt::core::SurfaceInfo const & surface
+, mt::core::Scene const & scene
+, mt::core::CameraInfo const & camera
+, mt::core::CameraInfo const & previousCamera
+, mt::PluginInfo const & plugin
+, mt::core::IntegratorData const & integratorData
+, glm::vec3 * channels
+) {
+  auto channel = [&](::Channel c) -> glm::vec3 & {
+    return channels[static_cast<size_t>(c)];
+  };
+
+  channel(::Channel::Albedo) = ::Albedo(surface, scene, plugin);
+
+  if (surface.Valid()) {
+    channel(::Channel::Normal) = surface.normal;
+    channel(::Channel::Depth)  = glm::vec3(surface.distance);
+    channel(::Channel::Ids) =
+      glm::vec3(
+        static_cast<float>(surface.triangle.idx)
+      , static_cast<float>(surface.material)
+      , 1.0f
+      );
+
+    if (plugin.camera.WorldCoordToUv) {
+      channel(::Channel::Motion) =
+        glm::vec3(
+          plugin.camera.WorldCoordToUv(camera, surface.origin)
+        - plugin.camera.WorldCoordToUv(previousCamera, surface.origin)
+        , 0.0f
+        );
+    } else {
+      channel(::Channel::Motion) = glm::vec3(0.0f);
+    }
+  } else {
+    channel(::Channel::Normal) = glm::vec3(0.0f);
+    channel(::Channel::Depth)  = glm::vec3(0.0f);
+    channel(::Channel::Ids)    = glm::vec3(0.0f);
+    channel(::Channel::Motion) = glm::vec3(0.0f);
+  }
+
+  auto const displayed =
+    static_cast<::Channel>(
+      glm::min(integratorData.displayedChannel, ChannelCount() - 1ul)
+    );
+
+  return
+    mt::PixelInfo{
+      ::Display(displayed, channel(displayed), scene, integratorData)
+    , true
+    };
+}
+
+void UiUpdate(
+  mt::core::Scene & /*scene*/
+, mt::core::RenderInfo & /*render*/
+, mt::PluginInfo const & /*plugin*/
+, mt::core::IntegratorData & integratorData
+) {
+  ImGui::Begin("g-buffer integrator (config)");
+
+  if (
+    ImGui::BeginCombo(
+      "displayed channel", ChannelLabel(integratorData.displayedChannel)
+    )
+  ) {
+    for (size_t channel = 0ul; channel < ChannelCount(); ++ channel) {
+      bool const isSelected = integratorData.displayedChannel == channel;
+      if (ImGui::Selectable(ChannelLabel(channel), isSelected)) {
+        integratorData.displayedChannel = channel;
+        mt::core::Clear(integratorData);
+      }
+    }
+    ImGui::EndCombo();
+  }
+
+  ImGui::End();
+}
+
+bool RealTime() { return true; }
+
+} // end extern "C"
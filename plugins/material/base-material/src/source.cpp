@@ -1,9 +1,11 @@
 #include <monte-toad/core/any.hpp>
+#include <monte-toad/core/bsdfbatch.hpp>
 #include <monte-toad/core/integratordata.hpp>
 #include <monte-toad/core/log.hpp>
 #include <monte-toad/core/math.hpp>
 #include <monte-toad/core/renderinfo.hpp>
 #include <monte-toad/core/scene.hpp>
+#include <monte-toad/core/span.hpp>
 #include <monte-toad/core/spectrum.hpp>
 #include <monte-toad/core/surfaceinfo.hpp>
 #include <monte-toad/core/texture.hpp>
@@ -12,6 +14,8 @@
 
 #include <imgui/imgui.hpp>
 
+#include <algorithm>
+#include <array>
 #include <vector>
 
 namespace {
@@ -28,6 +32,7 @@ struct Material {
   std::vector<MaterialComponent> diffuse, specular, refractive;
   mt::core::TextureOption<float>
     indexOfRefraction { "index of refraction (IOR)", 1.0f, 5.0f, 1.0f }
+  , abbeNumber { "dispersion (Abbe number)", 0.0f, 100.0f, 0.0f }
   , fresnelMinimalReflection {
       "fresnel minimal reflection (F0)", 0.0f, 1.0f, 0.0f, 2.2f
     }
@@ -59,38 +64,378 @@ float FresnelReflectAmount(
   return glm::mix(f0, f90, r0 + (1.0f-r0)*x*x*x*x*x);
 }
 
+// -- compiled materials; materials are edited as above, but are flattened
+//    into compact records after every edit, which the exported functions
+//    evaluate instead. So a bounce neither walks the components of a material
+//    nor looks up the plugins of its bsdfs
+
+// a scalar of the material, either constant or read from a texture
+struct CompiledScalar {
+  float value = 0.0f;
+  mt::core::Texture const * texture = nullptr;
+  float minRange = 0.0f, maxRange = 1.0f;
+
+  float Get(mt::core::SurfaceInfo const & surface) const {
+    if (!this->texture) { return this->value; }
+    return
+      glm::mix(
+        this->minRange, this->maxRange
+      , mt::core::Sample(
+          *this->texture, surface.uvcoord, surface.uvFootprint
+        ).r
+      );
+  }
+};
+
+// a bsdf component of the material, its plugin is called directly
+struct CompiledLobe {
+  // normalized probability of the component within its category, & the
+  // cumulative probability up to & including the component
+  float probability = 0.0f, cdf = 0.0f;
+
+  mt::core::Any const * userdata = nullptr;
+  decltype(mt::PluginInfoBsdf::BsdfSample) sample = nullptr;
+  decltype(mt::PluginInfoBsdf::BsdfSampleBatch) sampleBatch = nullptr;
+  decltype(mt::PluginInfoBsdf::BsdfPdf) pdf = nullptr;
+  decltype(mt::PluginInfoBsdf::BsdfFs) fs = nullptr;
+  decltype(mt::PluginInfoBsdf::AlbedoApproximation) albedo = nullptr;
+};
+
+enum class LobeCategory : size_t { Diffuse, Specular, Refractive, Size };
+
+struct CompiledMaterial {
+  ::CompiledScalar indexOfRefraction, abbeNumber, fresnelMinimalReflection;
+
+  // the lobes of a category are [lobeOffset[category], lobeOffset[category+1])
+  // of the lobes, the emitter lobe is -1 if the material doesn't emit
+  ::CompiledLobe const * lobes = nullptr;
+  std::array<uint32_t, static_cast<size_t>(LobeCategory::Size) + 1ul>
+    lobeOffset = {{ 0u, 0u, 0u, 0u }};
+  uint32_t emitterLobe = static_cast<uint32_t>(-1);
+
+  ::CompiledLobe const * Begin(::LobeCategory const category) const {
+    return this->lobes + this->lobeOffset[static_cast<size_t>(category)];
+  }
+
+  ::CompiledLobe const * End(::LobeCategory const category) const {
+    return this->lobes + this->lobeOffset[static_cast<size_t>(category) + 1ul];
+  }
+
+  bool Empty(::LobeCategory const category) const {
+    return this->Begin(category) == this->End(category);
+  }
+
+  bool Emitter() const {
+    return this->emitterLobe != static_cast<uint32_t>(-1);
+  }
+};
+
+// stored in the scene, indexed by the material of a surface
+struct CompiledMaterials {
+  std::vector<::CompiledMaterial> materials;
+  std::vector<::CompiledLobe> lobes;
+};
+
+void DeallocateCompiled(void * data) {
+  delete reinterpret_cast<::CompiledMaterials*>(data);
+}
+
+::CompiledMaterial const & Compiled(
+  mt::core::Scene const & scene
+, mt::core::SurfaceInfo const & surface
+) {
+  return
+    reinterpret_cast<::CompiledMaterials const *>(
+      scene.compiledMaterials.data
+    )->materials[surface.material];
+}
+
+::CompiledScalar CompileScalar(mt::core::TextureOption<float> const & option) {
+  ::CompiledScalar scalar;
+  scalar.value = option.userValue;
+  scalar.texture = option.userTexture;
+  scalar.minRange = option.minRange;
+  scalar.maxRange = option.maxRange;
+  return scalar;
+}
+
+void CompileLobe(
+  ::MaterialComponent const & component
+, float const probability
+, float const cdf
+, mt::PluginInfo const & plugin
+, std::vector<::CompiledLobe> & lobes
+) {
+  auto const & bsdf = plugin.bsdfs[component.pluginIdx];
+
+  auto & lobe = lobes.emplace_back();
+  lobe.probability = probability;
+  lobe.cdf = cdf;
+  lobe.userdata = &component.userdata;
+  lobe.sample = bsdf.BsdfSample;
+  lobe.sampleBatch = bsdf.BsdfSampleBatch;
+  lobe.pdf = bsdf.BsdfPdf;
+  lobe.fs = bsdf.BsdfFs;
+  lobe.albedo = bsdf.AlbedoApproximation;
+}
+
+// compiles the components of a category, their probabilities are normalized as
+// they aren't normalized until edited
+void CompileLobes(
+  std::vector<::MaterialComponent> const & components
+, mt::PluginInfo const & plugin
+, std::vector<::CompiledLobe> & lobes
+) {
+  float total = 0.0f;
+  for (auto const & component : components) {
+    if (component.pluginIdx >= plugin.bsdfs.size()) { continue; }
+    total += glm::max(0.0f, component.probability);
+  }
+
+  float cdf = 0.0f;
+  for (auto const & component : components) {
+    if (component.pluginIdx >= plugin.bsdfs.size()) { continue; }
+
+    float const probability =
+      total > 0.0f ? glm::max(0.0f, component.probability) / total : 0.0f;
+    cdf += probability;
+
+    ::CompileLobe(component, probability, cdf, plugin, lobes);
+  }
+}
+
+// index of refraction at the hero wavelength of the surface, which only varies
+// if the material has dispersion & the path is spectral
+float IndexOfRefraction(
+  ::CompiledMaterial const & material
+, mt::core::SurfaceInfo const & surface
+) {
+  return
+    mt::core::DispersiveIndexOfRefraction(
+      material.indexOfRefraction.Get(surface)
+    , material.abbeNumber.Get(surface)
+    , surface.wavelength
+    );
+}
+
+// probabilities of Sample choosing the specular, transmittive or diffuse
+// components of a material
+struct ComponentChance {
+  float specular = 0.0f, transmission = 0.0f, diffuse = 0.0f;
+};
 
-mt::core::BsdfSampleInfo SampleMaterial(
-  std::vector<MaterialComponent> const & component
+ComponentChance ComputeComponentChance(
+  ::CompiledMaterial const & material
+, float const indexOfRefraction
+, mt::core::SurfaceInfo const & surface
+) {
+  ComponentChance chance;
+
+  float const fresnelMinimalReflection =
+    material.fresnelMinimalReflection.Get(surface);
+  chance.specular = fresnelMinimalReflection;
+  chance.transmission = 1.0f - fresnelMinimalReflection;
+
+  if (chance.specular > 0.0f) {
+    chance.specular =
+      ::FresnelReflectAmount(
+        surface.exitting ? indexOfRefraction : 1.0f
+      , surface.exitting ? 1.0f : indexOfRefraction
+      , fresnelMinimalReflection, 1.0f
+      , surface.normal, -surface.incomingAngle
+      );
+  }
+
+  if (chance.transmission > 0.0f) {
+    chance.transmission = 1.0f - chance.specular;
+  }
+
+  if (material.Empty(::LobeCategory::Specular)) { chance.specular = 0.0f; }
+  if (material.Empty(::LobeCategory::Refractive))
+    { chance.transmission = 0.0f; }
+
+  chance.diffuse =
+    glm::max(0.0f, 1.0f - chance.specular - chance.transmission);
+
+  return chance;
+}
+
+// evaluates either the pdf or fs of the non delta-dirac components of the
+// material, the diffuse & specular components are only evaluated when wo is
+// reflected & the transmittive components only when wo is transmitted. Delta
+// dirac components (such as perfect specular) evaluate to 0, but glossy ones
+// (such as microfacets) don't
+template <typename T, typename Fn> T EvaluateComponents(
+  ::CompiledMaterial const & material
+, mt::core::SurfaceInfo const & surface
+, glm::vec3 const & wo
+, Fn && evaluate
+) {
+  float const ior = ::IndexOfRefraction(material, surface);
+  auto const chance = ::ComputeComponentChance(material, ior, surface);
+
+  bool const reflection = glm::dot(wo, surface.normal) > 0.0f;
+
+  T result = T(0.0f);
+  auto const evaluateCategory =
+    [&](::LobeCategory const category, float const componentChance) {
+      if (componentChance <= 0.0f) { return; }
+
+      for (
+        auto const * lobe = material.Begin(category);
+        lobe != material.End(category);
+        ++ lobe
+      ) {
+        result += componentChance * lobe->probability * evaluate(*lobe, ior);
+      }
+    };
+
+  if (reflection) {
+    evaluateCategory(::LobeCategory::Diffuse, chance.diffuse);
+    evaluateCategory(::LobeCategory::Specular, chance.specular);
+  } else {
+    evaluateCategory(::LobeCategory::Refractive, chance.transmission);
+  }
+
+  return result;
+}
+
+// chooses the category to sample by the fresnel chance of the surface
+::LobeCategory ChooseCategory(
+  ::CompiledMaterial const & material
 , float const indexOfRefraction
 , mt::core::SurfaceInfo const & surface
 , mt::PluginInfo const & plugin
 ) {
-  // choose probability, don't sample a uniform if there's only one brdf
-  float const probability =
-    component.size() <= 1 ? 0.0f : plugin.random.SampleUniform1()
+  auto const chance =
+    ::ComputeComponentChance(material, indexOfRefraction, surface);
+  float const
+    specularChance = chance.specular
+  , transmissionChance = chance.transmission
   ;
 
-  // locate the corresponding material and calculate results
-  float probabilityIt = 0.0f;
-  for (size_t i = 0; i < component.size(); ++i) {
-    probabilityIt += component[i].probability;
+  float const fresnelProbability = plugin.random.SampleUniform1();
+  if (specularChance > 0.0f && specularChance > fresnelProbability)
+    { return ::LobeCategory::Specular; }
+  if (
+      transmissionChance > 0.0f
+   && transmissionChance + specularChance > fresnelProbability
+  )
+    { return ::LobeCategory::Refractive; }
+  return ::LobeCategory::Diffuse;
+}
+
+// chooses a lobe of the category by its cumulative probability, nullptr if the
+// category has no lobes
+::CompiledLobe const * ChooseLobe(
+  ::CompiledMaterial const & material
+, ::LobeCategory const category
+, mt::PluginInfo const & plugin
+) {
+  auto const * begin = material.Begin(category);
+  auto const * end = material.End(category);
+
+  if (begin == end) { return nullptr; }
+
+  // don't sample a uniform if there's only one lobe, the last lobe is chosen
+  // if rounding left its cdf below the uniform
+  auto const * lobe = begin;
+  if (end - begin > 1) {
+    float const u = plugin.random.SampleUniform1();
+    lobe =
+      std::upper_bound(
+        begin, end - 1, u
+      , [](float const value, ::CompiledLobe const & l) {
+          return value < l.cdf;
+        }
+      );
+  }
+
+  return lobe;
+}
+
+// the fresnel chance & refracted direction depend on the wavelength when the
+// material has dispersion
+bool Dispersive(
+  ::CompiledMaterial const & material
+, ::LobeCategory const category
+, mt::core::SurfaceInfo const & surface
+) {
+  return
+      category != ::LobeCategory::Diffuse
+   && surface.wavelength > 0.0f
+   && material.abbeNumber.Get(surface) > 0.0f;
+}
 
-    auto & bsdf = component[i];
+bool EmptyMaterial(::CompiledMaterial const & material) {
+  return
+      material.Empty(::LobeCategory::Specular)
+   && material.Empty(::LobeCategory::Refractive)
+   && material.Empty(::LobeCategory::Diffuse);
+}
 
-    // probability found now just return the plugin's brdf sample
-    if (probabilityIt >= probability) {
-      return
-        plugin.bsdfs[bsdf.pluginIdx].BsdfSample(
-            bsdf.userdata, indexOfRefraction, plugin.random, surface
-        );
+// samples every surface that chose the lobe, in a single batch if the bsdf
+// supports it
+void SampleLobeBatch(
+  ::CompiledLobe const & lobe
+, span<mt::core::SurfaceInfo const> surfaces
+, std::vector<size_t> const & indices
+, std::vector<float> const & iors
+, mt::PluginInfo const & plugin
+, span<mt::core::BsdfSampleInfo> samples
+) {
+  if (!lobe.sampleBatch) {
+    for (size_t const idx : indices) {
+      samples[idx] =
+        lobe.sample(*lobe.userdata, iors[idx], plugin.random, surfaces[idx]);
     }
+    return;
   }
 
-  return mt::core::BsdfSampleInfo{};
+  thread_local mt::core::SurfaceBatchStorage surfaceBatch;
+  thread_local mt::core::BsdfBatchStorage bsdfBatch;
+
+  surfaceBatch.Clear();
+  for (size_t const idx : indices)
+    { surfaceBatch.Push(surfaces[idx], iors[idx]); }
+  bsdfBatch.Resize(indices.size());
+
+  auto bsdfView = bsdfBatch.View();
+  lobe.sampleBatch(
+    *lobe.userdata, plugin.random, surfaceBatch.View(), bsdfView
+  );
+
+  for (size_t it = 0ul; it < indices.size(); ++ it) {
+    auto & sample = samples[indices[it]];
+    sample.wo = bsdfBatch.wo[it];
+    sample.fs = bsdfBatch.fs[it];
+    sample.pdf = bsdfBatch.pdf[it];
+  }
 }
 
-void UiMaterialComponent(
+// sums the albedo approximation of the lobes of the category
+glm::vec3 LobesAlbedo(
+  ::CompiledMaterial const & material
+, ::LobeCategory const category
+, float const indexOfRefraction
+, mt::core::SurfaceInfo const & surface
+) {
+  glm::vec3 albedo = glm::vec3(0.0f);
+  for (
+    auto const * lobe = material.Begin(category);
+    lobe != material.End(category);
+    ++ lobe
+  ) {
+    albedo +=
+      lobe->probability
+    * lobe->albedo(*lobe->userdata, indexOfRefraction, surface);
+  }
+  return albedo;
+}
+
+// returns if the components changed, which requires the materials to be
+// compiled again
+bool UiMaterialComponent(
   std::vector<MaterialComponent> & components
 , mt::BsdfTypeHint const bsdfType
 , std::string const & guiLabel
@@ -100,6 +445,8 @@ void UiMaterialComponent(
 ) {
   ImGui::Text("%s", guiLabel.c_str());
 
+  bool edited = false;
+
   for (size_t bsdfIdx = 0; bsdfIdx < components.size(); ++ bsdfIdx) {
     auto & bsdf = components[bsdfIdx];
     auto & materialPlugin = plugin.bsdfs[bsdf.pluginIdx];
@@ -108,6 +455,7 @@ void UiMaterialComponent(
     ImGui::Text("%s", materialPlugin.PluginLabel());
     if (ImGui::SliderFloat("%", &bsdf.probability, 0.0f, 1.0f)) {
       render.ClearImageBuffers();
+      edited = true;
 
       // normalize bsdf probabilities
       float total = 0.0f;
@@ -122,6 +470,7 @@ void UiMaterialComponent(
     if (ImGui::Button("delete")) {
       components.erase(components.begin() + bsdfIdx);
       render.ClearImageBuffers();
+      edited = true;
       -- bsdfIdx;
     }
 
@@ -153,11 +502,14 @@ void UiMaterialComponent(
         components.emplace_back(std::move(component));
 
         render.ClearImageBuffers();
+        edited = true;
       }
     }
 
     ImGui::EndCombo();
   }
+
+  return edited;
 }
 
 void Deallocate(void * data) {
@@ -177,17 +529,56 @@ void Allocate(mt::core::Any & userdata) {
   userdata.dealloc = ::Deallocate;
 }
 
+void Compile(mt::core::Scene & scene, mt::PluginInfo const & plugin) {
+  if (!scene.compiledMaterials.data) {
+    scene.compiledMaterials.data = new ::CompiledMaterials{};
+    scene.compiledMaterials.dealloc = ::DeallocateCompiled;
+  }
+
+  auto & compiled =
+    *reinterpret_cast<::CompiledMaterials*>(scene.compiledMaterials.data);
+  compiled.materials.clear();
+  compiled.lobes.clear();
+
+  for (auto const & mesh : scene.meshes) {
+    auto const & material =
+      *reinterpret_cast<::Material const *>(mesh.material.data);
+
+    auto & output = compiled.materials.emplace_back();
+    output.indexOfRefraction = ::CompileScalar(material.indexOfRefraction);
+    output.abbeNumber = ::CompileScalar(material.abbeNumber);
+    output.fresnelMinimalReflection =
+      ::CompileScalar(material.fresnelMinimalReflection);
+
+    auto const lobeCount = [&]() {
+      return static_cast<uint32_t>(compiled.lobes.size());
+    };
+
+    output.lobeOffset[0] = lobeCount();
+    ::CompileLobes(material.diffuse, plugin, compiled.lobes);
+    output.lobeOffset[1] = lobeCount();
+    ::CompileLobes(material.specular, plugin, compiled.lobes);
+    output.lobeOffset[2] = lobeCount();
+    ::CompileLobes(material.refractive, plugin, compiled.lobes);
+    output.lobeOffset[3] = lobeCount();
+
+    if (material.emitter.pluginIdx < plugin.bsdfs.size()) {
+      output.emitterLobe = lobeCount();
+      ::CompileLobe(material.emitter, 1.0f, 1.0f, plugin, compiled.lobes);
+    }
+  }
+
+  // the lobes are only referenced once they won't be reallocated
+  for (auto & material : compiled.materials)
+    { material.lobes = compiled.lobes.data(); }
+}
+
 bool IsEmitter(
   mt::core::SurfaceInfo const & surface
 , mt::core::Scene const & scene
 , mt::PluginInfo const & /*plugin*/
 ) {
-  auto const & material =
-    *reinterpret_cast<::Material*>(
-      scene.meshes[surface.material].material.data
-    );
-
-  return material.emitter.pluginIdx != -1lu;
+  return ::Compiled(scene, surface).Emitter();
 }
 
 mt::core::BsdfSampleInfo Sample(
@@ -195,64 +586,73 @@ mt::core::BsdfSampleInfo Sample(
 , mt::core::Scene const & scene
 , mt::PluginInfo const & plugin
 ) {
-  auto const & material =
-    *reinterpret_cast<::Material*>(
-      scene.meshes[surface.material].material.data
-    );
-  float const ior = material.indexOfRefraction.Get(surface.uvcoord);
+  auto const & material = ::Compiled(scene, surface);
+  float const ior = ::IndexOfRefraction(material, surface);
 
-  if (
-      material.specular.size() == 0ul
-   && material.refractive.size() == 0ul
-   && material.diffuse.size() == 0ul
-  ) { return mt::core::BsdfSampleInfo{}; }
+  if (::EmptyMaterial(material)) { return mt::core::BsdfSampleInfo{}; }
 
-  mt::BsdfTypeHint sampleType = mt::BsdfTypeHint::Transmittive;
-  float const fresnelMinimalReflection =
-    material.fresnelMinimalReflection.Get(surface.uvcoord);
-  float specularChance = fresnelMinimalReflection;
-  float transmissionChance = 1.0f - fresnelMinimalReflection;
+  auto const category = ::ChooseCategory(material, ior, surface, plugin);
+  auto const * lobe = ::ChooseLobe(material, category, plugin);
+  if (!lobe) { return mt::core::BsdfSampleInfo{}; }
 
-  if (specularChance > 0.0f) {
-    specularChance =
-      ::FresnelReflectAmount(
-        surface.exitting ? ior : 1.0f
-      , surface.exitting ? 1.0f : ior
-      , fresnelMinimalReflection, 1.0f
-      , surface.normal, -surface.incomingAngle
-      );
+  auto sample = lobe->sample(*lobe->userdata, ior, plugin.random, surface);
+  sample.dispersive = ::Dispersive(material, category, surface);
+
+  return sample;
+}
+
+void SampleBatch(
+  span<mt::core::SurfaceInfo const> surfaces
+, mt::core::Scene const & scene
+, mt::PluginInfo const & plugin
+, span<mt::core::BsdfSampleInfo> samples
+) {
+  if (surfaces.empty()) { return; }
+
+  auto const & material = ::Compiled(scene, surfaces[0]);
+
+  if (::EmptyMaterial(material)) {
+    for (auto & sample : samples) { sample = mt::core::BsdfSampleInfo{}; }
+    return;
   }
 
-  if (transmissionChance > 0.0f) {
-    transmissionChance = 1.0f - specularChance;
+  // choose the lobe of every surface first, so each lobe samples all of its
+  // surfaces at once
+  thread_local std::vector<float> iors;
+  thread_local std::vector<::LobeCategory> categories;
+  thread_local std::vector<::CompiledLobe const *> chosenLobes;
+  iors.resize(surfaces.size());
+  categories.resize(surfaces.size());
+  chosenLobes.resize(surfaces.size());
+
+  for (size_t idx = 0ul; idx < surfaces.size(); ++ idx) {
+    iors[idx] = ::IndexOfRefraction(material, surfaces[idx]);
+    categories[idx] =
+      ::ChooseCategory(material, iors[idx], surfaces[idx], plugin);
+    chosenLobes[idx] = ::ChooseLobe(material, categories[idx], plugin);
+    samples[idx] = mt::core::BsdfSampleInfo{};
   }
 
-  if (material.specular.size() == 0ul) { specularChance = 0.0f; }
-  if (material.refractive.size() == 0ul) { transmissionChance = 0.0f; }
+  thread_local std::vector<size_t> indices;
+  for (
+    auto const * lobe = material.Begin(::LobeCategory::Diffuse);
+    lobe != material.End(::LobeCategory::Refractive);
+    ++ lobe
+  ) {
+    indices.clear();
+    for (size_t idx = 0ul; idx < surfaces.size(); ++ idx) {
+      if (chosenLobes[idx] == lobe) { indices.emplace_back(idx); }
+    }
+
+    if (indices.empty()) { continue; }
 
-  float const fresnelProbability = plugin.random.SampleUniform1();
-  if (specularChance > 0.0f && specularChance > fresnelProbability)
-    { sampleType = mt::BsdfTypeHint::Specular; }
-  else if (
-      transmissionChance > 0.0f
-   && transmissionChance + specularChance > fresnelProbability
-  )
-    { sampleType = mt::BsdfTypeHint::Transmittive; }
-  else
-    { sampleType = mt::BsdfTypeHint::Diffuse; }
-
-  switch (sampleType) {
-    default: break;
-    case mt::BsdfTypeHint::Specular:
-      return ::SampleMaterial(material.specular, ior, surface, plugin);
-    case mt::BsdfTypeHint::Diffuse:
-      return ::SampleMaterial(material.diffuse, ior, surface, plugin);
-    case mt::BsdfTypeHint::Transmittive:
-      return ::SampleMaterial(material.refractive, ior, surface, plugin);
-  }
-
-  assert(0);
-  return mt::core::BsdfSampleInfo{};
+    ::SampleLobeBatch(*lobe, surfaces, indices, iors, plugin, samples);
+  }
+
+  for (size_t idx = 0ul; idx < surfaces.size(); ++ idx) {
+    samples[idx].dispersive =
+      ::Dispersive(material, categories[idx], surfaces[idx]);
+  }
 }
 
 float Pdf(
@@ -286,93 +686,64 @@ float Pdf(
 glm::vec3 EmitterFs(
   mt::core::SurfaceInfo const & surface
 , mt::core::Scene const & scene
-, mt::PluginInfo const & plugin
+, mt::PluginInfo const & /*plugin*/
 ) {
-  auto const & material =
-    *reinterpret_cast<::Material*>(
-      scene.meshes[surface.material].material.data
-    );
-  auto & bsdf = material.emitter;
+  auto const & material = ::Compiled(scene, surface);
+  auto const & lobe = material.lobes[material.emitterLobe];
   return
-    plugin
-      .bsdfs[bsdf.pluginIdx]
-      .BsdfFs(
-        bsdf.userdata, material.indexOfRefraction.Get(surface.uvcoord)
-      , surface, glm::vec3(0.0f)
-      );
+    lobe.fs(
+      *lobe.userdata, material.indexOfRefraction.Get(surface)
+    , surface, glm::vec3(0.0f)
+    );
 }
 
 glm::vec3 BsdfFs(
-  mt::core::SurfaceInfo const & /*surface*/
-, mt::core::Scene const & /*scene*/
+  mt::core::SurfaceInfo const & surface
+, mt::core::Scene const & scene
 , mt::PluginInfo const & /*plugin*/
-, glm::vec3 const & /*wo*/
+, glm::vec3 const & wo
 ) {
-  return glm::vec3(0.0f);
-  /* auto & material = */
-  /*     reflection */
-  /*   ? scene.meshes[surface.material].material.reflection[componentIdx] */
-  /*   : scene.meshes[surface.material].material.refraction[componentIdx] */
-  /* ; */
-
-  /* return plugin.material.BsdfFs(material.userdata, surface, wo); */
+  // delta-dirac components (pdf of 0) can't be evaluated for an arbitrary wo,
+  // so they are skipped; this keeps BsdfFs consistent with IndirectPdf
+  return
+    ::EvaluateComponents<glm::vec3>(
+      ::Compiled(scene, surface), surface, wo
+    , [&](::CompiledLobe const & lobe, float const ior) {
+        if (lobe.pdf(*lobe.userdata, ior, surface, wo) <= 0.0f)
+          { return glm::vec3(0.0f); }
+        return lobe.fs(*lobe.userdata, ior, surface, wo);
+      }
+    );
 }
 
 glm::vec3 AlbedoApproximation(
   mt::core::SurfaceInfo const & surface
 , mt::core::Scene const & scene
-, mt::PluginInfo const & plugin
+, mt::PluginInfo const & /*plugin*/
 ) {
-  auto const & material =
-    *reinterpret_cast<::Material*>(
-      scene.meshes[surface.material].material.data
-    );
-  auto fresnelMin = material.fresnelMinimalReflection.Get(surface.uvcoord);
-  auto ior = material.indexOfRefraction.Get(surface.uvcoord);
+  auto const & material = ::Compiled(scene, surface);
+  auto fresnelMin = material.fresnelMinimalReflection.Get(surface);
+  auto ior = ::IndexOfRefraction(material, surface);
   bool const hasSpecular =
-      material.specular.size() > 0ul
+      !material.Empty(::LobeCategory::Specular)
    && fresnelMin >= 0.01f
   ;
 
-  bool const hasDiffuse = material.diffuse.size();
+  bool const hasDiffuse = !material.Empty(::LobeCategory::Diffuse);
 
   bool const hasRefractive =
-      material.refractive.size() > 0ul
-   && material.fresnelMinimalReflection.Get(surface.uvcoord) <= 0.99f
+      !material.Empty(::LobeCategory::Refractive)
+   && fresnelMin <= 0.99f
   ;
 
   // TODO if specular or refractive then want to probably take a first-attempt
   // guess via raycast
 
-  // get diffuse
-  glm::vec3 diff = glm::vec3(0.0f);
-  for (auto & bsdf : material.diffuse) {
-    diff +=
-        bsdf.probability
-      * plugin
-          .bsdfs[bsdf.pluginIdx]
-          .AlbedoApproximation(bsdf.userdata, ior, surface);
-  }
-
-  // get refraction
-  glm::vec3 refr = glm::vec3(0.0f);
-  for (auto & bsdf : material.refractive) {
-    refr +=
-        bsdf.probability
-      * plugin
-          .bsdfs[bsdf.pluginIdx]
-          .AlbedoApproximation(bsdf.userdata, ior, surface);
-  }
-
-  // get specular
-  glm::vec3 spec = glm::vec3(0.0f);
-  for (auto & bsdf : material.specular) {
-    spec +=
-        bsdf.probability
-      * plugin
-          .bsdfs[bsdf.pluginIdx]
-          .AlbedoApproximation(bsdf.userdata, ior, surface);
-  }
+  glm::vec3 const
+    diff = ::LobesAlbedo(material, ::LobeCategory::Diffuse, ior, surface)
+  , refr = ::LobesAlbedo(material, ::LobeCategory::Refractive, ior, surface)
+  , spec = ::LobesAlbedo(material, ::LobeCategory::Specular, ior, surface)
+  ;
 
   if (!hasRefractive && !hasSpecular) { return diff; }
   if (!hasDiffuse && hasSpecular) { return spec; }
@@ -390,34 +761,18 @@ glm::vec3 AlbedoApproximation(
 float IndirectPdf(
   mt::core::SurfaceInfo const & surface
 , mt::core::Scene const & scene
-, mt::PluginInfo const & plugin
+, mt::PluginInfo const & /*plugin*/
 , glm::vec3 const & wo
 ) {
-  // i think for this all PDFs have to be calculated and combined dependent on
-  // their probability
-  float pdf = 0.0f;
-
-  bool reflection = glm::dot(surface.incomingAngle, surface.normal) > 0.0f;
-
-  auto const & material =
-    *reinterpret_cast<::Material*>(
-      scene.meshes[surface.material].material.data
+  // combined pdf of Sample generating wo, weighted by the probability of
+  // choosing each component
+  return
+    ::EvaluateComponents<float>(
+      ::Compiled(scene, surface), surface, wo
+    , [&](::CompiledLobe const & lobe, float const ior) {
+        return lobe.pdf(*lobe.userdata, ior, surface, wo);
+      }
     );
-
-  auto const & bsdfs = reflection ? material.diffuse : material.refractive;
-
-  for (auto const & bsdf : bsdfs) {
-    pdf +=
-      bsdf.probability
-    * plugin.bsdfs[bsdf.pluginIdx]
-        .BsdfPdf(
-          bsdf.userdata, material.indexOfRefraction.Get(surface.uvcoord)
-        , surface, wo
-        )
-    ;
-  }
-
-  return pdf;
 }
 
 void UiUpdate(
@@ -486,37 +841,47 @@ void UiUpdate(
   auto & material =
     *reinterpret_cast<::Material*>(scene.meshes[currentMtlIdx].material.data);
 
+  // materials are compiled again once they're edited, before the emission
+  // source is updated as it evaluates the compiled materials
+  bool edited = false, emittersEdited = false;
+
   if (material.indexOfRefraction.GuiApply(scene))
-    { render.ClearImageBuffers(); }
+    { render.ClearImageBuffers(); edited = true; }
+
+  if (material.abbeNumber.GuiApply(scene))
+    { render.ClearImageBuffers(); edited = true; }
 
   ImGui::Separator();
 
   if (material.fresnelMinimalReflection.GuiApply(scene))
-    { render.ClearImageBuffers(); }
+    { render.ClearImageBuffers(); edited = true; }
 
   ImGui::Separator();
   ImGui::Separator();
 
-  ::UiMaterialComponent(
-    material.diffuse, mt::BsdfTypeHint::Diffuse, "diffuse"
-  , scene, render, plugin
-  );
+  edited |=
+    ::UiMaterialComponent(
+      material.diffuse, mt::BsdfTypeHint::Diffuse, "diffuse"
+    , scene, render, plugin
+    );
 
   ImGui::Separator();
   ImGui::Separator();
 
-  ::UiMaterialComponent(
-    material.specular, mt::BsdfTypeHint::Specular, "specular"
-  , scene, render, plugin
-  );
+  edited |=
+    ::UiMaterialComponent(
+      material.specular, mt::BsdfTypeHint::Specular, "specular"
+    , scene, render, plugin
+    );
 
   ImGui::Separator();
   ImGui::Separator();
 
-  ::UiMaterialComponent(
-    material.refractive, mt::BsdfTypeHint::Transmittive, "transmittive"
-  , scene, render, plugin
-  );
+  edited |=
+    ::UiMaterialComponent(
+      material.refractive, mt::BsdfTypeHint::Transmittive, "transmittive"
+    , scene, render, plugin
+    );
 
   ImGui::Separator();
   ImGui::Separator();
@@ -533,6 +898,7 @@ void UiUpdate(
         plugin.bsdfs[i].Allocate(component.userdata);
         material.emitter = std::move(component);
 
+        edited = emittersEdited = true;
         render.ClearImageBuffers();
       }
     }
@@ -543,6 +909,7 @@ void UiUpdate(
   if (material.emitter.pluginIdx != -1lu) {
     if (ImGui::Button("delete")) {
       material.emitter.pluginIdx = -1lu;
+      edited = emittersEdited = true;
       render.ClearImageBuffers();
       // TODO can't delete bc don't know type
     }
@@ -550,7 +917,12 @@ void UiUpdate(
 
   if (material.emitter.pluginIdx != -1lu) {
     auto & materialPlugin = plugin.bsdfs[material.emitter.pluginIdx];
+    ImGui::BeginGroup();
     materialPlugin.UiUpdate(material.emitter.userdata, render, scene);
+    ImGui::EndGroup();
+
+    // emitted power weighs the sampling of emissive triangles
+    if (ImGui::IsItemEdited()) { emittersEdited = true; }
   }
 
   // -- sanity checks for material, would be better if uimaterialcomponent
@@ -559,18 +931,25 @@ void UiUpdate(
       material.diffuse.size() == 0
    && material.refractive.size() == 0
    && material.specular.size() > 0
+   && material.fresnelMinimalReflection.userValue != 1.0f
   ) {
     material.fresnelMinimalReflection.userValue = 1.0f;
+    edited = true;
   }
 
   if (
       material.diffuse.size() == 0
    && material.specular.size() == 0
    && material.refractive.size() > 0
+   && material.fresnelMinimalReflection.userValue != 0.0f
   ) {
     material.fresnelMinimalReflection.userValue = 0.0f;
+    edited = true;
   }
 
+  if (edited) { Compile(scene, plugin); }
+  if (emittersEdited) { mt::core::UpdateEmissionSource(scene, plugin); }
+
   ImGui::End();
 }
 
@@ -1,5 +1,6 @@
 // base ui
 
+#include <monte-toad/core/aov.hpp>
 #include <monte-toad/core/enum.hpp>
 #include <monte-toad/core/integratordata.hpp>
 #include <monte-toad/core/kerneldispatchinfo.hpp>
@@ -17,6 +18,7 @@
 #include <imgui/imgui.hpp>
 
 #include <chrono>
+#include <vector>
 
 namespace ImGui {
   bool InputInt(const char * label, size_t * value, int step = 1) {
@@ -227,24 +229,52 @@ void ApplyImageResolutionConstraint(
 }
 
 void UiTextureEditor(mt::core::Scene & scene) {
+  // textures are decoded in the background, & only added to the scene once
+  // they're done; materials keep their values until a texture is picked
+  static std::vector<mt::util::TextureLoad> loads;
+  static size_t loadsQueued = 0ul;
+
   ImGui::Begin("Textures");
 
   if (ImGui::Button("Load Texture")) {
     auto files =
       mt::util::FilePickerMultiple(
           " --file-filter=\"image files | "
-          " *.jpeg *.jpg *.png *.tga *.bmp *.psd *.gif *.hdr *.pic *.ppm"
-          " *.pgm\""
+          " *.jpeg *.jpg *.png *.tga *.bmp *.psd *.gif *.hdr *.exr *.pic"
+          " *.ppm *.pgm\""
           );
     for (auto const & filename : files) {
-      auto texture = mt::util::LoadTexture(filename);
-      if (texture.Valid()) {
-        texture.label = filename;
-        scene.textures.emplace_back(texture);
-      } else {
-        spdlog::error("Could not load texture '{}'", filename);
-      }
+      loads.emplace_back(
+        mt::util::LoadTextureAsync(filename, scene.textureTileCache)
+      );
+    }
+    loadsQueued += files.size();
+  }
+
+  for (size_t loadIt = 0ul; loadIt < loads.size(); ++ loadIt) {
+    if (!loads[loadIt].Ready()) { continue; }
+
+    auto texture = loads[loadIt].Take();
+    if (texture.Valid()) {
+      texture.label = loads[loadIt].filename;
+      scene.textures.emplace_back(std::move(texture));
+    } else {
+      spdlog::error("Could not load texture '{}'", loads[loadIt].filename);
     }
+
+    loads.erase(loads.begin() + loadIt);
+    -- loadIt;
+  }
+
+  if (loads.size() > 0ul) {
+    size_t const loaded = loadsQueued - loads.size();
+    ImGui::ProgressBar(
+      static_cast<float>(loaded) / static_cast<float>(loadsQueued)
+    , ImVec2(-1.0f, 0.0f)
+    , fmt::format("{} / {} textures", loaded, loadsQueued).c_str()
+    );
+  } else {
+    loadsQueued = 0ul;
   }
 
   for (size_t texIt = 0; texIt != scene.textures.size(); ++ texIt) {
@@ -422,6 +452,97 @@ void UiImageOutput(
         mt::core::Clear(data);
       }
 
+      if (
+        ImGui::BeginCombo(
+          "russian roulette", mt::ToString(data.russianRoulette)
+        )
+      ) {
+        for (size_t it = 0ul; it < Idx(mt::RussianRoulette::Size); ++ it) {
+          auto const roulette = static_cast<mt::RussianRoulette>(it);
+          if (
+            ImGui::Selectable(
+              mt::ToString(roulette), data.russianRoulette == roulette
+            )
+          ) {
+            data.russianRoulette = roulette;
+            mt::core::Clear(data);
+          }
+        }
+        ImGui::EndCombo();
+      }
+
+      if (data.russianRoulette != mt::RussianRoulette::Off) {
+        if (ImGui::InputInt("roulette depth", &data.russianRouletteDepth)) {
+          mt::core::Clear(data);
+        }
+
+        if (
+          ImGui::SliderFloat(
+            "roulette min chance", &data.russianRouletteMinChance
+          , 0.01f, 1.0f
+          )
+        ) {
+          mt::core::Clear(data);
+        }
+      }
+
+      if (data.russianRoulette == mt::RussianRoulette::Adjoint) {
+        if (
+          ImGui::SliderFloat(
+            "roulette window", &data.russianRouletteWindow, 1.0f, 16.0f
+          )
+        ) {
+          mt::core::Clear(data);
+        }
+
+        if (ImGui::InputInt("max splitting", &data.maxSplitting)) {
+          data.maxSplitting = glm::clamp(data.maxSplitting, 1ul, 16ul);
+          mt::core::Clear(data);
+        }
+      }
+
+      if (
+        ImGui::BeginCombo(
+          "output"
+        , data.displayedAov < data.aovs.size()
+            ? data.aovs[data.displayedAov].label.c_str() : "color"
+        )
+      ) {
+        // -1lu displays the color, the channels are displayed in place of it
+        for (size_t it = -1lu; it != data.aovs.size(); ++ it) {
+          if (
+            ImGui::Selectable(
+              it == -1lu ? "color" : data.aovs[it].label.c_str()
+            , data.displayedAov == it
+            )
+          ) {
+            data.displayedAov = it;
+
+            // the channels are already accumulated, so only re-resolve them
+            size_t const pixelLength =
+              data.imageResolution.x * data.imageResolution.y;
+            for (size_t idx = 0ul; idx < pixelLength; ++ idx) {
+              data.mappedImageTransitionBuffer[idx] =
+                mt::core::ResolvePixel(data, idx);
+            }
+            mt::core::DispatchImageCopy(
+              data, 0ul, data.imageResolution.x, 0ul, data.imageResolution.y
+            );
+          }
+        }
+        ImGui::EndCombo();
+      }
+
+      if (ImGui::Checkbox("spectral", &data.spectral)) {
+        mt::core::Clear(data);
+      }
+
+      if (ImGui::Checkbox("kahan accumulation", &data.kahanAccumulation)) {
+        mt::core::Clear(data);
+      }
+
+      ImGui::Checkbox("sort by material", &data.materialSortedDispatch);
+
       { // -- iterator block size
         size_t iteratorIdx = 0ul;
         // get current idx
@@ -520,9 +641,16 @@ void UiImageOutput(
         ImGui::InputInt("ImGui resolution", &data.imguiImageResolution);
       }
 
-      // must reallocate resources if resolution has changed
-      if (previousResolution != data.imageResolution)
-        { mt::core::AllocateResources(data, i, plugin); }
+      bool const previousHalfFloatTexture = data.halfFloatTexture;
+      ImGui::Checkbox("half float texture", &data.halfFloatTexture);
+
+      // must reallocate resources if resolution/texture format has changed
+      if (
+          previousResolution != data.imageResolution
+       || previousHalfFloatTexture != data.halfFloatTexture
+      ) {
+        mt::core::AllocateResources(data, i, plugin);
+      }
     }
 
     if (data.renderingFinished) {